@@ -0,0 +1,62 @@
+#include "fd_accounting.h"
+#include "fd_event.h"
+#include "fd_hal_reset.h"
+#include "fd_hal_rtc.h"
+#include "fd_log.h"
+
+#include <string.h>
+
+// marks the retained accounting fields as valid, the low byte is the layout version (change it when the retained
+// accounting fields change so totals from other firmware are not trusted)
+#define FD_ACCOUNTING_RETAINED_MAGIC 0xacc0a001
+
+static fd_accounting_category_t fd_accounting_category;
+static uint32_t fd_accounting_clock;
+
+void fd_accounting_initialize(void) {
+    // the category totals are retained (fd_hal_reset_initialize clears all retained fields when they are not valid,
+    // the accounting fields are also cleared when they were left by firmware with a different layout)
+    fd_log_assert(FD_ACCOUNTING_CATEGORY_COUNT <= FD_HAL_RESET_ACCOUNTING_SIZE);
+    fd_hal_reset_retained_t *retained = fd_hal_reset_retained();
+    if (retained->accounting_magic != FD_ACCOUNTING_RETAINED_MAGIC) {
+        memset(retained->accounting_clocks, 0, sizeof(retained->accounting_clocks));
+        retained->accounting_wakeups = 0;
+        retained->accounting_magic = FD_ACCOUNTING_RETAINED_MAGIC;
+    }
+
+    fd_accounting_category = FD_ACCOUNTING_IDLE;
+    fd_accounting_clock = fd_hal_rtc_get_clock();
+}
+
+fd_accounting_category_t fd_accounting_switch(fd_accounting_category_t category) {
+    uint32_t clock = fd_hal_rtc_get_clock();
+    fd_accounting_category_t previous = fd_accounting_category;
+    fd_hal_reset_retained()->accounting_clocks[previous] += clock - fd_accounting_clock;
+    fd_accounting_clock = clock;
+    fd_accounting_category = category;
+    return previous;
+}
+
+void fd_accounting_wakeup(void) {
+    ++fd_hal_reset_retained()->accounting_wakeups;
+}
+
+void fd_accounting_diagnostics(fd_binary_t *binary) {
+    // bring the current category up to date
+    fd_accounting_switch(fd_accounting_category);
+
+    fd_hal_reset_retained_t *retained = fd_hal_reset_retained();
+    uint32_t count = fd_event_get_item_count();
+    fd_binary_put_uint32(binary, 4 + 4 + 1 + FD_ACCOUNTING_CATEGORY_COUNT * 8 + 1 + count * 4 /* length of following bytes */);
+    fd_binary_put_uint32(binary, 1 /* version */);
+    fd_binary_put_uint32(binary, 32768 /* clock rate */);
+    fd_binary_put_uint32(binary, retained->accounting_wakeups);
+    fd_binary_put_uint8(binary, FD_ACCOUNTING_CATEGORY_COUNT);
+    for (uint32_t i = 0; i < FD_ACCOUNTING_CATEGORY_COUNT; ++i) {
+        fd_binary_put_uint64(binary, retained->accounting_clocks[i]);
+    }
+    fd_binary_put_uint8(binary, count);
+    for (uint32_t i = 0; i < count; ++i) {
+        fd_binary_put_uint32(binary, fd_event_get_item_clocks(i));
+    }
+}
\ No newline at end of file
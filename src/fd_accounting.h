@@ -0,0 +1,42 @@
+#ifndef FD_ACCOUNTING_H
+#define FD_ACCOUNTING_H
+
+#include "fd_binary.h"
+
+#include <stdint.h>
+
+/*
+ Attribution of where the time goes (for battery life analysis).  Time is measured with the 32768 Hz RTC clock
+ and is always charged to exactly one category.  Category totals are kept in retained RAM so that they survive
+ resets (other than power on).  Event callback time is also accumulated per event callback (see fd_event).
+
+ Interrupt handlers are charged to whatever category is current when they run.
+ */
+
+typedef enum {
+    // main loop overhead, outside of any callback
+    FD_ACCOUNTING_IDLE,
+    // event callbacks (other than timer callbacks)
+    FD_ACCOUNTING_EVENT,
+    // timer callbacks
+    FD_ACCOUNTING_TIMER,
+    // in EM2
+    FD_ACCOUNTING_SLEEP,
+    // kept out of EM2 by an EM2 check (one category per EM2 check, in the order added)
+    FD_ACCOUNTING_VETO,
+} fd_accounting_category_t;
+
+#define FD_ACCOUNTING_VETO_LIMIT 4
+#define FD_ACCOUNTING_CATEGORY_COUNT (FD_ACCOUNTING_VETO + FD_ACCOUNTING_VETO_LIMIT)
+
+void fd_accounting_initialize(void);
+
+// charge the time since the last switch to the current category, then make the given category current
+// (returns the previous category so that it can be switched back to)
+fd_accounting_category_t fd_accounting_switch(fd_accounting_category_t category);
+
+void fd_accounting_wakeup(void);
+
+void fd_accounting_diagnostics(fd_binary_t *binary);
+
+#endif
\ No newline at end of file
@@ -3,8 +3,8 @@
 #include "fd_control.h"
 #include "fd_detour.h"
 #include "fd_event.h"
-#include "fd_hal_processor.h"
-#include "fd_hal_reset.h"
+#include "fd_hal_nrf8001.h"
+#include "fd_hal_rtc.h"
 #include "fd_lock.h"
 #include "fd_log.h"
 #include "fd_nrf8001.h"
@@ -12,14 +12,12 @@
 #include "fd_nrf8001_commands.h"
 #include "fd_nrf8001_dispatch.h"
 #include "fd_nrf8001_types.h"
-#include "fd_pins.h"
 #include "fd_spi.h"
+#include "fd_hrtimer.h"
 #include "fd_timer.h"
 
 #include "services.h"
 
-#include <em_gpio.h>
-
 #include <string.h>
 
 #define HAL_ACI_MAX_LENGTH 31
@@ -82,7 +80,7 @@ typedef enum {
 
 fd_bluetooth_disconnect_action_t fd_bluetooth_disconnect_action;
 
-fd_timer_t fd_bluetooth_dtm_timer;
+fd_hrtimer_t fd_bluetooth_dtm_timer;
 
 bool fd_nrf8001_did_setup;
 bool fd_nrf8001_did_advertise;
@@ -99,8 +97,79 @@ uint16_t fd_bluetooth_connection_interval;
 uint16_t fd_bluetooth_slave_latency;
 uint16_t fd_bluetooth_supervision_timeout;
 
+// Connection parameter policy:  the fast interval is requested when there is traffic (data received or
+// detour sources pushed) and the low power interval once the link has been idle (with an empty detour
+// source collection) for the idle period.
+
+typedef enum {
+    fd_bluetooth_timing_fast,
+    fd_bluetooth_timing_slow
+} fd_bluetooth_timing_t;
+
+typedef struct {
+    uint16_t interval_min; // 1.25ms units
+    uint16_t interval_max; // 1.25ms units
+    uint16_t latency;
+    uint16_t timeout; // 10ms units
+} fd_bluetooth_timing_parameters_t;
+
+static const fd_bluetooth_timing_parameters_t fd_bluetooth_timing_parameters[] = {
+    // 15ms - 30ms (the shortest interval range iOS accepts), 1s supervision timeout
+    { .interval_min = 12, .interval_max = 24, .latency = 0, .timeout = 100 },
+    // 100ms - 125ms, skipping up to 4 events when there is nothing to send, 4s supervision timeout
+    { .interval_min = 80, .interval_max = 100, .latency = 4, .timeout = 400 },
+};
+
+#define FD_BLUETOOTH_TIMING_IDLE_SECONDS 5
+
+static fd_bluetooth_timing_t fd_bluetooth_timing;
+static fd_timer_t fd_bluetooth_timing_timer;
+static uint32_t fd_bluetooth_timing_activity_clock;
+static uint32_t fd_bluetooth_timing_requests;
+
+// throughput of the current (or last) burst of traffic at the fast interval
+static uint32_t fd_bluetooth_tx_packets;
+static uint32_t fd_bluetooth_burst_start_clock;
+static uint32_t fd_bluetooth_burst_start_packets;
+static uint32_t fd_bluetooth_burst_end_clock;
+static uint32_t fd_bluetooth_burst_bytes;
+static uint32_t fd_bluetooth_burst_duration; // 1/32768 s
+
+// Throughput telemetry:  time with no data credits while connected (credit limited), time with packets
+// waiting in the detour source collection (a backlog with credits available means interval limited) and
+// packets dropped because the connection went away before they were sent.
+static uint32_t fd_bluetooth_starved_start_clock;
+static bool fd_bluetooth_starved;
+static uint64_t fd_bluetooth_starved_clocks;
+static uint32_t fd_bluetooth_backlog_start_clock;
+static bool fd_bluetooth_backlog;
+static uint64_t fd_bluetooth_backlog_clocks;
+static uint32_t fd_bluetooth_collection_high_water;
+static uint32_t fd_bluetooth_dropped_packets;
+
+// ACI transport:  commands are staged in fd_nrf8001_spi_tx_buffer and moved to fd_bluetooth_spi_tx_buffer when
+// their transfer starts, so the next command can be staged while the current one is on the bus.  Transfers
+// start when RDYN goes low (FD_EVENT_NRF_RDYN) and finish in the background (FD_EVENT_NRF_SPI), so the main
+// loop never waits on the nRF8001.
+
+typedef enum {
+    fd_bluetooth_spi_state_idle,
+    fd_bluetooth_spi_state_transfer,
+    fd_bluetooth_spi_state_complete,
+} fd_bluetooth_spi_state_t;
+
+static volatile fd_bluetooth_spi_state_t fd_bluetooth_spi_state;
+static uint8_t fd_bluetooth_spi_tx_buffer[FD_NRF8001_SPI_TX_BUFFER_SIZE];
+static uint32_t fd_bluetooth_spi_tx_length;
+static uint8_t fd_bluetooth_spi_rx_buffer[FD_NRF8001_SPI_RX_BUFFER_SIZE];
+static fd_spi_transfer_t fd_bluetooth_spi_transfers[1];
+static fd_spi_io_t fd_bluetooth_spi_io;
+
 bool fd_bluetooth_spi_transfer(void);
+void fd_bluetooth_spi_receive(void);
 void fd_bluetooth_dtm_time(void);
+void fd_bluetooth_timing_idle_check(void);
+void fd_bluetooth_detour_source_pushed(void);
 
 void fd_bluetooth_ready(void) {
     // !!! when entering storage mode don't try to do any spi transfers since the bus has been powered down -denis
@@ -108,10 +177,21 @@ void fd_bluetooth_ready(void) {
         return;
     }
 
+    fd_bluetooth_spi_receive();
+    if (!fd_nrf8001_can_send()) {
+        // a command was staged during the last transfer
+        fd_hal_nrf8001_request();
+    }
     fd_bluetooth_spi_transfer();
     fd_bluetooth_step();
 }
 
+static
+bool fd_bluetooth_em2_check(void) {
+    // the usart stops in em2
+    return fd_bluetooth_spi_state != fd_bluetooth_spi_state_transfer;
+}
+
 void fd_bluetooth_initialize(void) {
     fd_bluetooth_system_steps = 0;
     fd_bluetooth_data_steps = 0;
@@ -132,6 +212,7 @@ void fd_bluetooth_initialize(void) {
         fd_bluetooth_detour_source_collection_data,
         DETOUR_SOURCE_COLLECTION_SIZE
     );
+    fd_bluetooth_detour_source_collection.callback = fd_bluetooth_detour_source_pushed;
 
     fd_bluetooth_disconnect_action = fd_bluetooth_disconnect_action_connect;
 
@@ -150,9 +231,36 @@ void fd_bluetooth_initialize(void) {
     fd_bluetooth_slave_latency = 0;
     fd_bluetooth_supervision_timeout = 0;
 
-    fd_event_add_callback(FD_EVENT_NRF_RDYN | FD_EVENT_BLE_DATA_CREDITS | FD_EVENT_BLE_SYSTEM_CREDITS | FD_EVENT_BLE_STEP, fd_bluetooth_ready);
+    fd_bluetooth_timing = fd_bluetooth_timing_slow;
+    fd_bluetooth_timing_activity_clock = 0;
+    fd_bluetooth_timing_requests = 0;
+    fd_bluetooth_tx_packets = 0;
+    fd_bluetooth_burst_start_clock = 0;
+    fd_bluetooth_burst_start_packets = 0;
+    fd_bluetooth_burst_end_clock = 0;
+    fd_bluetooth_burst_bytes = 0;
+    fd_bluetooth_burst_duration = 0;
+    fd_bluetooth_starved_start_clock = 0;
+    fd_bluetooth_starved = false;
+    fd_bluetooth_starved_clocks = 0;
+    fd_bluetooth_backlog_start_clock = 0;
+    fd_bluetooth_backlog = false;
+    fd_bluetooth_backlog_clocks = 0;
+    fd_bluetooth_collection_high_water = 0;
+    fd_bluetooth_dropped_packets = 0;
+    fd_bluetooth_spi_state = fd_bluetooth_spi_state_idle;
+    fd_bluetooth_spi_tx_length = 0;
+    fd_timer_add(&fd_bluetooth_timing_timer, fd_bluetooth_timing_idle_check);
+
+    fd_event_add_prioritized_callback(
+        FD_EVENT_NRF_RDYN | FD_EVENT_NRF_SPI | FD_EVENT_BLE_DATA_CREDITS | FD_EVENT_BLE_SYSTEM_CREDITS | FD_EVENT_BLE_STEP,
+        FD_EVENT_PRIORITY_HIGH,
+        fd_bluetooth_ready
+    );
+    fd_event_add_em2_check(fd_bluetooth_em2_check);
+    fd_spi_set_request_callback(FD_SPI_BUS_1_SLAVE_NRF8001, fd_bluetooth_spi_transfer);
 
-    fd_timer_add(&fd_bluetooth_dtm_timer, fd_bluetooth_direct_test_mode_exit);
+    fd_hrtimer_add(&fd_bluetooth_dtm_timer, fd_bluetooth_direct_test_mode_exit);
 }
 
 #define FD_BLUETOOTH_DID_SETUP        0x01
@@ -162,8 +270,8 @@ void fd_bluetooth_initialize(void) {
 #define FD_BLUETOOTH_DID_RECEIVE_DATA 0x10
 
 void fd_bluetooth_diagnostics(fd_binary_t *binary) {
-    fd_binary_put_uint32(binary, 42 /* length of following bytes */);
-    fd_binary_put_uint32(binary, 1 /* version */);
+    fd_binary_put_uint32(binary, 111 /* length of following bytes */);
+    fd_binary_put_uint32(binary, 3 /* version */);
     fd_binary_put_uint32(binary, fd_bluetooth_system_steps);
     fd_binary_put_uint32(binary, fd_bluetooth_data_steps);
     fd_binary_put_uint32(binary, fd_nrf8001_get_system_credits());
@@ -194,6 +302,45 @@ void fd_bluetooth_diagnostics(fd_binary_t *binary) {
     fd_binary_put_uint16(binary, fd_nrf8001_dtm_request);
     fd_binary_put_uint16(binary, fd_nrf8001_dtm_data);
     fd_binary_put_uint32(binary, fd_bluetooth_detour_source_collection.bufferCount);
+    // version 2
+    const fd_bluetooth_timing_parameters_t *parameters = &fd_bluetooth_timing_parameters[fd_bluetooth_timing];
+    fd_binary_put_uint8(binary, fd_bluetooth_timing);
+    fd_binary_put_uint16(binary, parameters->interval_min);
+    fd_binary_put_uint16(binary, parameters->interval_max);
+    fd_binary_put_uint32(binary, fd_bluetooth_timing_requests);
+    fd_binary_put_uint32(binary, fd_bluetooth_tx_packets);
+    uint32_t bytes = fd_bluetooth_burst_bytes;
+    uint32_t duration = fd_bluetooth_burst_duration;
+    if (fd_bluetooth_timing == fd_bluetooth_timing_fast) {
+        // burst in progress
+        bytes = (fd_bluetooth_tx_packets - fd_bluetooth_burst_start_packets) * MAX_CHARACTERISTIC_SIZE;
+        duration = fd_bluetooth_burst_end_clock - fd_bluetooth_burst_start_clock;
+    }
+    fd_binary_put_uint32(binary, bytes);
+    fd_binary_put_uint32(binary, duration);
+    // bytes per second
+    fd_binary_put_uint32(binary, duration ? (uint32_t)(((uint64_t)bytes * 32768) / duration) : 0);
+    // version 3
+    fd_nrf8001_data_credit_statistics_t statistics;
+    fd_nrf8001_get_data_credit_statistics(&statistics);
+    fd_binary_put_uint32(binary, statistics.used);
+    fd_binary_put_uint32(binary, statistics.returned);
+    fd_binary_put_uint32(binary, statistics.events);
+    fd_binary_put_uint32(binary, statistics.max_returned);
+    fd_binary_put_uint32(binary, statistics.exhausted);
+    uint32_t clock = fd_hal_rtc_get_clock();
+    uint64_t starved_clocks = fd_bluetooth_starved_clocks;
+    if (fd_bluetooth_starved) {
+        starved_clocks += clock - fd_bluetooth_starved_start_clock;
+    }
+    fd_binary_put_uint64(binary, starved_clocks);
+    uint64_t backlog_clocks = fd_bluetooth_backlog_clocks;
+    if (fd_bluetooth_backlog) {
+        backlog_clocks += clock - fd_bluetooth_backlog_start_clock;
+    }
+    fd_binary_put_uint64(binary, backlog_clocks);
+    fd_binary_put_uint32(binary, fd_bluetooth_collection_high_water);
+    fd_binary_put_uint32(binary, fd_bluetooth_dropped_packets);
 }
 
 void fd_bluetooth_diagnostics_timing(fd_binary_t *binary) {
@@ -211,64 +358,85 @@ void fd_nrf8001_system_credit_change(void) {
 }
 
 void fd_nrf8001_data_credit_change(void) {
+    bool starved = fd_nrf8001_did_connect && !fd_nrf8001_has_data_credits();
+    if (starved != fd_bluetooth_starved) {
+        uint32_t clock = fd_hal_rtc_get_clock();
+        if (starved) {
+            fd_bluetooth_starved_start_clock = clock;
+        } else {
+            fd_bluetooth_starved_clocks += clock - fd_bluetooth_starved_start_clock;
+        }
+        fd_bluetooth_starved = starved;
+    }
+
     fd_event_set(FD_EVENT_BLE_DATA_CREDITS);
 }
 
 void fd_bluetooth_reset(void) {
-    GPIO_PinOutClear(NRF_RESETN_PORT_PIN);
-    fd_hal_processor_delay_ms(100);
-    GPIO_PinOutSet(NRF_RESETN_PORT_PIN);
-    fd_hal_processor_delay_ms(100); // wait for nRF8001 to come out of reset (62ms)
+    fd_hal_nrf8001_reset();
+}
+
+// called from the spi interrupt
+static
+void fd_bluetooth_spi_complete(void) {
+    fd_bluetooth_spi_state = fd_bluetooth_spi_state_complete;
+    fd_event_set(FD_EVENT_NRF_SPI);
 }
 
 bool fd_bluetooth_spi_transfer(void) {
-    if (GPIO_PinInGet(NRF_RDYN_PORT_PIN)) {
+    if ((fd_bluetooth_spi_state != fd_bluetooth_spi_state_idle) || !fd_hal_nrf8001_is_ready()) {
         return false;
     }
 
-    fd_hal_reset_push_watchdog_context("bspi");
-
-    uint8_t rx_buffer[FD_NRF8001_SPI_RX_BUFFER_SIZE];
-    fd_spi_transfer_t transfers[] = {
-        {
-            .op = fd_nrf8001_spi_tx_length ? fd_spi_op_read_write : fd_spi_op_read,
-
-            .tx_buffer = fd_nrf8001_spi_tx_buffer,
-            .tx_size = FD_NRF8001_SPI_TX_BUFFER_SIZE,
-            .tx_length = fd_nrf8001_spi_tx_length,
+    fd_bluetooth_spi_tx_length = fd_nrf8001_spi_tx_length;
+    memcpy(fd_bluetooth_spi_tx_buffer, fd_nrf8001_spi_tx_buffer, fd_bluetooth_spi_tx_length);
+    fd_nrf8001_spi_tx_clear();
 
-            .rx_buffer = rx_buffer,
-            .rx_size = FD_NRF8001_SPI_RX_BUFFER_SIZE,
-            .rx_length = 2,
-        },
-    };
-    fd_spi_io_t io = {
-        .options = FD_SPI_OPTION_VARLEN,
-        .transfers = transfers,
-        .transfers_count = sizeof(transfers) / sizeof(fd_spi_transfer_t),
-        .completion_callback = 0,
-    };
-    fd_spi_io(FD_SPI_BUS_1_SLAVE_NRF8001, &io);
-    fd_spi_wait(FD_SPI_BUS_1);
+    fd_spi_transfer_t *transfer = &fd_bluetooth_spi_transfers[0];
+    transfer->op = fd_bluetooth_spi_tx_length ? fd_spi_op_read_write : fd_spi_op_read;
+    transfer->tx_buffer = fd_bluetooth_spi_tx_buffer;
+    transfer->tx_size = FD_NRF8001_SPI_TX_BUFFER_SIZE;
+    transfer->tx_length = fd_bluetooth_spi_tx_length;
+    transfer->rx_buffer = fd_bluetooth_spi_rx_buffer;
+    transfer->rx_size = FD_NRF8001_SPI_RX_BUFFER_SIZE;
+    transfer->rx_length = 2;
+    fd_bluetooth_spi_io.options = FD_SPI_OPTION_VARLEN;
+    fd_bluetooth_spi_io.transfers = fd_bluetooth_spi_transfers;
+    fd_bluetooth_spi_io.transfers_count = sizeof(fd_bluetooth_spi_transfers) / sizeof(fd_spi_transfer_t);
+    fd_bluetooth_spi_io.completion_callback = fd_bluetooth_spi_complete;
+    fd_bluetooth_spi_state = fd_bluetooth_spi_state_transfer;
+    fd_spi_io(FD_SPI_BUS_1_SLAVE_NRF8001, &fd_bluetooth_spi_io);
+    return true;
+}
 
-    fd_hal_reset_pop_watchdog_context();
+void fd_bluetooth_spi_receive(void) {
+    if (fd_bluetooth_spi_state != fd_bluetooth_spi_state_complete) {
+        return;
+    }
 
-    fd_nrf8001_spi_tx_clear();
+    // the nRF8001 has taken the sleep command, so it is safe to power down now
+    if ((fd_bluetooth_spi_tx_length > 1) && (fd_bluetooth_spi_tx_buffer[1] == Sleep)) {
+        fd_bluetooth_idle = true;
+        fd_event_set_exclusive(FD_EVENT_BLE_STATE);
+    }
 
-    uint32_t length = rx_buffer[1];
+    // the rx buffer is not reused until the event has been dispatched
+    uint32_t length = fd_bluetooth_spi_rx_buffer[1];
     if (length > 0) {
-        fd_nrf8001_dispatch(&rx_buffer[2], length);
+        fd_nrf8001_dispatch(&fd_bluetooth_spi_rx_buffer[2], length);
     }
-    return true;
+    fd_bluetooth_spi_state = fd_bluetooth_spi_state_idle;
 }
 
+// a command has been staged:  ask for a transfer (REQN low), which starts when RDYN goes low.  REQN is only
+// pulled low with nothing left to receive, so the transfer can start from fd_spi as soon as RDYN goes low
+// (fd_bluetooth_ready asks for it once the current transfer has been received).
 void fd_nrf8001_spi_transfer(void) {
-    fd_spi_set_device(FD_SPI_BUS_1_SLAVE_NRF8001);
-    GPIO_PinOutClear(NRF_REQN_PORT_PIN);
-    while (GPIO_PinInGet(NRF_RDYN_PORT_PIN));
-
-    bool result = fd_bluetooth_spi_transfer();
-    fd_log_assert(result);
+    if (fd_bluetooth_spi_state != fd_bluetooth_spi_state_idle) {
+        return;
+    }
+    fd_hal_nrf8001_request();
+    fd_bluetooth_spi_transfer();
 }
 
 void fd_bluetooth_step_queue(uint32_t step) {
@@ -290,12 +458,11 @@ void fd_bluetooth_data_step_complete(uint32_t step) {
 }
 
 void fd_bluetooth_system_step(void) {
-    while ((fd_bluetooth_system_steps != 0) && fd_nrf8001_has_system_credits()) {
+    while ((fd_bluetooth_system_steps != 0) && fd_nrf8001_has_system_credits() && fd_nrf8001_can_send()) {
         if (fd_bluetooth_system_steps & fd_nrf8001_sleep_step) {
+            // idle once the command has been transferred (see fd_bluetooth_spi_receive)
             fd_nrf8001_sleep();
             fd_bluetooth_step_complete(fd_nrf8001_sleep_step);
-            fd_bluetooth_idle = true;
-            fd_event_set_exclusive(FD_EVENT_BLE_STATE);
         } else
         if (fd_bluetooth_system_steps & fd_nrf8001_wakeup_step) {
             fd_nrf8001_wakeup();
@@ -319,12 +486,12 @@ void fd_bluetooth_system_step(void) {
             fd_nrf8001_did_advertise = true;
         } else
         if (fd_bluetooth_system_steps & fd_nrf8001_change_timing_request_step) {
-            uint16_t interval_min = 8; // 10ms (1.25ms units)
-            uint16_t interval_max = 16; // 20ms (1.25ms units)
-            uint16_t latency = 0;
-            uint16_t timeout = 100; // 1s (10ms units)
-            fd_nrf8001_change_timing_request(interval_min, interval_max, latency, timeout);
+            const fd_bluetooth_timing_parameters_t *parameters = &fd_bluetooth_timing_parameters[fd_bluetooth_timing];
+            fd_nrf8001_change_timing_request(
+                parameters->interval_min, parameters->interval_max, parameters->latency, parameters->timeout
+            );
             fd_bluetooth_step_complete(fd_nrf8001_change_timing_request_step);
+            ++fd_bluetooth_timing_requests;
         } else
         if (fd_bluetooth_system_steps & fd_nrf8001_open_remote_pipe_step) {
             for (int i = 1; i < 63; ++i) {
@@ -383,7 +550,7 @@ void fd_bluetooth_system_step(void) {
 }
 
 void fd_bluetooth_data_step(void) {
-    while ((fd_bluetooth_data_steps != 0) && fd_nrf8001_has_data_credits()) {
+    while ((fd_bluetooth_data_steps != 0) && fd_nrf8001_has_data_credits() && fd_nrf8001_can_send()) {
         if (fd_bluetooth_data_steps & fd_nrf8001_detour_send_data_ack_step) {
             fd_nrf8001_send_data_ack(PIPE_FIREFLY_ICE_DETOUR_RX_ACK);
             fd_bluetooth_data_step_complete(fd_nrf8001_detour_send_data_ack_step);
@@ -399,9 +566,82 @@ void fd_bluetooth_transfer(void) {
     while (
         fd_bluetooth_is_pipe_open(PIPE_FIREFLY_ICE_DETOUR_TX) &&
         fd_nrf8001_has_data_credits() &&
+        fd_nrf8001_can_send() &&
         fd_detour_source_collection_get(&fd_bluetooth_detour_source_collection, fd_bluetooth_out_data)
     ) {
-        fd_nrf8001_send_data(PIPE_FIREFLY_ICE_DETOUR_TX, fd_bluetooth_out_data, MAX_CHARACTERISTIC_SIZE);
+        fd_nrf8001_send_data(PIPE_FIREFLY_ICE_DETOUR_TX, fd_bluetooth_out_data, fd_bluetooth_detour_source_collection.packetSize);
+        ++fd_bluetooth_tx_packets;
+        fd_bluetooth_burst_end_clock = fd_hal_rtc_get_clock();
+    }
+    if (fd_bluetooth_backlog && (fd_bluetooth_detour_source_collection.bufferCount == 0)) {
+        fd_bluetooth_backlog_clocks += fd_hal_rtc_get_clock() - fd_bluetooth_backlog_start_clock;
+        fd_bluetooth_backlog = false;
+    }
+}
+
+static
+void fd_bluetooth_timing_start_idle_timer(void) {
+    fd_time_t duration = { .seconds = FD_BLUETOOTH_TIMING_IDLE_SECONDS, .microseconds = 0 };
+    fd_timer_start(&fd_bluetooth_timing_timer, duration);
+}
+
+static
+void fd_bluetooth_timing_request(fd_bluetooth_timing_t timing) {
+    fd_bluetooth_timing = timing;
+    fd_bluetooth_step_queue(fd_nrf8001_change_timing_request_step);
+}
+
+static
+void fd_bluetooth_timing_activity(void) {
+    if (!fd_nrf8001_did_connect) {
+        return;
+    }
+
+    uint32_t clock = fd_hal_rtc_get_clock();
+    fd_bluetooth_timing_activity_clock = clock;
+    if (fd_bluetooth_timing == fd_bluetooth_timing_fast) {
+        return;
+    }
+
+    fd_bluetooth_burst_start_clock = clock;
+    fd_bluetooth_burst_end_clock = clock;
+    fd_bluetooth_burst_start_packets = fd_bluetooth_tx_packets;
+    fd_bluetooth_timing_request(fd_bluetooth_timing_fast);
+    fd_bluetooth_timing_start_idle_timer();
+}
+
+void fd_bluetooth_timing_idle_check(void) {
+    if (!fd_nrf8001_did_connect || (fd_bluetooth_timing != fd_bluetooth_timing_fast)) {
+        return;
+    }
+
+    uint32_t idle = fd_hal_rtc_get_clock() - fd_bluetooth_timing_activity_clock;
+    if ((fd_bluetooth_detour_source_collection.bufferCount > 0) || (idle < (FD_BLUETOOTH_TIMING_IDLE_SECONDS * 32768))) {
+        fd_bluetooth_timing_start_idle_timer();
+        return;
+    }
+
+    fd_bluetooth_burst_bytes = (fd_bluetooth_tx_packets - fd_bluetooth_burst_start_packets) * MAX_CHARACTERISTIC_SIZE;
+    fd_bluetooth_burst_duration = fd_bluetooth_burst_end_clock - fd_bluetooth_burst_start_clock;
+    fd_bluetooth_timing_request(fd_bluetooth_timing_slow);
+}
+
+// Send pump:  sending starts as soon as a source is pushed (instead of waiting for the next nRF8001 event)
+// and continues whenever data credits are returned.  Each packet taken from the collection lets queued
+// control responses refill it (see fd_control), so all the data credits stay in use during bulk transfers.
+void fd_bluetooth_detour_source_pushed(void) {
+    uint32_t count = fd_bluetooth_detour_source_collection.bufferCount;
+    if (count > fd_bluetooth_collection_high_water) {
+        fd_bluetooth_collection_high_water = count;
+    }
+    if (!fd_bluetooth_backlog && (count > 0)) {
+        fd_bluetooth_backlog_start_clock = fd_hal_rtc_get_clock();
+        fd_bluetooth_backlog = true;
+    }
+
+    fd_bluetooth_timing_activity();
+    if (fd_bluetooth_is_pipe_open(PIPE_FIREFLY_ICE_DETOUR_TX) && fd_nrf8001_has_data_credits()) {
+        fd_event_set_exclusive(FD_EVENT_BLE_STEP);
     }
 }
 
@@ -481,7 +721,9 @@ void fd_nrf8001_connected_event(
     fd_nrf8001_set_data_credits(fd_bluetooth_initial_data_credits);
     fd_detour_clear(&fd_bluetooth_detour);
 
-    fd_bluetooth_step_queue(fd_nrf8001_change_timing_request_step);
+    // the host usually has something to do right after connecting, so start out fast
+    fd_bluetooth_timing = fd_bluetooth_timing_slow;
+    fd_bluetooth_timing_activity();
 }
 
 void fd_nrf8001_timing_event(
@@ -512,6 +754,19 @@ void fd_nrf8001_disconnected_event(
 
     fd_nrf8001_set_data_credits(0);
 
+    // anything not sent yet was meant for the host that just went away
+    fd_detour_source_collection_t *collection = &fd_bluetooth_detour_source_collection;
+    fd_bluetooth_dropped_packets += collection->bufferCount / collection->packetSize;
+    fd_detour_source_collection_clear(collection);
+    fd_control_release(collection);
+    if (fd_bluetooth_backlog) {
+        fd_bluetooth_backlog_clocks += fd_hal_rtc_get_clock() - fd_bluetooth_backlog_start_clock;
+        fd_bluetooth_backlog = false;
+    }
+
+    fd_timer_stop(&fd_bluetooth_timing_timer);
+    fd_bluetooth_timing = fd_bluetooth_timing_slow;
+
     switch (fd_bluetooth_disconnect_action) {
         case fd_bluetooth_disconnect_action_connect:
             fd_bluetooth_step_queue(fd_nrf8001_connect_step);
@@ -543,14 +798,29 @@ void fd_nrf8001_detour_data_received(
     uint8_t *data,
     uint32_t data_length
 ) {
+    fd_bluetooth_timing_activity();
+
+    fd_detour_set_resume(&fd_bluetooth_detour, (fd_bluetooth_detour_source_collection.flags & FD_DETOUR_FLAG_RESUME) != 0);
     fd_detour_event(&fd_bluetooth_detour, data, data_length);
+    uint32_t sequence_number;
+    if (fd_detour_get_nack(&fd_bluetooth_detour, &sequence_number)) {
+        // a write was lost, so ask the host to go back to it
+        fd_control_detour_resume(&fd_bluetooth_detour_source_collection, sequence_number);
+    }
     switch (fd_detour_state(&fd_bluetooth_detour)) {
         case fd_detour_state_clear:
         case fd_detour_state_intermediate:
         break;
         case fd_detour_state_success:
-            fd_control_process(&fd_bluetooth_detour_source_collection, fd_bluetooth_detour.data, fd_bluetooth_detour.length);
-            fd_detour_clear(&fd_bluetooth_detour);
+            // a version 2 packet can hold several requests
+            do {
+                fd_control_process(&fd_bluetooth_detour_source_collection, fd_bluetooth_detour.data, fd_bluetooth_detour.length);
+                fd_detour_next(&fd_bluetooth_detour);
+            } while (fd_detour_state(&fd_bluetooth_detour) == fd_detour_state_success);
+            if (fd_detour_state(&fd_bluetooth_detour) == fd_detour_state_error) {
+                fd_log_assert_fail("");
+                fd_detour_clear(&fd_bluetooth_detour);
+            }
         break;
         case fd_detour_state_error:
             fd_log_assert_fail("");
@@ -582,7 +852,7 @@ void fd_nrf8001_dtm_command_success(uint16_t data) {
 }
 
 void fd_bluetooth_direct_test_mode_exit(void) {
-    fd_timer_stop(&fd_bluetooth_dtm_timer);
+    fd_hrtimer_stop(&fd_bluetooth_dtm_timer);
     fd_nrf8001_dtm_request = 0xc000;
     fd_bluetooth_step_queue(fd_nrf8001_test_command_step);
 }
@@ -591,8 +861,8 @@ void fd_bluetooth_direct_test_mode_enter(uint16_t request, fd_time_t duration) {
     fd_nrf8001_dtm_request = request;
     fd_bluetooth_disconnect_action = fd_bluetooth_disconnect_action_test;
     fd_bluetooth_step_queue(fd_nrf8001_disconnect_step);
-    if (duration.seconds != 0) {
-        fd_timer_start(&fd_bluetooth_dtm_timer, duration);
+    if ((duration.seconds != 0) || (duration.microseconds != 0)) {
+        fd_hrtimer_start(&fd_bluetooth_dtm_timer, duration);
     }
 }
 
@@ -0,0 +1,181 @@
+#include "fd_binary.h"
+#include "fd_bluetooth.h"
+#include "fd_control.h"
+#include "fd_control_queue.h"
+#include "fd_detour.h"
+#include "fd_event.h"
+#include "fd_hal_hrtimer.h"
+#include "fd_hrtimer.h"
+#include "fd_lock.h"
+#include "fd_log.h"
+#include "fd_nrf8001.h"
+#include "fd_nrf8001_sim.h"
+#include "fd_timer.h"
+
+#include "services.h"
+
+// end to end tests of fd_bluetooth (and the ACI code under it) against the simulated nRF8001
+
+extern bool fd_nrf8001_did_setup;
+extern bool fd_nrf8001_did_advertise;
+extern bool fd_nrf8001_did_connect;
+
+void fd_lock_close(fd_lock_owner_t owner __attribute__((unused))) {
+}
+
+// the test command:  the request is a uint16 response length, and the response is that many bytes (queued by
+// fd_control until there is room in the detour source collection)
+
+#define FD_BLUETOOTH_TEST_COMMAND 0xf0
+
+static uint32_t fd_bluetooth_test_request_count;
+
+static
+uint8_t fd_bluetooth_test_byte(uint32_t offset) {
+    return (uint8_t)(offset * 7 + 3);
+}
+
+static
+void fd_bluetooth_test_command(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length) {
+    ++fd_bluetooth_test_request_count;
+    fd_binary_t binary;
+    fd_binary_initialize(&binary, data, length);
+    uint16_t response_length = fd_binary_get_uint16(&binary);
+    fd_log_assert(response_length > 0);
+
+    fd_binary_t *binary_out = fd_control_send_start(detour_source_collection, fd_bluetooth_test_byte(0));
+    for (uint32_t i = 1; i < response_length; ++i) {
+        fd_binary_put_uint8(binary_out, fd_bluetooth_test_byte(i));
+    }
+    fd_control_send_complete(detour_source_collection);
+}
+
+// central side
+
+static uint8_t fd_bluetooth_test_detour_data[400];
+static fd_detour_t fd_bluetooth_test_detour;
+static uint32_t fd_bluetooth_test_received_count;
+
+static
+void fd_bluetooth_test_run(void) {
+    for (uint32_t i = 0; i < 1000; ++i) {
+        fd_nrf8001_sim_complete();
+        if (!fd_event_process_pending()) {
+            break;
+        }
+    }
+}
+
+static
+void fd_bluetooth_test_connection_event(void) {
+    fd_nrf8001_sim_connection_event();
+    fd_bluetooth_test_run();
+
+    uint8_t packet[20];
+    uint32_t length;
+    while (fd_nrf8001_sim_read(packet, &length)) {
+        fd_detour_event(&fd_bluetooth_test_detour, packet, length);
+        fd_detour_state_t state = fd_detour_state(&fd_bluetooth_test_detour);
+        if (state == fd_detour_state_success) {
+            bool match = true;
+            for (uint32_t i = 0; i < fd_bluetooth_test_detour.length; ++i) {
+                if (fd_bluetooth_test_detour.data[i] != fd_bluetooth_test_byte(i)) {
+                    match = false;
+                }
+            }
+            fd_log_assert(match);
+            ++fd_bluetooth_test_received_count;
+            fd_detour_clear(&fd_bluetooth_test_detour);
+        } else
+        if (state == fd_detour_state_error) {
+            fd_log_assert_fail("");
+            fd_detour_clear(&fd_bluetooth_test_detour);
+        }
+    }
+}
+
+static
+void fd_bluetooth_test_request(uint16_t response_length) {
+    // a request fits in one detour packet:  sequence number, detour length, command, response length
+    uint8_t packet[] = {0x00, 0x03, 0x00, FD_BLUETOOTH_TEST_COMMAND, response_length, response_length >> 8};
+    fd_log_assert(fd_nrf8001_sim_write(packet, sizeof(packet)));
+}
+
+static
+uint32_t fd_bluetooth_test_until_received(uint32_t count) {
+    uint32_t events = 0;
+    while ((fd_bluetooth_test_received_count < count) && (events < 1000)) {
+        fd_bluetooth_test_connection_event();
+        ++events;
+    }
+    fd_log_assert(fd_bluetooth_test_received_count == count);
+    return events;
+}
+
+void fd_bluetooth_unit_tests(void) {
+    fd_event_initialize();
+    fd_control_queue_initialize();
+    fd_control_set_command(FD_BLUETOOTH_TEST_COMMAND, fd_bluetooth_test_command);
+    fd_timer_initialize();
+    fd_hal_hrtimer_initialize();
+    fd_hrtimer_initialize();
+    fd_nrf8001_sim_initialize();
+    fd_nrf8001_initialize();
+    fd_bluetooth_reset();
+    fd_bluetooth_initialize();
+
+    fd_bluetooth_test_request_count = 0;
+    fd_bluetooth_test_received_count = 0;
+    fd_detour_initialize(&fd_bluetooth_test_detour, fd_bluetooth_test_detour_data, sizeof(fd_bluetooth_test_detour_data));
+
+    // setup messages are sent, then the device name is set and it starts advertising
+    fd_bluetooth_test_run();
+    fd_nrf8001_sim_statistics_t statistics;
+    fd_nrf8001_sim_get_statistics(&statistics);
+    fd_log_assert(statistics.setup_messages == NB_SETUP_MESSAGES);
+    fd_log_assert(fd_nrf8001_did_setup);
+    fd_log_assert(fd_nrf8001_did_advertise);
+    fd_log_assert(fd_nrf8001_sim_get_state() == fd_nrf8001_sim_state_advertising);
+
+    // the central connects at 50ms and the device asks for a faster interval (15ms, the shortest it asks for)
+    fd_log_assert(fd_nrf8001_sim_connect(40));
+    fd_bluetooth_test_run();
+    fd_log_assert(fd_nrf8001_did_connect);
+    fd_bluetooth_test_connection_event();
+    fd_log_assert(fd_nrf8001_sim_get_interval() == 12);
+
+    // request and response
+    fd_bluetooth_test_request(30);
+    fd_bluetooth_test_until_received(1);
+    fd_log_assert(fd_bluetooth_test_request_count == 1);
+
+    // sync sized responses for pipelined requests keep both data credits in use in every connection event
+    fd_nrf8001_sim_get_statistics(&statistics);
+    uint32_t packets_sent = statistics.packets_sent;
+    for (uint32_t i = 0; i < 6; ++i) {
+        fd_bluetooth_test_request(277);
+    }
+    uint32_t events = fd_bluetooth_test_until_received(7);
+    fd_nrf8001_sim_get_statistics(&statistics);
+    uint32_t packets = statistics.packets_sent - packets_sent;
+    fd_log_assert(packets == 6 * 15);
+    // two packets per connection event (plus a few events to get the first request in)
+    fd_log_assert(events <= (packets / 2) + 4);
+
+    // the central goes away and the device advertises again
+    fd_nrf8001_sim_disconnect();
+    fd_bluetooth_test_run();
+    fd_log_assert(!fd_nrf8001_did_connect);
+    fd_log_assert(fd_nrf8001_sim_get_state() == fd_nrf8001_sim_state_advertising);
+
+    // asleep (so the bus can be powered down) only once the sleep command has been transferred
+    fd_bluetooth_sleep();
+    fd_log_assert(!fd_bluetooth_is_asleep());
+    fd_bluetooth_test_run();
+    fd_log_assert(fd_bluetooth_is_asleep());
+    fd_log_assert(fd_nrf8001_sim_get_state() == fd_nrf8001_sim_state_sleep);
+
+    // transfers complete in the background, nothing waits for them
+    fd_nrf8001_sim_get_statistics(&statistics);
+    fd_log_assert(statistics.waits == 0);
+}
\ No newline at end of file
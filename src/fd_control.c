@@ -1,8 +1,12 @@
+#include "fd_accounting.h"
 #include "fd_binary.h"
 #include "fd_bluetooth.h"
 #include "fd_control.h"
 #include "fd_control_codes.h"
+#include "fd_control_queue.h"
+#include "fd_dump.h"
 #include "fd_event.h"
+#include "fd_hal_accelerometer.h"
 #include "fd_hal_aes.h"
 #include "fd_hal_ble.h"
 #include "fd_hal_processor.h"
@@ -22,98 +26,51 @@
 #include "fd_sha.h"
 #include "fd_storage.h"
 #include "fd_sync.h"
+#include "fd_timer.h"
+#include "fd_timing.h"
+#include "fd_trace.h"
 #include "fd_update.h"
 
 #include <string.h>
 
-#define COMMAND_BUFFER_SIZE 300
-
-uint8_t fd_control_command_buffer[COMMAND_BUFFER_SIZE];
-
-#define INPUT_BUFFER_SIZE 600
-
-uint8_t fd_control_input_buffer[INPUT_BUFFER_SIZE];
-uint32_t fd_control_input_buffer_count;
-
-typedef struct {
-    fd_detour_source_collection_t *detour_source_collection;
-    uint32_t length;
-} fd_control_input_t;
-
-#define INPUTS_SIZE 16
-
-fd_control_input_t fd_control_inputs[INPUTS_SIZE];
-uint32_t fd_control_inputs_count;
-
-#define DETOUR_BUFFER_SIZE 300
-
-fd_detour_source_t fd_control_detour_source;
-uint8_t fd_control_detour_buffer[DETOUR_BUFFER_SIZE];
-fd_binary_t fd_control_detour_binary;
-
 void fd_control_initialize_commands(void);
-void fd_control_command(void);
-
-fd_control_command_t fd_control_commands[256];
-
-fd_control_callback_t fd_control_before_callback;
-fd_control_callback_t fd_control_after_callback;
-
-void fd_control_initialize(void) {
-    fd_detour_source_initialize(&fd_control_detour_source);
 
-    fd_control_input_buffer_count = 0;
-    fd_control_inputs_count = 0;
+// per command statistics (for command codes below the limit)
+#define STATISTICS_LIMIT 64
 
-    memset(fd_control_commands, 0, sizeof(fd_control_commands));
-    fd_control_initialize_commands();
-
-    fd_event_add_callback(FD_EVENT_COMMAND, fd_control_command);
+typedef struct {
+    uint32_t count;
+    uint64_t cycles;
+} fd_control_statistics_t;
 
-    fd_control_before_callback = 0;
-    fd_control_after_callback = 0;
-}
+static fd_control_statistics_t fd_control_statistics[STATISTICS_LIMIT];
+static uint32_t fd_control_statistics_start;
 
-void fd_control_set_command(uint8_t code, fd_control_command_t command) {
-    fd_control_commands[code] = command;
+static
+void fd_control_statistics_before(uint8_t code __attribute__((unused))) {
+    fd_control_statistics_start = fd_hal_timing_get_timestamp();
 }
 
-void fd_control_process(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length) {
-    if (fd_control_inputs_count >= INPUTS_SIZE) {
-        return;
-    }
-    if ((fd_control_input_buffer_count + length) >= INPUT_BUFFER_SIZE) {
-        return;
+static
+void fd_control_statistics_after(uint8_t code) {
+    uint32_t cycles = fd_hal_timing_get_timestamp() - fd_control_statistics_start;
+    if (code < STATISTICS_LIMIT) {
+        fd_control_statistics_t *statistics = &fd_control_statistics[code];
+        ++statistics->count;
+        statistics->cycles += cycles;
     }
-
-    fd_control_input_t *input = &fd_control_inputs[fd_control_inputs_count];
-    input->detour_source_collection = detour_source_collection;
-    input->length = length;
-
-    memcpy(&fd_control_input_buffer[fd_control_input_buffer_count], data, length);
-    fd_control_input_buffer_count += length;
-
-    ++fd_control_inputs_count;
-
-    fd_event_set(FD_EVENT_COMMAND);
 }
 
-void fd_control_detour_supplier(uint32_t offset, uint8_t *data, uint32_t length) {
-    memcpy(data, &fd_control_detour_buffer[offset], length);
-}
+static void fd_control_initialize_properties(void);
 
-fd_binary_t *fd_control_send_start(fd_detour_source_collection_t *detour_source_collection __attribute__((unused)), uint8_t type) {
-    fd_binary_initialize(&fd_control_detour_binary, fd_control_detour_buffer, DETOUR_BUFFER_SIZE);
-    fd_binary_put_uint8(&fd_control_detour_binary, type);
-    return &fd_control_detour_binary;
-}
+void fd_control_initialize(void) {
+    fd_control_queue_initialize();
+    fd_control_initialize_commands();
+    fd_control_initialize_properties();
 
-void fd_control_send_complete(fd_detour_source_collection_t *detour_source_collection) {
-    fd_detour_source_set(&fd_control_detour_source, fd_control_detour_supplier, fd_control_detour_binary.put_index);
-    bool result = fd_detour_source_collection_push(detour_source_collection, &fd_control_detour_source);
-    if (!result) {
-        fd_log_assert_fail("");
-    }
+    memset(fd_control_statistics, 0, sizeof(fd_control_statistics));
+    fd_control_before_callback = fd_control_statistics_before;
+    fd_control_after_callback = fd_control_statistics_after;
 }
 
 void fd_control_ping(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length) {
@@ -215,7 +172,7 @@ void fd_control_reset(fd_detour_source_collection_t *detour_source_collection __
     fd_hal_reset_by(type);
 }
 
-void fd_control_get_property_version(fd_binary_t *binary) {
+void fd_control_get_property_version(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     fd_version_revision_t version;
     fd_hal_system_get_firmware_version(FD_HAL_SYSTEM_AREA_APPLICATION, &version);
     fd_binary_put_uint16(binary, version.major);
@@ -225,11 +182,11 @@ void fd_control_get_property_version(fd_binary_t *binary) {
     fd_binary_put_bytes(binary, version.commit, FD_VERSION_COMMIT_SIZE);
 }
 
-void fd_control_get_property_hardware_id(fd_binary_t *binary) {
+void fd_control_get_property_hardware_id(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     fd_hal_processor_get_hardware_id(binary);
 }
 
-void fd_control_get_property_site(fd_binary_t *binary) {
+void fd_control_get_property_site(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     uint8_t *site = 0;
     uint16_t site_length = 0;
     uint8_t *address = fd_hal_processor_get_provision_map_address();
@@ -241,40 +198,40 @@ void fd_control_get_property_site(fd_binary_t *binary) {
     fd_binary_put_bytes(binary, site, site_length);
 }
 
-void fd_control_get_property_reset(fd_binary_t *binary) {
+void fd_control_get_property_reset(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     fd_binary_put_uint32(binary, fd_hal_reset_last.cause);
     fd_binary_put_time64(binary, fd_hal_reset_last.time);
 }
 
-void fd_control_get_property_retained(fd_binary_t *binary) {
+void fd_control_get_property_retained(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     fd_binary_put_uint8(binary, fd_hal_reset_retained_was_valid_on_startup());
     fd_binary_put_uint32(binary, sizeof(fd_hal_reset_retained_at_initialize));
     fd_binary_put_bytes(binary, (uint8_t *)&fd_hal_reset_retained_at_initialize, sizeof(fd_hal_reset_retained_at_initialize));
 }
 
-void fd_control_get_property_storage(fd_binary_t *binary) {
+void fd_control_get_property_storage(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     fd_binary_put_uint32(binary, fd_storage_used_page_count());
 }
 
-void fd_control_get_property_debug_lock(fd_binary_t *binary) {
+void fd_control_get_property_debug_lock(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     fd_binary_put_uint8(binary, fd_hal_processor_get_debug_lock());
 }
 
-void fd_control_set_property_debug_lock(fd_binary_t *binary __attribute__((unused))) {
+void fd_control_set_property_debug_lock(fd_binary_t *binary __attribute__((unused)), fd_lock_owner_t owner __attribute__((unused))) {
     fd_hal_processor_set_debug_lock();
 }
 
-void fd_control_get_property_rtc(fd_binary_t *binary) {
+void fd_control_get_property_rtc(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     fd_time_t time = fd_hal_rtc_get_time();
     fd_binary_put_time64(binary, time);
 }
 
-void fd_control_set_property_rtc(fd_binary_t *binary) {
+void fd_control_set_property_rtc(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     fd_time_t time = fd_binary_get_time64(binary);
     fd_hal_rtc_set_time(time);
 }
 
-void fd_control_get_property_power(fd_binary_t *binary) {
+void fd_control_get_property_power(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     fd_power_t power;
     fd_power_get(&power);
     fd_binary_put_float32(binary, power.battery_level);
@@ -285,30 +242,30 @@ void fd_control_get_property_power(fd_binary_t *binary) {
     fd_binary_put_float32(binary, power.temperature);
 }
 
-void fd_control_set_property_power(fd_binary_t *binary) {
+void fd_control_set_property_power(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     float battery_level = fd_binary_get_float32(binary);
     fd_power_set(battery_level);
 }
 
-void fd_control_get_property_mode(fd_binary_t *binary) {
+void fd_control_get_property_mode(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     fd_binary_put_uint8(binary, fd_main_get_mode());
 }
 
-void fd_control_set_property_mode(fd_binary_t *binary) {
+void fd_control_set_property_mode(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     uint8_t mode = fd_binary_get_uint8(binary);
     fd_main_set_mode(mode);
 }
 
-void fd_control_get_property_tx_power(fd_binary_t *binary) {
+void fd_control_get_property_tx_power(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     fd_binary_put_uint8(binary, fd_bluetooth_get_tx_power());
 }
 
-void fd_control_set_property_tx_power(fd_binary_t *binary) {
+void fd_control_set_property_tx_power(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     uint8_t level = fd_binary_get_uint8(binary);
     fd_bluetooth_set_tx_power(level);
 }
 
-void fd_control_get_property_boot_version(fd_binary_t *binary) {
+void fd_control_get_property_boot_version(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     fd_version_revision_t version;
     fd_hal_system_get_firmware_version(FD_HAL_SYSTEM_AREA_BOOTLOADER, &version);
     fd_binary_put_uint16(binary, version.major);
@@ -318,23 +275,23 @@ void fd_control_get_property_boot_version(fd_binary_t *binary) {
     fd_binary_put_bytes(binary, version.commit, FD_VERSION_COMMIT_SIZE);
 }
 
-void fd_control_get_property_regulator(fd_binary_t *binary) {
+void fd_control_get_property_regulator(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     bool switching = fd_hal_system_get_regulator();
     fd_binary_put_uint8(binary, switching ? 1 : 0);
 }
 
-void fd_control_set_property_regulator(fd_binary_t *binary) {
+void fd_control_set_property_regulator(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     bool switching = fd_binary_get_uint8(binary) != 0;
     fd_hal_system_set_regulator(switching);
 }
 
-void fd_control_get_property_logging(fd_binary_t *binary) {
+void fd_control_get_property_logging(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     fd_binary_put_uint32(binary, FD_CONTROL_LOGGING_STATE | FD_CONTROL_LOGGING_COUNT);
     fd_binary_put_uint32(binary, fd_log_get_storage() ? FD_CONTROL_LOGGING_STORAGE : 0);
     fd_binary_put_uint32(binary, fd_log_get_count());
 }
 
-void fd_control_set_property_logging(fd_binary_t *binary) {
+void fd_control_set_property_logging(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     uint32_t flags = fd_binary_get_uint32(binary);
     if (flags & FD_CONTROL_LOGGING_STATE) {
         uint32_t state = fd_binary_get_uint32(binary);
@@ -355,7 +312,7 @@ uint32_t fd_control_get_name(uint8_t **name) {
     return length;
 }
 
-void fd_control_get_property_name(fd_binary_t *binary) {
+void fd_control_get_property_name(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
 //    uint8_t *name;
 //    uint8_t length = fd_control_get_name(&name);
     uint8_t name[20];
@@ -366,13 +323,7 @@ void fd_control_get_property_name(fd_binary_t *binary) {
 
 typedef struct {
     fd_provision_t base;
-    uint16_t map_entries;
-    uint8_t key_length;
-    uint8_t value_type;
-    uint16_t value_length;
-    uint16_t key_value_offset;
-    uint8_t key[4];
-    uint8_t value[20];
+    uint8_t map[2 + 6 + 4 + 20];
 } fd_provision_name_t;
 
 static void fd_control_set_name(uint8_t *data, uint32_t length) {
@@ -380,19 +331,16 @@ static void fd_control_set_name(uint8_t *data, uint32_t length) {
     provision.base.version = 1;
     provision.base.flags = 0;
     memset(provision.base.key, 0, FD_HAL_AES_KEY_SIZE);
-    provision.map_entries = 1;
-    provision.key_length = 4;
-    provision.value_type = FD_MAP_TYPE_UTF8;
-    provision.value_length = length;
-    provision.key_value_offset = 0;
-    memcpy(provision.key, "name", 4);
-    memcpy(provision.value, data, length);
-    fd_hal_processor_write_user_data((uint8_t *)&provision, sizeof(provision));
+    fd_map_entry_t entries[] = {
+        { .key = "name", .type = FD_MAP_TYPE_UTF8, .value = data, .length = length },
+    };
+    uint32_t map_size = fd_map_build(entries, 1, provision.map, sizeof(provision.map));
+    fd_hal_processor_write_user_data((uint8_t *)&provision, sizeof(provision.base) + map_size);
 
     fd_bluetooth_set_name(data, length);
 }
 
-void fd_control_set_property_name(fd_binary_t *binary) {
+void fd_control_set_property_name(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     uint8_t name[20];
     uint8_t length = fd_binary_get_uint8(binary);
     if (length > sizeof(name)) {
@@ -402,12 +350,12 @@ void fd_control_set_property_name(fd_binary_t *binary) {
     fd_control_set_name(name, length);
 }
 
-void fd_control_get_property_adc_vdd(fd_binary_t *binary __attribute__((unused))) {
+void fd_control_get_property_adc_vdd(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
 //    fd_binary_put_float16(binary, fd_adc_get_vdd());
     fd_binary_put_float16(binary, fd_hal_system_get_regulated_voltage());
 }
 
-void fd_control_set_property_adc_vdd(fd_binary_t *binary __attribute__((unused))) {
+void fd_control_set_property_adc_vdd(fd_binary_t *binary __attribute__((unused)), fd_lock_owner_t owner __attribute__((unused))) {
 //    fd_adc_set_vdd(fd_binary_get_float16(binary));
 }
 
@@ -421,7 +369,7 @@ void fd_control_set_property_indicate(fd_binary_t *binary, fd_lock_owner_t owner
     fd_hal_ui_set_indicate(owner, indicate);
 }
 
-void fd_control_get_property_hardware_version(fd_binary_t *binary) {
+void fd_control_get_property_hardware_version(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     fd_version_hardware_t version;
     fd_hal_system_get_hardware_version(&version);
     fd_binary_put_uint16(binary, version.major);
@@ -430,173 +378,174 @@ void fd_control_get_property_hardware_version(fd_binary_t *binary) {
 
 #ifndef FD_NO_SENSING
 
-void fd_control_get_property_sensing_count(fd_binary_t *binary) {
+void fd_control_get_property_sensing_count(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     uint32_t count = fd_sensing_get_stream_sample_count();
     fd_binary_put_uint32(binary, count);
 }
 
-void fd_control_set_property_sensing_count(fd_binary_t *binary) {
+void fd_control_set_property_sensing_count(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     uint32_t count = fd_binary_get_uint32(binary);
     fd_sensing_set_stream_sample_count(count);
 }
 
-void fd_control_get_property_recognition(fd_binary_t *binary) {
+void fd_control_get_property_recognition(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     fd_binary_put_uint8(binary, fd_recognition_get_enable());
 }
 
-void fd_control_set_property_recognition(fd_binary_t *binary) {
+void fd_control_set_property_recognition(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
     bool enable = fd_binary_get_uint8(binary) != 0;
     fd_recognition_set_enable(enable);
 }
 
+void fd_control_get_property_sensing_rate(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
+    fd_binary_put_uint32(binary, fd_sensing_get_sample_rate());
+    fd_binary_put_uint8(binary, fd_sensing_get_adaptive() ? 1 : 0);
+    fd_binary_put_uint32(binary, fd_sensing_get_active_sample_rate());
+}
+
+// the rate is limited to 200 Hz (get returns the rate actually used)
+void fd_control_set_property_sensing_rate(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
+    uint32_t rate = fd_binary_get_uint32(binary);
+    bool adaptive = fd_binary_get_uint8(binary) != 0;
+    fd_sensing_set_sample_rate(rate, adaptive);
+}
+
+void fd_control_get_property_sensing_history(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
+    fd_binary_put_uint32(binary, fd_sensing_get_history_length());
+}
+
+// the pre-trigger sample count is limited to the ring capacity (get returns the length actually used)
+void fd_control_set_property_sensing_history(fd_binary_t *binary, fd_lock_owner_t owner __attribute__((unused))) {
+    uint32_t length = fd_binary_get_uint32(binary);
+    fd_sensing_set_history_length(length);
+}
+
+#endif
+
+typedef void (*fd_control_property_function_t)(fd_binary_t *binary, fd_lock_owner_t owner);
+
+typedef struct {
+    fd_control_property_function_t get;
+    fd_control_property_function_t set;
+} fd_control_property_t;
+
+#define FD_CONTROL_PROPERTY_INDEX(property) __builtin_ctz(property)
+
+// indexed by property bit number
+static const fd_control_property_t fd_control_properties[32] = {
+    [FD_CONTROL_PROPERTY_INDEX(FD_CONTROL_PROPERTY_VERSION)] = {
+        fd_control_get_property_version, 0
+    },
+    [FD_CONTROL_PROPERTY_INDEX(FD_CONTROL_PROPERTY_HARDWARE_ID)] = {
+        fd_control_get_property_hardware_id, 0
+    },
+    [FD_CONTROL_PROPERTY_INDEX(FD_CONTROL_PROPERTY_DEBUG_LOCK)] = {
+        fd_control_get_property_debug_lock, fd_control_set_property_debug_lock
+    },
+    [FD_CONTROL_PROPERTY_INDEX(FD_CONTROL_PROPERTY_RTC)] = {
+        fd_control_get_property_rtc, fd_control_set_property_rtc
+    },
+    [FD_CONTROL_PROPERTY_INDEX(FD_CONTROL_PROPERTY_POWER)] = {
+        fd_control_get_property_power, fd_control_set_property_power
+    },
+    [FD_CONTROL_PROPERTY_INDEX(FD_CONTROL_PROPERTY_SITE)] = {
+        fd_control_get_property_site, 0
+    },
+    [FD_CONTROL_PROPERTY_INDEX(FD_CONTROL_PROPERTY_RESET)] = {
+        fd_control_get_property_reset, 0
+    },
+    [FD_CONTROL_PROPERTY_INDEX(FD_CONTROL_PROPERTY_STORAGE)] = {
+        fd_control_get_property_storage, 0
+    },
+    [FD_CONTROL_PROPERTY_INDEX(FD_CONTROL_PROPERTY_MODE)] = {
+        fd_control_get_property_mode, fd_control_set_property_mode
+    },
+    [FD_CONTROL_PROPERTY_INDEX(FD_CONTROL_PROPERTY_TX_POWER)] = {
+        fd_control_get_property_tx_power, fd_control_set_property_tx_power
+    },
+    [FD_CONTROL_PROPERTY_INDEX(FD_CONTROL_PROPERTY_BOOT_VERSION)] = {
+        fd_control_get_property_boot_version, 0
+    },
+    [FD_CONTROL_PROPERTY_INDEX(FD_CONTROL_PROPERTY_LOGGING)] = {
+        fd_control_get_property_logging, fd_control_set_property_logging
+    },
+    [FD_CONTROL_PROPERTY_INDEX(FD_CONTROL_PROPERTY_NAME)] = {
+        fd_control_get_property_name, fd_control_set_property_name
+    },
+    [FD_CONTROL_PROPERTY_INDEX(FD_CONTROL_PROPERTY_RETAINED)] = {
+        fd_control_get_property_retained, 0
+    },
+    [FD_CONTROL_PROPERTY_INDEX(FD_CONTROL_PROPERTY_ADC_VDD)] = {
+        fd_control_get_property_adc_vdd, fd_control_set_property_adc_vdd
+    },
+    [FD_CONTROL_PROPERTY_INDEX(FD_CONTROL_PROPERTY_REGULATOR)] = {
+        fd_control_get_property_regulator, fd_control_set_property_regulator
+    },
+#ifndef FD_NO_SENSING
+    [FD_CONTROL_PROPERTY_INDEX(FD_CONTROL_PROPERTY_SENSING_COUNT)] = {
+        fd_control_get_property_sensing_count, fd_control_set_property_sensing_count
+    },
+    [FD_CONTROL_PROPERTY_INDEX(FD_CONTROL_PROPERTY_RECOGNITION)] = {
+        fd_control_get_property_recognition, fd_control_set_property_recognition
+    },
+    [FD_CONTROL_PROPERTY_INDEX(FD_CONTROL_PROPERTY_SENSING_RATE)] = {
+        fd_control_get_property_sensing_rate, fd_control_set_property_sensing_rate
+    },
+    [FD_CONTROL_PROPERTY_INDEX(FD_CONTROL_PROPERTY_SENSING_HISTORY)] = {
+        fd_control_get_property_sensing_history, fd_control_set_property_sensing_history
+    },
 #endif
+    [FD_CONTROL_PROPERTY_INDEX(FD_CONTROL_PROPERTY_INDICATE)] = {
+        fd_control_get_property_indicate, fd_control_set_property_indicate
+    },
+    [FD_CONTROL_PROPERTY_INDEX(FD_CONTROL_PROPERTY_HARDWARE_VERSION)] = {
+        fd_control_get_property_hardware_version, 0
+    },
+};
+
+// masks of the properties that have a getter or setter
+static uint32_t fd_control_get_property_mask;
+static uint32_t fd_control_set_property_mask;
 
-#define GET_PROPERTY_MASK \
- (FD_CONTROL_PROPERTY_VERSION |\
- FD_CONTROL_PROPERTY_HARDWARE_ID |\
- FD_CONTROL_PROPERTY_DEBUG_LOCK |\
- FD_CONTROL_PROPERTY_RTC |\
- FD_CONTROL_PROPERTY_POWER |\
- FD_CONTROL_PROPERTY_SITE |\
- FD_CONTROL_PROPERTY_RESET |\
- FD_CONTROL_PROPERTY_STORAGE |\
- FD_CONTROL_PROPERTY_MODE |\
- FD_CONTROL_PROPERTY_TX_POWER |\
- FD_CONTROL_PROPERTY_BOOT_VERSION |\
- FD_CONTROL_PROPERTY_LOGGING |\
- FD_CONTROL_PROPERTY_NAME |\
- FD_CONTROL_PROPERTY_RETAINED |\
- FD_CONTROL_PROPERTY_REGULATOR |\
- FD_CONTROL_PROPERTY_SENSING_COUNT |\
- FD_CONTROL_PROPERTY_INDICATE |\
- FD_CONTROL_PROPERTY_RECOGNITION |\
- FD_CONTROL_PROPERTY_HARDWARE_VERSION)
+static
+void fd_control_initialize_properties(void) {
+    fd_control_get_property_mask = 0;
+    fd_control_set_property_mask = 0;
+    for (uint32_t i = 0; i < 32; ++i) {
+        const fd_control_property_t *property = &fd_control_properties[i];
+        if (property->get) {
+            fd_control_get_property_mask |= 1 << i;
+        }
+        if (property->set) {
+            fd_control_set_property_mask |= 1 << i;
+        }
+    }
+}
 
 void fd_control_get_properties(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length) {
     fd_binary_t binary;
     fd_binary_initialize(&binary, data, length);
-    uint32_t properties = fd_binary_get_uint32(&binary);
+    uint32_t properties = fd_binary_get_uint32(&binary) & fd_control_get_property_mask;
 
     fd_binary_t *binary_out = fd_control_send_start(detour_source_collection, FD_CONTROL_GET_PROPERTIES);
-    fd_binary_put_uint32(binary_out, properties & GET_PROPERTY_MASK);
-    for (uint32_t property = 1; property != 0; property <<= 1) {
-        if (property & properties) {
-            switch (property) {
-                case FD_CONTROL_PROPERTY_VERSION: {
-                    fd_control_get_property_version(binary_out);
-                } break;
-                case FD_CONTROL_PROPERTY_HARDWARE_ID: {
-                    fd_control_get_property_hardware_id(binary_out);
-                } break;
-                case FD_CONTROL_PROPERTY_DEBUG_LOCK: {
-                    fd_control_get_property_debug_lock(binary_out);
-                } break;
-                case FD_CONTROL_PROPERTY_RTC: {
-                    fd_control_get_property_rtc(binary_out);
-                } break;
-                case FD_CONTROL_PROPERTY_POWER: {
-                    fd_control_get_property_power(binary_out);
-                } break;
-                case FD_CONTROL_PROPERTY_SITE: {
-                    fd_control_get_property_site(binary_out);
-                } break;
-                case FD_CONTROL_PROPERTY_RESET: {
-                    fd_control_get_property_reset(binary_out);
-                } break;
-                case FD_CONTROL_PROPERTY_STORAGE: {
-                    fd_control_get_property_storage(binary_out);
-                } break;
-                case FD_CONTROL_PROPERTY_MODE: {
-                    fd_control_get_property_mode(binary_out);
-                } break;
-                case FD_CONTROL_PROPERTY_TX_POWER: {
-                    fd_control_get_property_tx_power(binary_out);
-                } break;
-                case FD_CONTROL_PROPERTY_BOOT_VERSION: {
-                    fd_control_get_property_boot_version(binary_out);
-                } break;
-                case FD_CONTROL_PROPERTY_LOGGING: {
-                    fd_control_get_property_logging(binary_out);
-                } break;
-                case FD_CONTROL_PROPERTY_NAME: {
-                    fd_control_get_property_name(binary_out);
-                } break;
-                case FD_CONTROL_PROPERTY_RETAINED: {
-                    fd_control_get_property_retained(binary_out);
-                } break;
-                case FD_CONTROL_PROPERTY_ADC_VDD: {
-                    fd_control_get_property_adc_vdd(binary_out);
-                } break;
-                case FD_CONTROL_PROPERTY_REGULATOR: {
-                    fd_control_get_property_regulator(binary_out);
-                } break;
-#ifndef FD_NO_SENSING
-                case FD_CONTROL_PROPERTY_SENSING_COUNT: {
-                    fd_control_get_property_sensing_count(binary_out);
-                } break;
-                case FD_CONTROL_PROPERTY_RECOGNITION: {
-                    fd_control_get_property_recognition(binary_out);
-                } break;
-#endif
-                case FD_CONTROL_PROPERTY_INDICATE: {
-                    fd_control_get_property_indicate(binary_out, detour_source_collection->owner);
-                } break;
-                case FD_CONTROL_PROPERTY_HARDWARE_VERSION: {
-                    fd_control_get_property_hardware_version(binary_out);
-                } break;
-            }
-        }
+    fd_binary_put_uint32(binary_out, properties);
+    // properties are put in bit order (lowest first)
+    while (properties) {
+        uint32_t index = FD_CONTROL_PROPERTY_INDEX(properties);
+        properties &= properties - 1;
+        fd_control_properties[index].get(binary_out, detour_source_collection->owner);
     }
     fd_control_send_complete(detour_source_collection);
 }
 
-void fd_control_set_properties(fd_detour_source_collection_t *detour_source_collection __attribute__((unused)), uint8_t *data, uint32_t length) {
+void fd_control_set_properties(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length) {
     fd_binary_t binary;
     fd_binary_initialize(&binary, data, length);
-    uint32_t properties = fd_binary_get_uint32(&binary);
-    for (uint32_t property = 1; property != 0; property <<= 1) {
-        if (property & properties) {
-            switch (property) {
-                case FD_CONTROL_PROPERTY_DEBUG_LOCK: {
-                    fd_control_set_property_debug_lock(&binary);
-                } break;
-                case FD_CONTROL_PROPERTY_RTC: {
-                    fd_control_set_property_rtc(&binary);
-                } break;
-                case FD_CONTROL_PROPERTY_POWER: {
-                    fd_control_set_property_power(&binary);
-                } break;
-                case FD_CONTROL_PROPERTY_MODE: {
-                    fd_control_set_property_mode(&binary);
-                } break;
-                case FD_CONTROL_PROPERTY_TX_POWER: {
-                    fd_control_set_property_tx_power(&binary);
-                } break;
-                case FD_CONTROL_PROPERTY_LOGGING: {
-                    fd_control_set_property_logging(&binary);
-                } break;
-                case FD_CONTROL_PROPERTY_NAME: {
-                    fd_control_set_property_name(&binary);
-                } break;
-                case FD_CONTROL_PROPERTY_ADC_VDD: {
-                    fd_control_set_property_adc_vdd(&binary);
-                } break;
-                case FD_CONTROL_PROPERTY_REGULATOR: {
-                    fd_control_set_property_regulator(&binary);
-                } break;
-#ifndef FD_NO_SENSING
-                case FD_CONTROL_PROPERTY_SENSING_COUNT: {
-                    fd_control_set_property_sensing_count(&binary);
-                } break;
-                case FD_CONTROL_PROPERTY_RECOGNITION: {
-                    fd_control_set_property_recognition(&binary);
-                } break;
-#endif
-                case FD_CONTROL_PROPERTY_INDICATE: {
-                    fd_control_set_property_indicate(&binary, detour_source_collection->owner);
-                } break;
-            }
-        }
+    uint32_t properties = fd_binary_get_uint32(&binary) & fd_control_set_property_mask;
+    while (properties) {
+        uint32_t index = FD_CONTROL_PROPERTY_INDEX(properties);
+        properties &= properties - 1;
+        fd_control_properties[index].set(&binary, detour_source_collection->owner);
     }
 }
 
@@ -876,6 +825,14 @@ void fd_control_identify(fd_detour_source_collection_t *detour_source_collection
     }
 }
 
+// sync data is sent as a control response so that it is queued when the detour source collection is full
+// (which lets the host pipeline sync start requests using the ahead offset)
+void fd_control_sync_start(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length) {
+    fd_binary_t *binary_out = fd_control_send_start(detour_source_collection, FD_CONTROL_SYNC_DATA);
+    fd_sync_put(binary_out, data, length);
+    fd_control_send_complete(detour_source_collection);
+}
+
 void fd_control_lock(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length) {
     fd_binary_t binary;
     fd_binary_initialize(&binary, data, length);
@@ -891,7 +848,49 @@ void fd_control_lock(fd_detour_source_collection_t *detour_source_collection, ui
     fd_control_send_complete(detour_source_collection);
 }
 
-#define FD_CONTROL_DIAGNOSTICS_FLAGS (FD_CONTROL_DIAGNOSTICS_BLE | FD_CONTROL_DIAGNOSTICS_BLE_TIMING)
+#define FD_CONTROL_DIAGNOSTICS_FLAGS (FD_CONTROL_DIAGNOSTICS_BLE | FD_CONTROL_DIAGNOSTICS_BLE_TIMING | FD_CONTROL_DIAGNOSTICS_ACCELEROMETER | FD_CONTROL_DIAGNOSTICS_TIMER | FD_CONTROL_DIAGNOSTICS_ACCOUNTING | FD_CONTROL_DIAGNOSTICS_COMMANDS | FD_CONTROL_DIAGNOSTICS_TIMING)
+
+// puts the statistics for as many commands as will fit
+static
+void fd_control_statistics_diagnostics(fd_binary_t *binary) {
+    uint32_t length_index = binary->put_index;
+    fd_binary_put_uint32(binary, 0 /* length of following bytes */);
+    fd_binary_put_uint32(binary, 1 /* version */);
+    uint32_t n_index = binary->put_index;
+    fd_binary_put_uint8(binary, 0);
+    uint32_t n = 0;
+    for (uint32_t code = 0; code < STATISTICS_LIMIT; ++code) {
+        fd_control_statistics_t *statistics = &fd_control_statistics[code];
+        if (statistics->count == 0) {
+            continue;
+        }
+        if (binary->put_index + 1 + 4 + 8 > binary->size) {
+            break;
+        }
+        fd_binary_put_uint8(binary, code);
+        fd_binary_put_uint32(binary, statistics->count);
+        fd_binary_put_uint64(binary, statistics->cycles);
+        ++n;
+    }
+    if (binary->put_index <= binary->size) {
+        binary->buffer[n_index] = n;
+        fd_binary_pack_uint32(&binary->buffer[length_index], binary->put_index - length_index - 4);
+    }
+}
+
+static
+fd_timing_iterator_t fd_control_timing_iterator(uint8_t source) {
+    switch (source) {
+        case FD_CONTROL_DIAGNOSTICS_TIMING_EVENT:
+            return fd_event_timing_iterator();
+        case FD_CONTROL_DIAGNOSTICS_TIMING_EVENT_LATENCY:
+            return fd_event_latency_iterator();
+        case FD_CONTROL_DIAGNOSTICS_TIMING_TIMER:
+            return fd_timer_timing_iterator();
+    }
+    fd_timing_iterator_t iterator = fd_timing_iterator_nil();
+    return iterator;
+}
 
 void fd_control_diagnostics(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length) {
     fd_binary_t binary;
@@ -906,9 +905,61 @@ void fd_control_diagnostics(fd_detour_source_collection_t *detour_source_collect
     if (flags & FD_CONTROL_DIAGNOSTICS_BLE_TIMING) {
         fd_bluetooth_diagnostics_timing(binary_out);
     }
+    if (flags & FD_CONTROL_DIAGNOSTICS_ACCELEROMETER) {
+        fd_hal_accelerometer_diagnostics(binary_out);
+    }
+    if (flags & FD_CONTROL_DIAGNOSTICS_TIMER) {
+        fd_timer_diagnostics(binary_out);
+    }
+    if (flags & FD_CONTROL_DIAGNOSTICS_ACCOUNTING) {
+        fd_accounting_diagnostics(binary_out);
+    }
+    if (flags & FD_CONTROL_DIAGNOSTICS_COMMANDS) {
+        fd_control_statistics_diagnostics(binary_out);
+    }
+    if (flags & FD_CONTROL_DIAGNOSTICS_TIMING) {
+        // timing histograms go last so that they can use whatever space is left in the response
+        uint8_t source = fd_binary_get_uint8(&binary);
+        uint16_t index = fd_binary_get_uint16(&binary);
+        fd_timing_iterator_t iterator = fd_control_timing_iterator(source);
+        fd_timing_diagnostics(&iterator, index, binary_out);
+    }
+    fd_control_send_complete(detour_source_collection);
+}
+
+// The command is uint8 version, uint8 flags, uint16 packet size (0 for the largest the transport allows).
+// The response is uint8 version, uint8 flags, uint16 packet size, uint16 maximum packet size for the format in
+// use from now on (the response itself is already in the new format).
+void fd_control_detour_format(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length) {
+    fd_binary_t binary;
+    fd_binary_initialize(&binary, data, length);
+    uint8_t version = fd_binary_get_uint8(&binary);
+    uint8_t flags = fd_binary_get_uint8(&binary);
+    uint16_t packet_size = fd_binary_get_uint16(&binary);
+
+    fd_detour_source_collection_set_format(detour_source_collection, version, flags, packet_size);
+
+    fd_binary_t *binary_out = fd_control_send_start(detour_source_collection, FD_CONTROL_DETOUR_FORMAT);
+    fd_binary_put_uint8(binary_out, detour_source_collection->version);
+    fd_binary_put_uint8(binary_out, detour_source_collection->flags);
+    fd_binary_put_uint16(binary_out, detour_source_collection->packetSize);
+    fd_binary_put_uint16(binary_out, detour_source_collection->packetSizeMaximum);
     fd_control_send_complete(detour_source_collection);
 }
 
+#ifdef FD_TRACE
+void fd_control_trace(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length) {
+    fd_binary_t binary;
+    fd_binary_initialize(&binary, data, length);
+    uint8_t operation = fd_binary_get_uint8(&binary);
+    uint16_t index = fd_binary_get_uint16(&binary);
+
+    fd_binary_t *binary_out = fd_control_send_start(detour_source_collection, FD_CONTROL_TRACE);
+    fd_trace_read(operation, index, binary_out);
+    fd_control_send_complete(detour_source_collection);
+}
+#endif
+
 void fd_control_initialize_commands(void) {
     fd_control_commands[FD_CONTROL_PING] = fd_control_ping;
     fd_control_commands[FD_CONTROL_GET_PROPERTIES] = fd_control_get_properties;
@@ -939,69 +990,16 @@ void fd_control_initialize_commands(void) {
     fd_control_commands[FD_CONTROL_DISCONNECT] = fd_control_disconnect;
     fd_control_commands[FD_CONTROL_LED_OVERRIDE] = fd_control_led_override;
     fd_control_commands[FD_CONTROL_IDENTIFY] = fd_control_identify;
-    fd_control_commands[FD_CONTROL_SYNC_START] = fd_sync_start;
+    fd_control_commands[FD_CONTROL_SYNC_START] = fd_control_sync_start;
     fd_control_commands[FD_CONTROL_SYNC_ACK] = fd_sync_ack;
     fd_control_commands[FD_CONTROL_LOCK] = fd_control_lock;
     fd_control_commands[FD_CONTROL_DIAGNOSTICS] = fd_control_diagnostics;
+    fd_control_commands[FD_CONTROL_DETOUR_FORMAT] = fd_control_detour_format;
+    fd_control_commands[FD_CONTROL_DUMP] = fd_dump;
+#ifdef FD_TRACE
+    fd_control_commands[FD_CONTROL_TRACE] = fd_control_trace;
+#endif
 #ifndef FD_NO_SENSING
     fd_control_commands[FD_CONTROL_SENSING_SYNTHESIZE] = fd_sensing_synthesize;
 #endif
-}
-
-// !!! should we encrypt/decrypt everything? or just syncs? or just things that modify? -denis
-
-void fd_control_process_command(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length) {
-    if (length < 1) {
-        return;
-    }
-    uint8_t code = data[0];
-    fd_control_command_t command = fd_control_commands[code];
-    if (command) {
-        if (fd_control_before_callback) {
-            fd_control_before_callback(code);
-        }
-        (*command)(detour_source_collection, &data[1], length - 1);
-        if (fd_control_after_callback) {
-            fd_control_after_callback(code);
-        }
-    }
-}
-
-void fd_control_command(void) {
-    int count;
-    fd_detour_source_collection_t *detour_source_collection = 0;
-    uint32_t length = 0;
-
-    fd_hal_processor_interrupts_disable();
-    count = fd_control_inputs_count;
-    if (count > 0) {
-        // get the command info
-        fd_control_input_t *input = &fd_control_inputs[0];
-        detour_source_collection = input->detour_source_collection;
-        uint32_t input_length = input->length;
-        if (input_length <= sizeof(fd_control_command_buffer)) {
-            length = input_length;
-            memcpy(fd_control_command_buffer, fd_control_input_buffer, input_length);
-        } else {
-            // to much data from the detour source to fit in the command buffer, so just ignore it -denis
-            fd_log_assert_fail("command buffer size exceeded");
-            length = 0;
-        }
-
-        // remove it from the inputs
-        --fd_control_inputs_count;
-        memmove(fd_control_inputs, &fd_control_inputs[1], sizeof(fd_control_input_t) * fd_control_inputs_count);
-        fd_control_input_buffer_count -= input_length;
-        memmove(fd_control_input_buffer, &fd_control_input_buffer[input_length], fd_control_input_buffer_count);
-    }
-    fd_hal_processor_interrupts_enable();
-
-    if (count > 0) {
-        // process it
-        fd_control_process_command(detour_source_collection, fd_control_command_buffer, length);
-    }
-
-    if (count > 1) {
-        fd_event_set_exclusive(FD_EVENT_COMMAND);
-    }
-}
+}
\ No newline at end of file
@@ -19,6 +19,22 @@ uint32_t fd_control_get_name(uint8_t **name);
 
 void fd_control_process(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length);
 
+// queue a FD_CONTROL_DETOUR_RESUME message (uint8 sequence number) asking the host to resend a detour from the
+// given chunk (in order with the responses to commands received before).  The host sends the same message when it
+// loses a chunk of a response, and the last response pushed to the collection is pushed again from that chunk.
+void fd_control_detour_resume(fd_detour_source_collection_t *detour_source_collection, uint32_t sequence_number);
+
+// A stream pushes detour sources of its own (such as a storage dump) whenever there is room in its collection
+// and no queued responses are waiting for it.  It returns false once it is done.  Starting a stream replaces
+// any stream already running.
+typedef bool (*fd_control_stream_t)(fd_detour_source_collection_t *detour_source_collection);
+
+void fd_control_stream_start(fd_detour_source_collection_t *detour_source_collection, fd_control_stream_t stream);
+
+// Drops the commands, responses and stream for a collection whose transport has gone away (such as a BLE
+// disconnect), so they do not hold the response pool or go to the next host that connects.
+void fd_control_release(fd_detour_source_collection_t *detour_source_collection);
+
 typedef void (*fd_control_callback_t)(uint8_t code);
 
 extern fd_control_callback_t fd_control_before_callback;
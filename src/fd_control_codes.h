@@ -51,13 +51,36 @@
 
 #define FD_CONTROL_HARDWARE 32
 
+#define FD_CONTROL_TRACE 33
+
+#define FD_CONTROL_DETOUR_FORMAT 34
+#define FD_CONTROL_DETOUR_RESUME 35
+
+#define FD_CONTROL_DUMP 36
+
 /* end of firefly ice control codes */
 
 #define FD_CONTROL_DIAGNOSTICS_BLE        0x00000001
 #define FD_CONTROL_DIAGNOSTICS_BLE_TIMING 0x00000002
+#define FD_CONTROL_DIAGNOSTICS_ACCELEROMETER 0x00000004
+#define FD_CONTROL_DIAGNOSTICS_TIMER 0x00000008
+#define FD_CONTROL_DIAGNOSTICS_TIMING 0x00000010
+#define FD_CONTROL_DIAGNOSTICS_ACCOUNTING 0x00000020
+#define FD_CONTROL_DIAGNOSTICS_COMMANDS 0x00000040
+
+#define FD_CONTROL_DIAGNOSTICS_TIMING_EVENT 0
+#define FD_CONTROL_DIAGNOSTICS_TIMING_EVENT_LATENCY 1
+#define FD_CONTROL_DIAGNOSTICS_TIMING_TIMER 2
 
 #define FD_CONTROL_SYNC_AHEAD 0x00000001
 
+#define FD_CONTROL_DUMP_RANGE_PAGES 0
+#define FD_CONTROL_DUMP_RANGE_AREA 1
+
+#define FD_CONTROL_DUMP_PAGE 0
+#define FD_CONTROL_DUMP_COMPLETE 1
+#define FD_CONTROL_DUMP_ABORTED 2
+
 #define FD_CONTROL_LOGGING_STATE 0x00000001
 #define FD_CONTROL_LOGGING_COUNT 0x00000002
 
@@ -94,6 +117,8 @@
 #define FD_CONTROL_CAPABILITY_UPDATE_AREA      0x00002000
 #define FD_CONTROL_CAPABILITY_RTC              0x00004000
 #define FD_CONTROL_CAPABILITY_HARDWARE         0x00004000
+#define FD_CONTROL_CAPABILITY_SENSING_RATE     0x00008000
+#define FD_CONTROL_CAPABILITY_SENSING_HISTORY  0x00010000
 
 // property bits for get/set property commands
 #define FD_CONTROL_PROPERTY_VERSION          0x00000001
@@ -116,5 +141,7 @@
 #define FD_CONTROL_PROPERTY_INDICATE         0x00020000
 #define FD_CONTROL_PROPERTY_RECOGNITION      0x00040000
 #define FD_CONTROL_PROPERTY_HARDWARE_VERSION 0x00080000
+#define FD_CONTROL_PROPERTY_SENSING_RATE     0x00100000
+#define FD_CONTROL_PROPERTY_SENSING_HISTORY  0x00200000
 
 #endif
\ No newline at end of file
@@ -0,0 +1,464 @@
+#include "fd_binary.h"
+#include "fd_control.h"
+#include "fd_control_codes.h"
+#include "fd_control_queue.h"
+#include "fd_detour.h"
+#include "fd_event.h"
+#include "fd_hal_processor.h"
+#include "fd_log.h"
+
+#include <string.h>
+
+// Commands from the transports are queued and processed one at a time from the event loop.  The responses are
+// queued too, and pushed to the detour source collections of the transports as they take packets.
+
+#define COMMAND_BUFFER_SIZE 300
+
+uint8_t fd_control_command_buffer[COMMAND_BUFFER_SIZE];
+
+#define INPUT_BUFFER_SIZE 600
+
+uint8_t fd_control_input_buffer[INPUT_BUFFER_SIZE];
+uint32_t fd_control_input_buffer_count;
+
+typedef struct {
+    fd_detour_source_collection_t *detour_source_collection;
+    uint32_t length;
+    // the input is the sequence number for a resume message instead of a command
+    bool resume;
+} fd_control_input_t;
+
+#define INPUTS_SIZE 16
+
+fd_control_input_t fd_control_inputs[INPUTS_SIZE];
+uint32_t fd_control_inputs_count;
+
+#define DETOUR_BUFFER_SIZE 300
+
+// Responses are built in a small pool so that the next command can be processed while earlier responses
+// are still waiting for room in their detour source collection.  Queued responses are pushed in order
+// (per collection) as the transport takes packets from the collection.
+#define RESPONSES_SIZE 3
+
+typedef enum {
+    fd_control_response_state_free,
+    fd_control_response_state_building,
+    fd_control_response_state_queued,
+    // pushed, but kept in case the host asks for part of it again (see fd_control_detour_resume_command)
+    fd_control_response_state_sent
+} fd_control_response_state_t;
+
+typedef struct {
+    fd_control_response_state_t state;
+    uint32_t sequence;
+    fd_detour_source_collection_t *detour_source_collection;
+    fd_detour_source_t detour_source;
+    // queued again from this version 1 chunk (when not 0) after the host asked for it
+    uint32_t resume_sequence_number;
+    // collection packet size and push count when it was sent (so a resume request can be matched to it)
+    uint32_t sent_packet_size;
+    uint32_t sent_push_count;
+    fd_binary_t binary;
+    uint8_t buffer[DETOUR_BUFFER_SIZE];
+} fd_control_response_t;
+
+fd_control_response_t fd_control_responses[RESPONSES_SIZE];
+fd_control_response_t *fd_control_response_building;
+fd_control_response_t *fd_control_response_pushing;
+uint32_t fd_control_response_sequence;
+
+fd_control_stream_t fd_control_stream;
+fd_detour_source_collection_t *fd_control_stream_collection;
+
+fd_control_command_t fd_control_commands[256];
+
+fd_control_callback_t fd_control_before_callback;
+fd_control_callback_t fd_control_after_callback;
+
+void fd_control_command(void);
+static void fd_control_detour_resume_command(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length);
+
+void fd_control_queue_initialize(void) {
+    for (uint32_t i = 0; i < RESPONSES_SIZE; ++i) {
+        fd_control_response_t *response = &fd_control_responses[i];
+        response->state = fd_control_response_state_free;
+        response->sequence = 0;
+        response->detour_source_collection = 0;
+        fd_detour_source_initialize(&response->detour_source);
+        response->resume_sequence_number = 0;
+        response->sent_packet_size = 0;
+        response->sent_push_count = 0;
+    }
+    fd_control_response_building = 0;
+    fd_control_response_pushing = 0;
+    fd_control_response_sequence = 0;
+    fd_control_stream = 0;
+    fd_control_stream_collection = 0;
+
+    fd_control_input_buffer_count = 0;
+    fd_control_inputs_count = 0;
+
+    memset(fd_control_commands, 0, sizeof(fd_control_commands));
+    fd_control_commands[FD_CONTROL_DETOUR_RESUME] = fd_control_detour_resume_command;
+
+    fd_event_add_callback(FD_EVENT_COMMAND, fd_control_command);
+    fd_control_before_callback = 0;
+    fd_control_after_callback = 0;
+}
+
+void fd_control_set_command(uint8_t code, fd_control_command_t command) {
+    fd_control_commands[code] = command;
+}
+
+static
+void fd_control_input(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length, bool resume) {
+    if (fd_control_inputs_count >= INPUTS_SIZE) {
+        return;
+    }
+    if ((fd_control_input_buffer_count + length) >= INPUT_BUFFER_SIZE) {
+        return;
+    }
+
+    fd_control_input_t *input = &fd_control_inputs[fd_control_inputs_count];
+    input->detour_source_collection = detour_source_collection;
+    input->length = length;
+    input->resume = resume;
+
+    memcpy(&fd_control_input_buffer[fd_control_input_buffer_count], data, length);
+    fd_control_input_buffer_count += length;
+
+    ++fd_control_inputs_count;
+
+    fd_event_set(FD_EVENT_COMMAND);
+}
+
+void fd_control_process(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length) {
+    fd_control_input(detour_source_collection, data, length, false);
+}
+
+void fd_control_detour_resume(fd_detour_source_collection_t *detour_source_collection, uint32_t sequence_number) {
+    uint8_t data[] = {sequence_number};
+    fd_control_input(detour_source_collection, data, sizeof(data), true);
+}
+
+void fd_control_detour_supplier(uint32_t offset, uint8_t *data, uint32_t length) {
+    memcpy(data, &fd_control_response_pushing->buffer[offset], length);
+}
+
+// a response can be started if there is a free (or sent) one, or if a queued response can be dropped to make room
+// (which is only done when none of the queued responses are for the given collection, so a transport that
+// has stopped taking packets can not hold up commands from other transports)
+static
+bool fd_control_response_available(fd_detour_source_collection_t *detour_source_collection) {
+    bool queued = false;
+    for (uint32_t i = 0; i < RESPONSES_SIZE; ++i) {
+        fd_control_response_t *response = &fd_control_responses[i];
+        if ((response->state == fd_control_response_state_free) || (response->state == fd_control_response_state_sent)) {
+            return true;
+        }
+        if ((response->state == fd_control_response_state_queued) && (response->detour_source_collection == detour_source_collection)) {
+            queued = true;
+        }
+    }
+    return !queued;
+}
+
+static
+fd_control_response_t *fd_control_response_oldest(fd_control_response_state_t state) {
+    fd_control_response_t *oldest = 0;
+    for (uint32_t i = 0; i < RESPONSES_SIZE; ++i) {
+        fd_control_response_t *response = &fd_control_responses[i];
+        if (response->state != state) {
+            continue;
+        }
+        if ((oldest == 0) || ((int32_t)(response->sequence - oldest->sequence) < 0)) {
+            oldest = response;
+        }
+    }
+    return oldest;
+}
+
+// a free response, or else a sent one (which can no longer be resumed), or else the oldest queued one is dropped
+static
+fd_control_response_t *fd_control_response_allocate(void) {
+    fd_control_response_t *response = fd_control_response_oldest(fd_control_response_state_free);
+    if (response == 0) {
+        response = fd_control_response_oldest(fd_control_response_state_sent);
+    }
+    if (response == 0) {
+        fd_log_assert_fail("response dropped");
+        response = fd_control_response_oldest(fd_control_response_state_queued);
+    }
+    return response;
+}
+
+static
+bool fd_control_response_push(fd_control_response_t *response) {
+    fd_detour_source_collection_t *detour_source_collection = response->detour_source_collection;
+    fd_detour_source_set(&response->detour_source, fd_control_detour_supplier, response->binary.put_index);
+    if (response->resume_sequence_number != 0) {
+        fd_detour_source_resume(&response->detour_source, detour_source_collection->packetSize, response->resume_sequence_number);
+    }
+    fd_control_response_pushing = response;
+    bool result = fd_detour_source_collection_push(detour_source_collection, &response->detour_source);
+    fd_control_response_pushing = 0;
+    if (!result && (detour_source_collection->bufferCount == 0)) {
+        // will never fit in the collection buffer
+        fd_log_assert_fail("");
+        return true;
+    }
+    return result;
+}
+
+// Only the last thing pushed to a version 1 collection with resume can be resumed (the chunk sequence numbers in a
+// resume request do not say which message they are for), so a response is kept until something else is pushed.
+static
+void fd_control_response_sent(fd_control_response_t *response) {
+    fd_detour_source_collection_t *detour_source_collection = response->detour_source_collection;
+    response->resume_sequence_number = 0;
+    if ((detour_source_collection->version == 1) && (detour_source_collection->flags & FD_DETOUR_FLAG_RESUME)) {
+        response->state = fd_control_response_state_sent;
+        response->sent_packet_size = detour_source_collection->packetSize;
+        response->sent_push_count = detour_source_collection->pushCount;
+    } else {
+        response->state = fd_control_response_state_free;
+        response->detour_source_collection = 0;
+    }
+}
+
+// the stream goes after any responses queued for its collection
+static
+void fd_control_stream_continue(fd_detour_source_collection_t **blocked, uint32_t blocked_count) {
+    if (fd_control_stream == 0) {
+        return;
+    }
+    for (uint32_t i = 0; i < blocked_count; ++i) {
+        if (blocked[i] == fd_control_stream_collection) {
+            return;
+        }
+    }
+    if (!fd_control_stream(fd_control_stream_collection)) {
+        fd_control_stream = 0;
+        fd_control_stream_collection = 0;
+    }
+}
+
+// push queued responses (oldest first) until each collection is full
+static
+void fd_control_responses_flush(void) {
+    fd_control_response_t *queued[RESPONSES_SIZE];
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < RESPONSES_SIZE; ++i) {
+        fd_control_response_t *response = &fd_control_responses[i];
+        if (response->state != fd_control_response_state_queued) {
+            continue;
+        }
+        uint32_t j = count++;
+        for (; (j > 0) && ((int32_t)(response->sequence - queued[j - 1]->sequence) < 0); --j) {
+            queued[j] = queued[j - 1];
+        }
+        queued[j] = response;
+    }
+    if (count == 0) {
+        fd_control_stream_continue(0, 0);
+        return;
+    }
+
+    fd_detour_source_collection_t *blocked[RESPONSES_SIZE];
+    uint32_t blocked_count = 0;
+    bool freed = false;
+    for (uint32_t i = 0; i < count; ++i) {
+        fd_control_response_t *response = queued[i];
+        bool is_blocked = false;
+        for (uint32_t j = 0; j < blocked_count; ++j) {
+            if (blocked[j] == response->detour_source_collection) {
+                is_blocked = true;
+                break;
+            }
+        }
+        if (is_blocked) {
+            continue;
+        }
+        if (fd_control_response_push(response)) {
+            fd_control_response_sent(response);
+            freed = true;
+        } else {
+            blocked[blocked_count++] = response->detour_source_collection;
+        }
+    }
+
+    if (freed && (fd_control_inputs_count > 0)) {
+        // commands may have been waiting for a free response
+        fd_event_set(FD_EVENT_COMMAND);
+    }
+
+    fd_control_stream_continue(blocked, blocked_count);
+}
+
+// The host lost a chunk of the last response pushed to the collection:  push it again from that chunk (the host
+// ignores the chunks after the lost one that are still in the collection).
+static
+void fd_control_detour_resume_command(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length) {
+    fd_binary_t binary;
+    fd_binary_initialize(&binary, data, length);
+    uint8_t sequence_number = fd_binary_get_uint8(&binary);
+    if (binary.flags & FD_BINARY_FLAG_OUT_OF_BOUNDS) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < RESPONSES_SIZE; ++i) {
+        fd_control_response_t *response = &fd_control_responses[i];
+        if (
+            (response->state != fd_control_response_state_sent) ||
+            (response->detour_source_collection != detour_source_collection) ||
+            (response->sent_push_count != detour_source_collection->pushCount) ||
+            (response->sent_packet_size != detour_source_collection->packetSize) ||
+            (detour_source_collection->version != 1)
+        ) {
+            continue;
+        }
+        if (fd_detour_source_resume(&response->detour_source, detour_source_collection->packetSize, sequence_number)) {
+            // keeps its sequence, so it goes ahead of any responses queued since
+            response->state = fd_control_response_state_queued;
+            response->resume_sequence_number = sequence_number;
+            fd_control_responses_flush();
+        }
+        return;
+    }
+}
+
+void fd_control_stream_start(fd_detour_source_collection_t *detour_source_collection, fd_control_stream_t stream) {
+    fd_control_stream = stream;
+    fd_control_stream_collection = detour_source_collection;
+    detour_source_collection->space_callback = fd_control_responses_flush;
+    fd_control_responses_flush();
+}
+
+void fd_control_release(fd_detour_source_collection_t *detour_source_collection) {
+    fd_hal_processor_interrupts_disable();
+    uint32_t count = 0;
+    uint32_t buffer_count = 0;
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < fd_control_inputs_count; ++i) {
+        fd_control_input_t *input = &fd_control_inputs[i];
+        uint32_t length = input->length;
+        if (input->detour_source_collection != detour_source_collection) {
+            memmove(&fd_control_input_buffer[buffer_count], &fd_control_input_buffer[offset], length);
+            buffer_count += length;
+            fd_control_inputs[count++] = *input;
+        }
+        offset += length;
+    }
+    fd_control_inputs_count = count;
+    fd_control_input_buffer_count = buffer_count;
+    fd_hal_processor_interrupts_enable();
+
+    for (uint32_t i = 0; i < RESPONSES_SIZE; ++i) {
+        fd_control_response_t *response = &fd_control_responses[i];
+        if ((response->state == fd_control_response_state_building) || (response->detour_source_collection != detour_source_collection)) {
+            continue;
+        }
+        response->state = fd_control_response_state_free;
+        response->detour_source_collection = 0;
+        response->resume_sequence_number = 0;
+    }
+
+    if (fd_control_stream_collection == detour_source_collection) {
+        fd_control_stream = 0;
+        fd_control_stream_collection = 0;
+    }
+
+    if (fd_control_inputs_count > 0) {
+        // commands from other transports may have been waiting for a free response
+        fd_event_set(FD_EVENT_COMMAND);
+    }
+}
+
+fd_binary_t *fd_control_send_start(fd_detour_source_collection_t *detour_source_collection __attribute__((unused)), uint8_t type) {
+    fd_control_response_t *response = fd_control_response_allocate();
+    response->state = fd_control_response_state_building;
+    response->detour_source_collection = 0;
+    fd_control_response_building = response;
+    fd_binary_initialize(&response->binary, response->buffer, DETOUR_BUFFER_SIZE);
+    fd_binary_put_uint8(&response->binary, type);
+    return &response->binary;
+}
+
+void fd_control_send_complete(fd_detour_source_collection_t *detour_source_collection) {
+    fd_control_response_t *response = fd_control_response_building;
+    fd_control_response_building = 0;
+    response->state = fd_control_response_state_queued;
+    response->sequence = ++fd_control_response_sequence;
+    response->detour_source_collection = detour_source_collection;
+    detour_source_collection->space_callback = fd_control_responses_flush;
+    fd_control_responses_flush();
+}
+
+// !!! should we encrypt/decrypt everything? or just syncs? or just things that modify? -denis
+
+void fd_control_process_command(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length) {
+    if (length < 1) {
+        return;
+    }
+    uint8_t code = data[0];
+    fd_control_command_t command = fd_control_commands[code];
+    if (command) {
+        if (fd_control_before_callback) {
+            fd_control_before_callback(code);
+        }
+        (*command)(detour_source_collection, &data[1], length - 1);
+        if (fd_control_after_callback) {
+            fd_control_after_callback(code);
+        }
+    }
+}
+
+void fd_control_command(void) {
+    int count;
+    fd_detour_source_collection_t *detour_source_collection = 0;
+    uint32_t length = 0;
+    bool resume = false;
+
+    fd_hal_processor_interrupts_disable();
+    count = fd_control_inputs_count;
+    if ((count > 0) && !fd_control_response_available(fd_control_inputs[0].detour_source_collection)) {
+        // wait for a queued response to be pushed (which sets the command event again)
+        count = 0;
+    }
+    if (count > 0) {
+        // get the command info
+        fd_control_input_t *input = &fd_control_inputs[0];
+        detour_source_collection = input->detour_source_collection;
+        resume = input->resume;
+        uint32_t input_length = input->length;
+        if (input_length <= sizeof(fd_control_command_buffer)) {
+            length = input_length;
+            memcpy(fd_control_command_buffer, fd_control_input_buffer, input_length);
+        } else {
+            // to much data from the detour source to fit in the command buffer, so just ignore it -denis
+            fd_log_assert_fail("command buffer size exceeded");
+            length = 0;
+        }
+
+        // remove it from the inputs
+        --fd_control_inputs_count;
+        memmove(fd_control_inputs, &fd_control_inputs[1], sizeof(fd_control_input_t) * fd_control_inputs_count);
+        fd_control_input_buffer_count -= input_length;
+        memmove(fd_control_input_buffer, &fd_control_input_buffer[input_length], fd_control_input_buffer_count);
+    }
+    fd_hal_processor_interrupts_enable();
+
+    if ((count > 0) && resume) {
+        fd_binary_t *binary_out = fd_control_send_start(detour_source_collection, FD_CONTROL_DETOUR_RESUME);
+        fd_binary_put_uint8(binary_out, fd_control_command_buffer[0]);
+        fd_control_send_complete(detour_source_collection);
+    } else
+    if (count > 0) {
+        // process it
+        fd_control_process_command(detour_source_collection, fd_control_command_buffer, length);
+    }
+
+    if (count > 1) {
+        fd_event_set_exclusive(FD_EVENT_COMMAND);
+    }
+}
\ No newline at end of file
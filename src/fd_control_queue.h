@@ -0,0 +1,15 @@
+#ifndef FD_CONTROL_QUEUE_H
+#define FD_CONTROL_QUEUE_H
+
+#include "fd_control.h"
+
+// the command input queue, response pool and streams used by fd_control (see fd_control.h for the interface)
+
+extern fd_control_command_t fd_control_commands[256];
+
+// clears the queues and the command table (fd_control_initialize then sets the commands)
+void fd_control_queue_initialize(void);
+
+void fd_control_process_command(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length);
+
+#endif
\ No newline at end of file
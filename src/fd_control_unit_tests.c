@@ -0,0 +1,190 @@
+#include "fd_binary.h"
+#include "fd_control.h"
+#include "fd_control_codes.h"
+#include "fd_control_queue.h"
+#include "fd_detour.h"
+#include "fd_event.h"
+#include "fd_log.h"
+
+// tests of the fd_control command and response queues (with a test command, the fd_control commands are not used)
+
+#define FD_CONTROL_TEST_COMMAND 0xf0
+#define FD_CONTROL_TEST_PACKET_SIZE 20
+
+static fd_detour_source_collection_t fd_control_test_collection;
+static uint8_t fd_control_test_collection_data[4 * FD_CONTROL_TEST_PACKET_SIZE];
+static fd_detour_t fd_control_test_detour;
+static uint8_t fd_control_test_detour_data[300];
+static uint32_t fd_control_test_command_count;
+
+static
+uint8_t fd_control_test_byte(uint32_t offset) {
+    return (uint8_t)(offset * 5 + 1);
+}
+
+static
+void fd_control_test_supplier(uint32_t offset, uint8_t *data, uint32_t length) {
+    for (uint32_t i = 0; i < length; ++i) {
+        data[i] = fd_control_test_byte(offset + i);
+    }
+}
+
+// the response is the command followed by the request data
+static
+void fd_control_test_command(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length) {
+    ++fd_control_test_command_count;
+    fd_binary_t *binary_out = fd_control_send_start(detour_source_collection, FD_CONTROL_TEST_COMMAND);
+    fd_binary_put_bytes(binary_out, data, length);
+    fd_control_send_complete(detour_source_collection);
+}
+
+static
+void fd_control_test_request(uint32_t length) {
+    uint8_t data[80];
+    data[0] = FD_CONTROL_TEST_COMMAND;
+    for (uint32_t i = 1; i < length; ++i) {
+        data[i] = fd_control_test_byte(i);
+    }
+    fd_control_process(&fd_control_test_collection, data, length);
+    while (fd_event_process_pending());
+}
+
+static
+void fd_control_test_resume(uint32_t sequence_number) {
+    uint8_t data[] = {FD_CONTROL_DETOUR_RESUME, sequence_number};
+    fd_control_process(&fd_control_test_collection, data, sizeof(data));
+    while (fd_event_process_pending());
+}
+
+// take the next packet from the collection and give it to the host detour (unless it is lost)
+static
+bool fd_control_test_transfer(bool lost) {
+    uint8_t packet[FD_CONTROL_TEST_PACKET_SIZE];
+    if (!fd_detour_source_collection_get(&fd_control_test_collection, packet)) {
+        return false;
+    }
+    if (!lost) {
+        fd_detour_event(&fd_control_test_detour, packet, sizeof(packet));
+    }
+    return true;
+}
+
+static uint32_t fd_control_test_stream_count;
+
+static
+bool fd_control_test_stream(fd_detour_source_collection_t *detour_source_collection __attribute__((unused))) {
+    ++fd_control_test_stream_count;
+    return true;
+}
+
+static
+bool fd_control_test_received(uint32_t length) {
+    if (fd_detour_state(&fd_control_test_detour) != fd_detour_state_success) {
+        return false;
+    }
+    if ((fd_control_test_detour.length != length) || (fd_control_test_detour.data[0] != FD_CONTROL_TEST_COMMAND)) {
+        return false;
+    }
+    for (uint32_t i = 1; i < length; ++i) {
+        if (fd_control_test_detour.data[i] != fd_control_test_byte(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void fd_control_unit_tests(void) {
+    fd_event_initialize();
+    fd_control_queue_initialize();
+    fd_control_set_command(FD_CONTROL_TEST_COMMAND, fd_control_test_command);
+
+    fd_detour_source_collection_initialize(&fd_control_test_collection, 0, FD_CONTROL_TEST_PACKET_SIZE, fd_control_test_collection_data, sizeof(fd_control_test_collection_data));
+    fd_log_assert(fd_detour_source_collection_set_format(&fd_control_test_collection, 1, FD_DETOUR_FLAG_RESUME, FD_CONTROL_TEST_PACKET_SIZE));
+    fd_detour_initialize(&fd_control_test_detour, fd_control_test_detour_data, sizeof(fd_control_test_detour_data));
+    fd_detour_set_resume(&fd_control_test_detour, true);
+
+    // a 60 byte response is 4 packets (17 + 19 + 19 + 5):  the second one is lost, the host asks for it again, and
+    // the response is pushed again from there
+    fd_control_test_request(60);
+    fd_log_assert(fd_control_test_collection.bufferCount == 4 * FD_CONTROL_TEST_PACKET_SIZE);
+    fd_log_assert(fd_control_test_transfer(false));
+    fd_log_assert(fd_control_test_transfer(true));
+    while (fd_control_test_transfer(false));
+    uint32_t sequence_number;
+    fd_log_assert(fd_detour_get_nack(&fd_control_test_detour, &sequence_number) && (sequence_number == 1));
+    fd_control_test_resume(sequence_number);
+    fd_log_assert(fd_control_test_collection.bufferCount == 3 * FD_CONTROL_TEST_PACKET_SIZE);
+    while (fd_control_test_transfer(false));
+    fd_log_assert(fd_control_test_received(60));
+    fd_detour_clear(&fd_control_test_detour);
+
+    // the next response is received as usual
+    fd_control_test_request(30);
+    while (fd_control_test_transfer(false));
+    fd_log_assert(fd_control_test_received(30));
+    fd_detour_clear(&fd_control_test_detour);
+
+    // once something else has been pushed to the collection the response can not be resumed (the request could be
+    // for the other source)
+    fd_detour_source_t source;
+    fd_detour_source_initialize(&source);
+    fd_detour_source_set(&source, fd_control_test_supplier, 10);
+    fd_log_assert(fd_detour_source_collection_push(&fd_control_test_collection, &source));
+    while (fd_control_test_transfer(false));
+    fd_detour_clear(&fd_control_test_detour);
+    fd_control_test_resume(1);
+    fd_log_assert(fd_control_test_collection.bufferCount == 0);
+
+    // a chunk past the end of the response is ignored
+    fd_control_test_request(30);
+    while (fd_control_test_transfer(false));
+    fd_detour_clear(&fd_control_test_detour);
+    fd_control_test_resume(3);
+    fd_log_assert(fd_control_test_collection.bufferCount == 0);
+
+    // commands are pipelined on one collection:  while its oldest response is still queued a later command runs as
+    // soon as any response is free
+    fd_detour_clear(&fd_control_test_detour);
+    fd_control_test_command_count = 0;
+    for (uint32_t i = 0; i < 5; ++i) {
+        fd_control_test_request(60);
+    }
+    // one response in the collection and the others queued, the fifth command waits for a response
+    fd_log_assert(fd_control_test_command_count == 4);
+    for (uint32_t i = 0; i < 4; ++i) {
+        fd_log_assert(fd_control_test_transfer(false));
+    }
+    while (fd_event_process_pending());
+    fd_log_assert(fd_control_test_command_count == 5);
+    uint32_t received = 0;
+    while (fd_control_test_transfer(false)) {
+        if (fd_detour_state(&fd_control_test_detour) == fd_detour_state_success) {
+            fd_log_assert(fd_control_test_received(60));
+            fd_detour_clear(&fd_control_test_detour);
+            ++received;
+        }
+    }
+    fd_log_assert(received == 4);
+
+    // without resume the responses are not kept
+    fd_detour_source_collection_clear(&fd_control_test_collection);
+    fd_control_test_request(30);
+    while (fd_control_test_transfer(false));
+    fd_control_test_resume(1);
+    fd_log_assert(fd_control_test_collection.bufferCount == 0);
+    fd_detour_clear(&fd_control_test_detour);
+
+    // releasing a collection drops the response and stream waiting for it
+    fd_control_test_request(60);
+    fd_control_test_request(30);
+    fd_control_test_stream_count = 0;
+    fd_control_stream_start(&fd_control_test_collection, fd_control_test_stream);
+    fd_log_assert(fd_control_test_stream_count == 0);
+    fd_detour_source_collection_clear(&fd_control_test_collection);
+    fd_control_release(&fd_control_test_collection);
+    fd_control_test_request(40);
+    fd_log_assert(fd_control_test_collection.bufferCount == 3 * FD_CONTROL_TEST_PACKET_SIZE);
+    while (fd_control_test_transfer(false));
+    fd_log_assert(fd_control_test_received(40));
+    fd_log_assert(fd_control_test_stream_count == 0);
+}
\ No newline at end of file
@@ -7,10 +7,8 @@
 void fd_detour_initialize(fd_detour_t *detour, uint8_t *data, uint32_t size) {
     detour->data = data;
     detour->size = size;
-    detour->state = fd_detour_state_clear;
-    detour->length = 0;
-    detour->sequence_number = 0;
-    detour->offset = 0;
+    detour->resume = false;
+    fd_detour_clear(detour);
 }
 
 void fd_detour_clear(fd_detour_t *detour) {
@@ -18,6 +16,26 @@ void fd_detour_clear(fd_detour_t *detour) {
     detour->length = 0;
     detour->sequence_number = 0;
     detour->offset = 0;
+    detour->version = 1;
+    detour->length_complete = false;
+    detour->length_shift = 0;
+    detour->pending = 0;
+    detour->pending_length = 0;
+    detour->resuming = false;
+    detour->nack = false;
+}
+
+void fd_detour_set_resume(fd_detour_t *detour, bool resume) {
+    detour->resume = resume;
+}
+
+bool fd_detour_get_nack(fd_detour_t *detour, uint32_t *sequence_number) {
+    if (!detour->nack) {
+        return false;
+    }
+    detour->nack = false;
+    *sequence_number = detour->sequence_number;
+    return true;
 }
 
 fd_detour_state_t fd_detour_state(fd_detour_t *detour) {
@@ -29,6 +47,19 @@ void fd_detour_error(fd_detour_t *detour) {
     detour->state = fd_detour_state_error;
 }
 
+// returns true if the chunk out of sequence can be ignored (the sender is asked to resume from the expected one)
+static
+bool fd_detour_gap(fd_detour_t *detour) {
+    if (!detour->resume) {
+        return false;
+    }
+    if (!detour->resuming) {
+        detour->resuming = true;
+        detour->nack = true;
+    }
+    return true;
+}
+
 static
 void fd_detour_continue(fd_detour_t *detour, uint8_t *data, uint32_t length) {
     uint32_t total = detour->offset + length;
@@ -52,6 +83,8 @@ void fd_detour_start(fd_detour_t *detour, uint8_t *data, uint32_t length) {
         return;
     }
     detour->state = fd_detour_state_intermediate;
+    detour->version = 1;
+    detour->resuming = false;
     detour->length = fd_binary_unpack_uint16(&data[0]);
     detour->sequence_number = 0;
     detour->offset = 0;
@@ -62,11 +95,97 @@ void fd_detour_start(fd_detour_t *detour, uint8_t *data, uint32_t length) {
     fd_detour_continue(detour, &data[2], length - 2);
 }
 
+// parse version 2 messages from the data of a chunk (stopping when one completes)
+static
+void fd_detour_v2_parse(fd_detour_t *detour, uint8_t *data, uint32_t length) {
+    while (length > 0) {
+        if (detour->state == fd_detour_state_clear) {
+            if (data[0] == 0) {
+                // padding
+                return;
+            }
+            detour->state = fd_detour_state_intermediate;
+            detour->length = 0;
+            detour->offset = 0;
+            detour->length_complete = false;
+            detour->length_shift = 0;
+        }
+
+        if (!detour->length_complete) {
+            uint8_t byte = *data++;
+            --length;
+            if (detour->length_shift > 28) {
+                fd_detour_error(detour);
+                return;
+            }
+            detour->length |= (uint32_t)(byte & 0x7f) << detour->length_shift;
+            detour->length_shift += 7;
+            if ((byte & 0x80) == 0) {
+                detour->length_complete = true;
+                if ((detour->length == 0) || (detour->length > detour->size)) {
+                    fd_detour_error(detour);
+                    return;
+                }
+            }
+            continue;
+        }
+
+        uint32_t n = detour->length - detour->offset;
+        if (n > length) {
+            n = length;
+        }
+        memcpy(&detour->data[detour->offset], data, n);
+        detour->offset += n;
+        data += n;
+        length -= n;
+        if (detour->offset == detour->length) {
+            detour->state = fd_detour_state_success;
+            detour->pending = data;
+            detour->pending_length = length;
+            return;
+        }
+    }
+}
+
+static
+void fd_detour_v2_event(fd_detour_t *detour, uint8_t *data, uint32_t length) {
+    uint8_t header = data[0];
+    uint8_t sequence_number = header & FD_DETOUR_V2_SEQUENCE_MASK;
+    if (detour->state == fd_detour_state_clear) {
+        // wait for a message to start at the beginning of a chunk
+        if ((header & FD_DETOUR_V2_START) == 0) {
+            fd_detour_error(detour);
+            return;
+        }
+    } else
+    if ((detour->version != 2) || (header & FD_DETOUR_V2_START) || (sequence_number != detour->sequence_number)) {
+        bool gap = (detour->version == 2) && ((header & FD_DETOUR_V2_START) == 0) && (detour->state == fd_detour_state_intermediate);
+        if (!gap || !fd_detour_gap(detour)) {
+            fd_detour_error(detour);
+        }
+        return;
+    }
+    detour->version = 2;
+    detour->resuming = false;
+    detour->sequence_number = (sequence_number + 1) & FD_DETOUR_V2_SEQUENCE_MASK;
+    detour->pending = 0;
+    detour->pending_length = 0;
+    fd_detour_v2_parse(detour, &data[1], length - 1);
+}
+
 void fd_detour_event(fd_detour_t *detour, uint8_t *data, uint32_t length) {
     if (length < 1) {
         fd_detour_error(detour);
         return;
     }
+    if (data[0] & FD_DETOUR_V2) {
+        fd_detour_v2_event(detour, data, length);
+        return;
+    }
+    if ((detour->state == fd_detour_state_intermediate) && (detour->version != 1)) {
+        fd_detour_error(detour);
+        return;
+    }
     uint8_t sequence_number = data[0];
     if (sequence_number == 0) {
         if (detour->sequence_number != 0) {
@@ -75,12 +194,28 @@ void fd_detour_event(fd_detour_t *detour, uint8_t *data, uint32_t length) {
         fd_detour_start(detour, &data[1], length - 1);
     } else
     if (sequence_number != detour->sequence_number) {
-        fd_detour_error(detour);
+        if (!fd_detour_gap(detour)) {
+            fd_detour_error(detour);
+        }
     } else {
+        detour->resuming = false;
         fd_detour_continue(detour, &data[1], length - 1);
     }
 }
 
+void fd_detour_next(fd_detour_t *detour) {
+    uint8_t version = detour->version;
+    uint32_t sequence_number = detour->sequence_number;
+    uint8_t *pending = detour->pending;
+    uint32_t pending_length = detour->pending_length;
+    fd_detour_clear(detour);
+    if ((version == 2) && (pending_length > 0)) {
+        detour->version = version;
+        detour->sequence_number = sequence_number;
+        fd_detour_v2_parse(detour, pending, pending_length);
+    }
+}
+
 void fd_detour_source_initialize(fd_detour_source_t *source) {
     source->supplier = 0;
     source->state = fd_detour_state_clear;
@@ -125,29 +260,160 @@ bool fd_detour_source_get(fd_detour_source_t *source, uint8_t *data, uint32_t le
     return true;
 }
 
+bool fd_detour_source_resume(fd_detour_source_t *source, uint32_t packetSize, uint32_t sequence_number) {
+    if ((source->state == fd_detour_state_clear) || (packetSize <= 3)) {
+        return false;
+    }
+    // the first chunk has the uint16 length after the sequence number
+    uint32_t offset = 0;
+    if (sequence_number > 0) {
+        offset = (packetSize - 3) + (sequence_number - 1) * (packetSize - 1);
+        if (offset >= source->length) {
+            return false;
+        }
+    }
+    source->state = fd_detour_state_intermediate;
+    source->sequence_number = sequence_number;
+    source->offset = offset;
+    return true;
+}
+
 void fd_detour_source_collection_initialize(fd_detour_source_collection_t *collection, fd_lock_owner_t owner, uint32_t packetSize, uint8_t *buffer, uint32_t bufferSize) {
     collection->owner = owner;
     collection->packetSize = packetSize;
+    collection->packetSizeMaximum = packetSize;
     collection->buffer = buffer;
     collection->bufferSize = bufferSize;
-    collection->bufferCount = 0;
+    collection->pushCount = 0;
     collection->callback = 0;
+    collection->space_callback = 0;
+    fd_detour_source_collection_clear(collection);
 }
 
-bool fd_detour_source_collection_push(fd_detour_source_collection_t *collection, fd_detour_source_t *source) {
-    bool result = false;
+void fd_detour_source_collection_clear(fd_detour_source_collection_t *collection) {
+    collection->packetSize = collection->packetSizeMaximum;
+    collection->version = 1;
+    collection->flags = 0;
+    collection->sequence_number = 0;
+    collection->packetOffset = 0;
+    collection->bufferCount = 0;
+}
+
+// smallest packet that can hold a version 1 header and some data
+#define FD_DETOUR_PACKET_SIZE_MINIMUM 4
+
+bool fd_detour_source_collection_set_format(fd_detour_source_collection_t *collection, uint8_t version, uint32_t flags, uint32_t packetSize) {
+    if ((collection->bufferCount != 0) || (version < 1) || (version > 2)) {
+        return false;
+    }
+    if ((packetSize == 0) || (packetSize > collection->packetSizeMaximum)) {
+        packetSize = collection->packetSizeMaximum;
+    }
+    if (packetSize < FD_DETOUR_PACKET_SIZE_MINIMUM) {
+        return false;
+    }
+
+    collection->version = version;
+    collection->flags = flags;
+    collection->packetSize = packetSize;
+    collection->packetOffset = 0;
+    return true;
+}
+
+static
+bool fd_detour_source_collection_push_v1(fd_detour_source_collection_t *collection, fd_detour_source_t *source) {
     uint32_t bufferCount = collection->bufferCount;
     while (true) {
+        if (source->state != fd_detour_state_intermediate) {
+            // all packets are in the buffer (checked first so the last packet can fill the buffer)
+            return true;
+        }
         if ((collection->bufferCount + collection->packetSize) > collection->bufferSize) {
             collection->bufferCount = bufferCount;
-            break;
-        }
-        if (!fd_detour_source_get(source, &collection->buffer[collection->bufferCount], collection->packetSize)) {
-            result = true;
-            break;
+            return false;
         }
+        fd_detour_source_get(source, &collection->buffer[collection->bufferCount], collection->packetSize);
         collection->bufferCount += collection->packetSize;
     }
+}
+
+static
+bool fd_detour_source_collection_push_v2(fd_detour_source_collection_t *collection, fd_detour_source_t *source) {
+    if (source->state != fd_detour_state_intermediate) {
+        return true;
+    }
+
+    uint8_t header[5];
+    uint32_t header_length = 0;
+    uint32_t remainder = source->length;
+    do {
+        uint8_t byte = remainder & 0x7f;
+        remainder >>= 7;
+        header[header_length++] = remainder ? (byte | 0x80) : byte;
+    } while (remainder != 0);
+
+    // check that it all fits first (the free end of the last packet is used before starting new packets)
+    uint32_t packetSize = collection->packetSize;
+    uint32_t total = header_length + source->length;
+    uint32_t available = collection->packetOffset ? packetSize - collection->packetOffset : 0;
+    if (total > available) {
+        uint32_t packets = (total - available + packetSize - 2) / (packetSize - 1);
+        if ((collection->bufferCount + packets * packetSize) > collection->bufferSize) {
+            return false;
+        }
+    }
+
+    uint32_t offset = 0;
+    while (offset < total) {
+        if (collection->packetOffset == 0) {
+            uint8_t *packet = &collection->buffer[collection->bufferCount];
+            memset(packet, 0, packetSize);
+            packet[0] = FD_DETOUR_V2 | (collection->sequence_number & FD_DETOUR_V2_SEQUENCE_MASK);
+            if (offset == 0) {
+                packet[0] |= FD_DETOUR_V2_START;
+            }
+            ++collection->sequence_number;
+            collection->bufferCount += packetSize;
+            collection->packetOffset = 1;
+        }
+        uint8_t *packet = &collection->buffer[collection->bufferCount - packetSize];
+        uint32_t n = packetSize - collection->packetOffset;
+        if (n > (total - offset)) {
+            n = total - offset;
+        }
+        while ((n > 0) && (offset < header_length)) {
+            packet[collection->packetOffset++] = header[offset++];
+            --n;
+        }
+        if (n > 0) {
+            (*source->supplier)(offset - header_length, &packet[collection->packetOffset], n);
+            collection->packetOffset += n;
+            offset += n;
+        }
+        if (collection->packetOffset >= packetSize) {
+            collection->packetOffset = 0;
+        }
+    }
+    if ((collection->flags & FD_DETOUR_FLAG_COALESCE) == 0) {
+        // the next message starts a new packet
+        collection->packetOffset = 0;
+    }
+
+    source->offset = source->length;
+    source->state = fd_detour_state_success;
+    return true;
+}
+
+bool fd_detour_source_collection_push(fd_detour_source_collection_t *collection, fd_detour_source_t *source) {
+    bool result;
+    if (collection->version == 2) {
+        result = fd_detour_source_collection_push_v2(collection, source);
+    } else {
+        result = fd_detour_source_collection_push_v1(collection, source);
+    }
+    if (result) {
+        ++collection->pushCount;
+    }
     if (collection->callback) {
         collection->callback();
     }
@@ -161,5 +427,12 @@ bool fd_detour_source_collection_get(fd_detour_source_collection_t *collection,
     memcpy(buffer, collection->buffer, collection->packetSize);
     collection->bufferCount -= collection->packetSize;
     memmove(collection->buffer, &collection->buffer[collection->packetSize], collection->bufferCount);
+    if (collection->bufferCount == 0) {
+        // the last packet is gone, so nothing more can be added to it
+        collection->packetOffset = 0;
+    }
+    if (collection->space_callback) {
+        collection->space_callback();
+    }
     return true;
 }
\ No newline at end of file
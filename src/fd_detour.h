@@ -9,6 +9,19 @@ detour can split and reassemble the arbitrary data into chunks that can be sent
 The first byte of each chunk is a sequence number, with the first chunk indicated by the sequence number 0.
 In the first chunk the sequence number is followed by a uint16 length.  All subsequent data in chunks is
 the content data.  The last chunk can have extra data (which will be ignored).
+
+Version 2 chunks have the high bit of the first byte set (version 1 sequence numbers stay below 0x80).  The
+first byte also has a start bit, set when a message begins right after it, and a 6 bit sequence number that
+counts chunks continuously (not per message).  The rest of the chunk is a stream of messages, each a varint
+(base 128, low bits first) length followed by the content data.  Messages can span chunks, and several
+messages can share a chunk (coalescing).  A zero byte where a length is expected pads out the chunk.
+
+The receiver accepts both versions.  A detour source collection sends version 1 until the host asks for
+version 2 (and its packet size) with fd_detour_source_collection_set_format.
+
+Normally a chunk out of sequence is an error and the whole message is dropped.  With resume enabled the
+receiver instead keeps what it has, ignores chunks until the expected one arrives, and reports the expected
+sequence number (once per gap) so the sender can go back to that chunk (see fd_detour_source_resume).
 */
 
 #include "fd_lock.h"
@@ -23,6 +36,13 @@ typedef enum {
     fd_detour_state_error
 } fd_detour_state_t;
 
+#define FD_DETOUR_V2 0x80
+#define FD_DETOUR_V2_START 0x40
+#define FD_DETOUR_V2_SEQUENCE_MASK 0x3f
+
+#define FD_DETOUR_FLAG_COALESCE 0x01
+#define FD_DETOUR_FLAG_RESUME 0x02
+
 typedef struct {
     uint8_t *data;
     uint32_t size;
@@ -31,6 +51,19 @@ typedef struct {
     uint32_t length;
     uint32_t sequence_number;
     uint32_t offset;
+
+    uint8_t version;
+    // version 2 length (varint) parsing
+    bool length_complete;
+    uint32_t length_shift;
+    // rest of the chunk after a version 2 message completed (see fd_detour_next)
+    uint8_t *pending;
+    uint32_t pending_length;
+
+    bool resume;
+    // waiting for the chunk with sequence_number after a gap, and if the sender still needs to be told
+    bool resuming;
+    bool nack;
 } fd_detour_t;
 
 typedef void (*fd_detour_supplier_t)(uint32_t offset, uint8_t *data, uint32_t length);
@@ -49,10 +82,20 @@ typedef void (*fd_detour_source_callback_t)(void);
 typedef struct {
     fd_lock_owner_t owner;
     uint32_t packetSize;
+    uint32_t packetSizeMaximum;
+    uint8_t version;
+    uint32_t flags;
+    // version 2:  sequence number of the next packet and how much of the last packet is used (0 when closed)
+    uint8_t sequence_number;
+    uint32_t packetOffset;
     uint8_t *buffer;
     uint32_t bufferSize;
     uint32_t bufferCount;
+    // number of sources pushed (so a sender can tell if anything was pushed after its source)
+    uint32_t pushCount;
     fd_detour_source_callback_t callback;
+    // called after a packet is taken from the buffer (so a source that did not fit can be pushed again)
+    fd_detour_source_callback_t space_callback;
 } fd_detour_source_collection_t;
 
 void fd_detour_initialize(fd_detour_t *detour, uint8_t *data, uint32_t size);
@@ -63,14 +106,33 @@ fd_detour_state_t fd_detour_state(fd_detour_t *detour);
 
 void fd_detour_event(fd_detour_t *detour, uint8_t *data, uint32_t length);
 
+// clear the completed message and continue with any messages coalesced into the same chunk (so the state can
+// be success again).  must be called before the chunk passed to fd_detour_event is reused.
+void fd_detour_next(fd_detour_t *detour);
+
+void fd_detour_set_resume(fd_detour_t *detour, bool resume);
+
+// true (once per gap) when the sender should go back to the chunk with the given sequence number
+bool fd_detour_get_nack(fd_detour_t *detour, uint32_t *sequence_number);
+
 void fd_detour_source_initialize(fd_detour_source_t *source);
 
 void fd_detour_source_set(fd_detour_source_t *source, fd_detour_supplier_t supplier, uint32_t length);
 
 bool fd_detour_source_get(fd_detour_source_t *source, uint8_t *data, uint32_t length);
 
+// go back to the version 1 chunk with the given sequence number (so the source can be pushed again from there)
+bool fd_detour_source_resume(fd_detour_source_t *source, uint32_t packetSize, uint32_t sequence_number);
+
 void fd_detour_source_collection_initialize(fd_detour_source_collection_t *collection, fd_lock_owner_t owner, uint32_t packetSize, uint8_t *buffer, uint32_t bufferSize);
 
+// the version (1 or 2), flags and packet size (0 for the maximum) for sources pushed from now on.  returns
+// false (and changes nothing) if packets are still waiting to be sent or the format is not supported.
+bool fd_detour_source_collection_set_format(fd_detour_source_collection_t *collection, uint8_t version, uint32_t flags, uint32_t packetSize);
+
+// drop any waiting packets and go back to the version 1 format (the host went away)
+void fd_detour_source_collection_clear(fd_detour_source_collection_t *collection);
+
 bool fd_detour_source_collection_push(fd_detour_source_collection_t *collection, fd_detour_source_t *source);
 
 bool fd_detour_source_collection_get(fd_detour_source_collection_t *collection, uint8_t *buffer);
@@ -1,6 +1,40 @@
 #include "fd_detour.h"
 #include "fd_log.h"
 
+#include <string.h>
+
+static uint8_t fd_detour_test_source_data[300];
+static uint32_t fd_detour_test_space_count;
+
+static
+void fd_detour_test_supplier(uint32_t offset, uint8_t *data, uint32_t length) {
+    memcpy(data, &fd_detour_test_source_data[offset], length);
+}
+
+static
+void fd_detour_test_space_callback(void) {
+    ++fd_detour_test_space_count;
+}
+
+// take all the packets from the collection and reassemble them, returning the number of packets (the length
+// of each message received is recorded and its content checked against the source data)
+static
+uint32_t fd_detour_test_receive(fd_detour_source_collection_t *collection, fd_detour_t *detour, uint32_t *lengths, uint32_t *count) {
+    uint32_t packets = 0;
+    uint8_t packet[64];
+    while (fd_detour_source_collection_get(collection, packet)) {
+        ++packets;
+        fd_detour_event(detour, packet, collection->packetSize);
+        while (fd_detour_state(detour) == fd_detour_state_success) {
+            fd_log_assert(memcmp(detour->data, fd_detour_test_source_data, detour->length) == 0);
+            lengths[(*count)++] = detour->length;
+            fd_detour_next(detour);
+        }
+        fd_log_assert(fd_detour_state(detour) != fd_detour_state_error);
+    }
+    return packets;
+}
+
 void fd_detour_unit_tests(void) {
     uint8_t bytes[100];
     fd_detour_t detour;
@@ -16,4 +50,162 @@ void fd_detour_unit_tests(void) {
     fd_log_assert(detour.data[19] == 0x14);
     fd_detour_clear(&detour);
     fd_log_assert(fd_detour_state(&detour) == fd_detour_state_clear);
+
+    // a source that does not fit is not pushed, and space is reported as packets are taken
+    uint8_t buffer[40];
+    fd_detour_source_collection_t collection;
+    fd_detour_source_collection_initialize(&collection, 0, 20, buffer, sizeof(buffer));
+    collection.space_callback = fd_detour_test_space_callback;
+    fd_detour_test_space_count = 0;
+    fd_detour_source_t source;
+    fd_detour_source_initialize(&source);
+    fd_detour_source_set(&source, fd_detour_test_supplier, 30);
+    fd_log_assert(fd_detour_source_collection_push(&collection, &source));
+    fd_log_assert(collection.bufferCount == 40);
+    fd_detour_source_set(&source, fd_detour_test_supplier, 10);
+    fd_log_assert(!fd_detour_source_collection_push(&collection, &source));
+    fd_log_assert(collection.bufferCount == 40);
+    uint8_t packet[20];
+    fd_log_assert(fd_detour_source_collection_get(&collection, packet));
+    fd_log_assert(fd_detour_test_space_count == 1);
+    fd_detour_source_set(&source, fd_detour_test_supplier, 10);
+    fd_log_assert(fd_detour_source_collection_push(&collection, &source));
+    fd_log_assert(collection.bufferCount == 40);
+
+    // version 2 with a 2 byte varint length in larger packets:  1 + 2 + 61, then 1 + 63 per packet
+    for (uint32_t i = 0; i < sizeof(fd_detour_test_source_data); ++i) {
+        fd_detour_test_source_data[i] = (uint8_t)(i * 7 + 3);
+    }
+    uint8_t v2_bytes[300];
+    fd_detour_t v2_detour;
+    fd_detour_initialize(&v2_detour, v2_bytes, sizeof(v2_bytes));
+    uint8_t v2_buffer[400];
+    fd_detour_source_collection_t v2_collection;
+    fd_detour_source_collection_initialize(&v2_collection, 0, 64, v2_buffer, sizeof(v2_buffer));
+    fd_log_assert(fd_detour_source_collection_set_format(&v2_collection, 2, 0, 0));
+    fd_log_assert(v2_collection.packetSize == 64);
+    fd_detour_source_set(&source, fd_detour_test_supplier, 300);
+    fd_log_assert(fd_detour_source_collection_push(&v2_collection, &source));
+    fd_log_assert(v2_buffer[0] == (FD_DETOUR_V2 | FD_DETOUR_V2_START | 0));
+    fd_log_assert((v2_buffer[1] == 0xac) && (v2_buffer[2] == 0x02));
+    fd_log_assert(v2_buffer[64] == (FD_DETOUR_V2 | 1));
+    uint32_t lengths[8];
+    uint32_t count = 0;
+    fd_log_assert(fd_detour_test_receive(&v2_collection, &v2_detour, lengths, &count) == 5);
+    fd_log_assert((count == 1) && (lengths[0] == 300));
+
+    // the format can only change when nothing is waiting to be sent
+    fd_detour_source_set(&source, fd_detour_test_supplier, 10);
+    fd_log_assert(fd_detour_source_collection_push(&v2_collection, &source));
+    fd_log_assert(!fd_detour_source_collection_set_format(&v2_collection, 2, FD_DETOUR_FLAG_COALESCE, 20));
+    fd_log_assert(fd_detour_test_receive(&v2_collection, &v2_detour, lengths, &count) == 1);
+    fd_log_assert((count == 2) && (lengths[1] == 10));
+    fd_log_assert(!fd_detour_source_collection_set_format(&v2_collection, 3, 0, 20));
+
+    // without coalescing each small message starts a packet of its own
+    fd_log_assert(fd_detour_source_collection_set_format(&v2_collection, 2, 0, 20));
+    for (uint32_t i = 0; i < 3; ++i) {
+        fd_detour_source_set(&source, fd_detour_test_supplier, 5);
+        fd_log_assert(fd_detour_source_collection_push(&v2_collection, &source));
+    }
+    fd_log_assert(v2_collection.bufferCount == 3 * 20);
+    fd_log_assert(v2_buffer[20] & FD_DETOUR_V2_START);
+    count = 0;
+    fd_log_assert(fd_detour_test_receive(&v2_collection, &v2_detour, lengths, &count) == 3);
+    fd_log_assert(count == 3);
+
+    // coalesced small messages share packets, and a message can start part way into one packet and end in
+    // the next:  (1 + 5) * 3 = 18 bytes, then a 10 byte message with 1 byte in the first packet
+    fd_log_assert(fd_detour_source_collection_set_format(&v2_collection, 2, FD_DETOUR_FLAG_COALESCE, 20));
+    for (uint32_t i = 0; i < 3; ++i) {
+        fd_detour_source_set(&source, fd_detour_test_supplier, 5);
+        fd_log_assert(fd_detour_source_collection_push(&v2_collection, &source));
+    }
+    fd_detour_source_set(&source, fd_detour_test_supplier, 10);
+    fd_log_assert(fd_detour_source_collection_push(&v2_collection, &source));
+    fd_log_assert(v2_collection.bufferCount == 2 * 20);
+    fd_log_assert((v2_buffer[20] & FD_DETOUR_V2_START) == 0);
+    count = 0;
+    fd_log_assert(fd_detour_test_receive(&v2_collection, &v2_detour, lengths, &count) == 2);
+    fd_log_assert((count == 4) && (lengths[0] == 5) && (lengths[2] == 5) && (lengths[3] == 10));
+
+    // a missing packet is an error, and the receiver picks up again at the next start once cleared
+    fd_log_assert(fd_detour_source_collection_set_format(&v2_collection, 2, 0, 20));
+    fd_detour_source_set(&source, fd_detour_test_supplier, 40);
+    fd_log_assert(fd_detour_source_collection_push(&v2_collection, &source));
+    fd_detour_source_set(&source, fd_detour_test_supplier, 5);
+    fd_log_assert(fd_detour_source_collection_push(&v2_collection, &source));
+    fd_log_assert(fd_detour_source_collection_get(&v2_collection, packet));
+    fd_detour_event(&v2_detour, packet, sizeof(packet));
+    fd_log_assert(fd_detour_state(&v2_detour) == fd_detour_state_intermediate);
+    fd_log_assert(fd_detour_source_collection_get(&v2_collection, packet));
+    fd_log_assert(fd_detour_source_collection_get(&v2_collection, packet));
+    fd_detour_event(&v2_detour, packet, sizeof(packet));
+    fd_log_assert(fd_detour_state(&v2_detour) == fd_detour_state_error);
+    fd_detour_clear(&v2_detour);
+    count = 0;
+    fd_log_assert(fd_detour_test_receive(&v2_collection, &v2_detour, lengths, &count) == 1);
+    fd_log_assert((count == 1) && (lengths[0] == 5));
+
+    // clearing the collection goes back to version 1, which the receiver still takes
+    fd_detour_source_collection_clear(&v2_collection);
+    fd_log_assert((v2_collection.version == 1) && (v2_collection.packetSize == 64));
+    fd_detour_source_set(&source, fd_detour_test_supplier, 100);
+    fd_log_assert(fd_detour_source_collection_push(&v2_collection, &source));
+    count = 0;
+    fd_log_assert(fd_detour_test_receive(&v2_collection, &v2_detour, lengths, &count) == 2);
+    fd_log_assert((count == 1) && (lengths[0] == 100));
+
+    // with resume a lost chunk is reported once and the sender goes back to it:  60 bytes is 17 + 19 + 19 + 5
+    fd_detour_clear(&v2_detour);
+    fd_detour_set_resume(&v2_detour, true);
+    fd_detour_source_collection_clear(&v2_collection);
+    fd_log_assert(fd_detour_source_collection_set_format(&v2_collection, 1, FD_DETOUR_FLAG_RESUME, 20));
+    fd_detour_source_set(&source, fd_detour_test_supplier, 60);
+    fd_log_assert(fd_detour_source_collection_push(&v2_collection, &source));
+    fd_log_assert(v2_collection.bufferCount == 4 * 20);
+    fd_log_assert(fd_detour_source_collection_get(&v2_collection, packet));
+    fd_detour_event(&v2_detour, packet, sizeof(packet));
+    fd_log_assert(fd_detour_source_collection_get(&v2_collection, packet));
+    uint32_t sequence_number;
+    for (uint32_t i = 0; i < 2; ++i) {
+        fd_log_assert(fd_detour_source_collection_get(&v2_collection, packet));
+        fd_detour_event(&v2_detour, packet, sizeof(packet));
+        fd_log_assert(fd_detour_state(&v2_detour) == fd_detour_state_intermediate);
+        fd_log_assert(fd_detour_get_nack(&v2_detour, &sequence_number) == (i == 0));
+    }
+    fd_log_assert(sequence_number == 1);
+    fd_log_assert(fd_detour_source_resume(&source, 20, sequence_number));
+    fd_log_assert(source.offset == 17);
+    fd_log_assert(fd_detour_source_collection_push(&v2_collection, &source));
+    count = 0;
+    fd_log_assert(fd_detour_test_receive(&v2_collection, &v2_detour, lengths, &count) == 3);
+    fd_log_assert((count == 1) && (lengths[0] == 60));
+    fd_log_assert(!fd_detour_source_resume(&source, 20, 4));
+
+    // version 2 chunks are resumed by their continuous sequence number
+    fd_log_assert(fd_detour_source_collection_set_format(&v2_collection, 2, FD_DETOUR_FLAG_RESUME, 20));
+    fd_detour_source_set(&source, fd_detour_test_supplier, 40);
+    fd_log_assert(fd_detour_source_collection_push(&v2_collection, &source));
+    uint8_t v2_packets[3][20];
+    for (uint32_t i = 0; i < 3; ++i) {
+        fd_log_assert(fd_detour_source_collection_get(&v2_collection, v2_packets[i]));
+    }
+    fd_detour_event(&v2_detour, v2_packets[0], 20);
+    fd_detour_event(&v2_detour, v2_packets[2], 20);
+    fd_log_assert(fd_detour_get_nack(&v2_detour, &sequence_number) && (sequence_number == 1));
+    fd_detour_event(&v2_detour, v2_packets[1], 20);
+    fd_detour_event(&v2_detour, v2_packets[2], 20);
+    fd_log_assert(fd_detour_state(&v2_detour) == fd_detour_state_success);
+    fd_log_assert((v2_detour.length == 40) && (memcmp(v2_detour.data, fd_detour_test_source_data, 40) == 0));
+
+    // without resume a gap is still an error
+    fd_detour_clear(&v2_detour);
+    fd_detour_set_resume(&v2_detour, false);
+    uint8_t first[20] = {0x00, 0x20, 0x00};
+    uint8_t third[20] = {0x02};
+    fd_detour_event(&v2_detour, first, sizeof(first));
+    fd_detour_event(&v2_detour, third, sizeof(third));
+    fd_log_assert(fd_detour_state(&v2_detour) == fd_detour_state_error);
+    fd_log_assert(!fd_detour_get_nack(&v2_detour, &sequence_number));
 }
\ No newline at end of file
@@ -0,0 +1,160 @@
+#include "fd_binary.h"
+#include "fd_control.h"
+#include "fd_control_codes.h"
+#include "fd_dump.h"
+#include "fd_hal_external_flash.h"
+#include "fd_log.h"
+#include "fd_sha.h"
+#include "fd_storage.h"
+
+#include "sha.h"
+
+#include <string.h>
+
+#define HEADER_SIZE 6
+#define DUMP_SIZE (HEADER_SIZE + FD_HAL_EXTERNAL_FLASH_PAGE_SIZE)
+
+typedef struct {
+    // the storage area being dumped (0 for a page range)
+    fd_storage_area_t *area;
+    // pages come from the range start_page to end_page (wrapping around), starting at first_page (for an area these
+    // are its bounds when the dump started)
+    uint32_t start_page;
+    uint32_t end_page;
+    uint32_t first_page;
+    uint32_t count;
+
+    uint32_t index;
+    bool complete;
+    SHA_CTX context;
+
+    // the message waiting for room in the detour source collection
+    bool loaded;
+    fd_detour_source_t detour_source;
+    uint32_t length;
+    uint8_t buffer[DUMP_SIZE];
+} fd_dump_t;
+
+static fd_dump_t fd_dump_state;
+
+void fd_dump_initialize(void) {
+    memset(&fd_dump_state, 0, sizeof(fd_dump_state));
+    fd_detour_source_initialize(&fd_dump_state.detour_source);
+}
+
+static
+void fd_dump_detour_supplier(uint32_t offset, uint8_t *data, uint32_t length) {
+    fd_log_assert((offset + length) <= fd_dump_state.length);
+    memcpy(data, &fd_dump_state.buffer[offset], length);
+}
+
+// pages are erased from the start of an area as they are synced (and the oldest are erased when it wraps), so once the
+// first page moves the pages left to dump may no longer be the ones counted at the start
+static
+bool fd_dump_area_changed(fd_dump_t *dump) {
+    fd_storage_area_t *area = dump->area;
+    if (area == 0) {
+        return false;
+    }
+    return (area->start_page != dump->start_page) || (area->end_page != dump->end_page) || (area->first_page != dump->first_page);
+}
+
+static
+void fd_dump_load(void) {
+    fd_dump_t *dump = &fd_dump_state;
+    fd_binary_t binary;
+    fd_binary_initialize(&binary, dump->buffer, DUMP_SIZE);
+    fd_binary_put_uint8(&binary, FD_CONTROL_DUMP);
+    if ((dump->index < dump->count) && fd_dump_area_changed(dump)) {
+        fd_binary_put_uint8(&binary, FD_CONTROL_DUMP_ABORTED);
+        fd_binary_put_uint32(&binary, dump->index);
+        dump->complete = true;
+    } else
+    if (dump->index < dump->count) {
+        uint32_t page = dump->first_page + dump->index;
+        if (page >= dump->end_page) {
+            page = dump->start_page + (page - dump->end_page);
+        }
+        fd_binary_put_uint8(&binary, FD_CONTROL_DUMP_PAGE);
+        fd_binary_put_uint32(&binary, page);
+        uint8_t *page_data = &dump->buffer[binary.put_index];
+        fd_hal_external_flash_wake();
+        fd_hal_external_flash_read(page * FD_HAL_EXTERNAL_FLASH_PAGE_SIZE, page_data, FD_HAL_EXTERNAL_FLASH_PAGE_SIZE);
+        fd_hal_external_flash_sleep();
+        SHA1_Update(&dump->context, page_data, FD_HAL_EXTERNAL_FLASH_PAGE_SIZE);
+        binary.put_index += FD_HAL_EXTERNAL_FLASH_PAGE_SIZE;
+        ++dump->index;
+    } else {
+        fd_binary_put_uint8(&binary, FD_CONTROL_DUMP_COMPLETE);
+        fd_binary_put_uint32(&binary, dump->count);
+        SHA1_Final(&dump->buffer[binary.put_index], &dump->context);
+        binary.put_index += FD_SHA_HASH_SIZE;
+        dump->complete = true;
+    }
+    dump->length = binary.put_index;
+    dump->loaded = true;
+}
+
+// push as many pages as fit (returns false once the final message has been pushed)
+static
+bool fd_dump_continue(fd_detour_source_collection_t *detour_source_collection) {
+    fd_dump_t *dump = &fd_dump_state;
+    while (true) {
+        if (!dump->loaded) {
+            fd_dump_load();
+        }
+        fd_detour_source_set(&dump->detour_source, fd_dump_detour_supplier, dump->length);
+        if (!fd_detour_source_collection_push(detour_source_collection, &dump->detour_source)) {
+            if (detour_source_collection->bufferCount == 0) {
+                // will never fit in the collection buffer
+                fd_log_assert_fail("");
+                return false;
+            }
+            return true;
+        }
+        dump->loaded = false;
+        if (dump->complete) {
+            return false;
+        }
+    }
+}
+
+void fd_dump(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length) {
+    fd_binary_t binary;
+    fd_binary_initialize(&binary, data, length);
+    uint8_t range = fd_binary_get_uint8(&binary);
+
+    fd_dump_t *dump = &fd_dump_state;
+    dump->area = 0;
+    dump->start_page = 0;
+    dump->end_page = fd_hal_external_flash_get_pages();
+    dump->first_page = 0;
+    dump->count = 0;
+    if (range == FD_CONTROL_DUMP_RANGE_PAGES) {
+        uint32_t first_page = fd_binary_get_uint32(&binary);
+        uint32_t count = fd_binary_get_uint32(&binary);
+        if (first_page < dump->end_page) {
+            dump->first_page = first_page;
+            dump->count = dump->end_page - first_page;
+            if (count < dump->count) {
+                dump->count = count;
+            }
+        }
+    } else
+    if (range == FD_CONTROL_DUMP_RANGE_AREA) {
+        fd_storage_area_t *area = fd_storage_get_area(fd_binary_get_uint8(&binary));
+        if (area != 0) {
+            dump->area = area;
+            dump->start_page = area->start_page;
+            dump->end_page = area->end_page;
+            dump->first_page = area->first_page;
+            dump->count = fd_storage_area_used_page_count(area);
+        }
+    }
+
+    dump->index = 0;
+    dump->complete = false;
+    dump->loaded = false;
+    SHA1_Init(&dump->context);
+    fd_control_stream_start(detour_source_collection, fd_dump_continue);
+}
\ No newline at end of file
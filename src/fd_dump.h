@@ -0,0 +1,28 @@
+#ifndef FD_DUMP_H
+#define FD_DUMP_H
+
+#include "fd_detour.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+The FD_CONTROL_DUMP command streams a range of external flash pages to the host in one go (instead of a round
+trip per page like sync and update read page).  The command is uint8 range type, then for
+FD_CONTROL_DUMP_RANGE_PAGES uint32 first page, uint32 page count, or for FD_CONTROL_DUMP_RANGE_AREA uint8
+storage area index (all the used pages of that area, oldest first).
+
+Each page is sent as uint8 FD_CONTROL_DUMP, uint8 FD_CONTROL_DUMP_PAGE, uint32 page, 256 bytes page data.  At
+the end comes uint8 FD_CONTROL_DUMP, uint8 FD_CONTROL_DUMP_COMPLETE, uint32 page count, 20 bytes SHA1 over the
+page data of all the pages in the order sent.  A new dump command replaces a dump that is still running.
+
+If the bounds of the storage area change during an area dump (pages were erased by a sync, or the area wrapped)
+it ends early with uint8 FD_CONTROL_DUMP, uint8 FD_CONTROL_DUMP_ABORTED, uint32 number of pages sent instead.  A
+dump stops without a final message when its transport goes away (fd_control_release).
+*/
+
+void fd_dump_initialize(void);
+
+void fd_dump(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length);
+
+#endif
\ No newline at end of file
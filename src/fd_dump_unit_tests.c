@@ -0,0 +1,178 @@
+#include "fd_binary.h"
+#include "fd_control.h"
+#include "fd_control_codes.h"
+#include "fd_control_queue.h"
+#include "fd_detour.h"
+#include "fd_dump.h"
+#include "fd_event.h"
+#include "fd_hal_external_flash.h"
+#include "fd_log.h"
+#include "fd_sha.h"
+#include "fd_storage.h"
+
+#include <string.h>
+
+static fd_detour_source_collection_t fd_dump_test_collection;
+static uint8_t fd_dump_test_collection_data[512];
+static fd_detour_t fd_dump_test_detour;
+static uint8_t fd_dump_test_detour_data[300];
+
+static uint32_t fd_dump_test_pages;
+static uint32_t fd_dump_test_page_numbers[8];
+static bool fd_dump_test_complete;
+static bool fd_dump_test_aborted;
+static uint32_t fd_dump_test_count;
+static uint8_t fd_dump_test_hash[FD_SHA_HASH_SIZE];
+// called after each page message is checked
+static void (*fd_dump_test_page_hook)(void);
+static fd_storage_area_t fd_dump_test_area;
+// pages were erased after the dump loaded them, so they no longer match the flash
+static bool fd_dump_test_erased;
+
+static
+void fd_dump_test_message(uint8_t *data, uint32_t length) {
+    fd_binary_t binary;
+    fd_binary_initialize(&binary, data, length);
+    fd_log_assert(fd_binary_get_uint8(&binary) == FD_CONTROL_DUMP);
+    uint8_t type = fd_binary_get_uint8(&binary);
+    if (type == FD_CONTROL_DUMP_PAGE) {
+        fd_log_assert(!fd_dump_test_complete && !fd_dump_test_aborted);
+        uint32_t page = fd_binary_get_uint32(&binary);
+        uint8_t flash_data[FD_HAL_EXTERNAL_FLASH_PAGE_SIZE];
+        fd_hal_external_flash_wake();
+        fd_hal_external_flash_read(page * FD_HAL_EXTERNAL_FLASH_PAGE_SIZE, flash_data, sizeof(flash_data));
+        fd_hal_external_flash_sleep();
+        fd_log_assert(length == (binary.get_index + FD_HAL_EXTERNAL_FLASH_PAGE_SIZE));
+        fd_log_assert(fd_dump_test_erased || (memcmp(&data[binary.get_index], flash_data, sizeof(flash_data)) == 0));
+        if (fd_dump_test_pages < (sizeof(fd_dump_test_page_numbers) / sizeof(uint32_t))) {
+            fd_dump_test_page_numbers[fd_dump_test_pages] = page;
+        }
+        ++fd_dump_test_pages;
+        if (fd_dump_test_page_hook != 0) {
+            fd_dump_test_page_hook();
+        }
+    } else
+    if (type == FD_CONTROL_DUMP_ABORTED) {
+        fd_dump_test_aborted = true;
+        fd_dump_test_count = fd_binary_get_uint32(&binary);
+    } else {
+        fd_log_assert(type == FD_CONTROL_DUMP_COMPLETE);
+        fd_dump_test_complete = true;
+        fd_dump_test_count = fd_binary_get_uint32(&binary);
+        memcpy(fd_dump_test_hash, &data[binary.get_index], FD_SHA_HASH_SIZE);
+    }
+}
+
+// run the stream to the end, taking packets out of the collection as the transport would (fd_control continues the
+// stream each time a packet is taken)
+static
+void fd_dump_test_run(uint8_t *data, uint32_t length) {
+    fd_detour_source_collection_initialize(&fd_dump_test_collection, 0, 64, fd_dump_test_collection_data, sizeof(fd_dump_test_collection_data));
+    fd_detour_initialize(&fd_dump_test_detour, fd_dump_test_detour_data, sizeof(fd_dump_test_detour_data));
+    fd_dump_test_pages = 0;
+    fd_dump_test_complete = false;
+    fd_dump_test_aborted = false;
+    fd_dump_test_count = 0;
+
+    fd_dump(&fd_dump_test_collection, data, length);
+    uint8_t packet[64];
+    uint32_t packets = 0;
+    while ((packets++ < 1000) && fd_detour_source_collection_get(&fd_dump_test_collection, packet)) {
+        fd_detour_event(&fd_dump_test_detour, packet, sizeof(packet));
+        fd_detour_state_t state = fd_detour_state(&fd_dump_test_detour);
+        fd_log_assert(state != fd_detour_state_error);
+        if (state == fd_detour_state_success) {
+            fd_dump_test_message(fd_dump_test_detour.data, fd_dump_test_detour.length);
+            fd_detour_clear(&fd_dump_test_detour);
+        }
+    }
+    fd_log_assert(fd_dump_test_complete != fd_dump_test_aborted);
+    fd_log_assert(fd_dump_test_count == fd_dump_test_pages);
+}
+
+// a sync erases the pages of the area while it is being dumped
+static
+void fd_dump_test_free_area(void) {
+    if (!fd_dump_test_erased) {
+        fd_storage_area_free_all_pages(&fd_dump_test_area);
+        fd_dump_test_erased = true;
+    }
+}
+
+void fd_dump_unit_tests(void) {
+    fd_event_initialize();
+    fd_control_queue_initialize();
+    fd_dump_initialize();
+    fd_dump_test_page_hook = 0;
+    fd_dump_test_erased = false;
+
+    // a range of pages, with the hash over all of them
+    uint8_t data[16];
+    fd_binary_t binary;
+    fd_binary_initialize(&binary, data, sizeof(data));
+    fd_binary_put_uint8(&binary, FD_CONTROL_DUMP_RANGE_PAGES);
+    fd_binary_put_uint32(&binary, 0);
+    fd_binary_put_uint32(&binary, 4);
+    fd_dump_test_run(data, binary.put_index);
+    fd_log_assert(fd_dump_test_pages == 4);
+    fd_log_assert(fd_dump_test_page_numbers[3] == 3);
+    uint8_t hash[FD_SHA_HASH_SIZE];
+    fd_hal_external_flash_wake();
+    fd_sha1(fd_hal_external_flash_read, 0, 4 * FD_HAL_EXTERNAL_FLASH_PAGE_SIZE, hash);
+    fd_hal_external_flash_sleep();
+    fd_log_assert(fd_sha1_is_equal(hash, fd_dump_test_hash));
+
+    // the range is cut off at the end of the flash
+    uint32_t pages = fd_hal_external_flash_get_pages();
+    fd_binary_initialize(&binary, data, sizeof(data));
+    fd_binary_put_uint8(&binary, FD_CONTROL_DUMP_RANGE_PAGES);
+    fd_binary_put_uint32(&binary, pages - 2);
+    fd_binary_put_uint32(&binary, 4);
+    fd_dump_test_run(data, binary.put_index);
+    fd_log_assert(fd_dump_test_pages == 2);
+
+    // the used pages of a storage area, oldest first
+    fd_storage_initialize();
+    fd_storage_area_t *area = &fd_dump_test_area;
+    fd_storage_area_initialize(area, 0, 1);
+    uint8_t page_data[] = {0x01, 0x02, 0x03};
+    for (uint32_t i = 0; i < 6; ++i) {
+        fd_storage_area_append_page(area, 0x1234, page_data, sizeof(page_data));
+    }
+    uint32_t used = fd_storage_area_used_page_count(area);
+    fd_binary_initialize(&binary, data, sizeof(data));
+    fd_binary_put_uint8(&binary, FD_CONTROL_DUMP_RANGE_AREA);
+    fd_binary_put_uint8(&binary, 0);
+    fd_dump_test_run(data, binary.put_index);
+    fd_log_assert(fd_dump_test_complete);
+    fd_log_assert(fd_dump_test_pages == used);
+    fd_log_assert(fd_dump_test_page_numbers[0] == area->first_page);
+
+    // the area dump stops with an error when the area changes under it (the pages already loaded are still sent)
+    fd_dump_test_page_hook = fd_dump_test_free_area;
+    fd_dump_test_run(data, binary.put_index);
+    fd_dump_test_page_hook = 0;
+    fd_log_assert(fd_dump_test_aborted);
+    fd_log_assert(fd_dump_test_pages < used);
+
+    // no such area is an empty dump
+    fd_binary_initialize(&binary, data, sizeof(data));
+    fd_binary_put_uint8(&binary, FD_CONTROL_DUMP_RANGE_AREA);
+    fd_binary_put_uint8(&binary, 1);
+    fd_dump_test_run(data, binary.put_index);
+    fd_log_assert(fd_dump_test_pages == 0);
+
+    // releasing the collection (the transport went away) stops the dump
+    fd_binary_initialize(&binary, data, sizeof(data));
+    fd_binary_put_uint8(&binary, FD_CONTROL_DUMP_RANGE_PAGES);
+    fd_binary_put_uint32(&binary, 0);
+    fd_binary_put_uint32(&binary, 4);
+    fd_detour_source_collection_initialize(&fd_dump_test_collection, 0, 64, fd_dump_test_collection_data, sizeof(fd_dump_test_collection_data));
+    fd_dump(&fd_dump_test_collection, data, binary.put_index);
+    uint8_t packet[64];
+    fd_log_assert(fd_detour_source_collection_get(&fd_dump_test_collection, packet));
+    fd_control_release(&fd_dump_test_collection);
+    fd_detour_source_collection_clear(&fd_dump_test_collection);
+    while (fd_event_process_pending());
+    fd_log_assert(!fd_detour_source_collection_get(&fd_dump_test_collection, packet));
+}
\ No newline at end of file
@@ -1,24 +1,40 @@
+#include "fd_accounting.h"
 #include "fd_event.h"
 #include "fd_hal_processor.h"
 #include "fd_hal_reset.h"
+#include "fd_hal_rtc.h"
 #include "fd_log.h"
+#include "fd_trace.h"
 
 #include <string.h>
 
 typedef struct {
     uint32_t events;
     fd_event_callback_t callback;
+    fd_event_priority_t priority;
+    // 1/32768 s spent in the callback
+    uint32_t clocks;
 #ifdef FD_EVENT_TIMING
     fd_timing_t timing;
+    fd_timing_t latency;
+#endif
+#ifdef FD_TRACE
+    uint16_t trace_identifier;
 #endif
 } fd_event_item_t;
 
+// item membership is kept as a bit mask, so there can be at most 32 items
 #define ITEM_LIMIT 32
+#define EVENT_LIMIT 32
 
+// items are kept sorted by priority (highest first, then in order of registration)
 static
 fd_event_item_t fd_event_items[ITEM_LIMIT];
 static
 uint32_t fd_event_item_count;
+// for each event bit: the mask of item indices with a callback for that event
+static
+uint32_t fd_event_items_for_event[EVENT_LIMIT];
 
 #define CHECK_LIMIT 4
 
@@ -29,15 +45,22 @@ uint32_t fd_event_em2_check_count;
 
 volatile uint32_t fd_event_pending;
 
+#ifdef FD_EVENT_TIMING
+// timestamp of when each event bit was last set (while it was not already pending)
+static
+volatile uint32_t fd_event_set_timestamps[EVENT_LIMIT];
+#endif
+
 void fd_event_initialize(void) {
     fd_event_item_count = 0;
     fd_event_em2_check_count = 0;
     fd_event_pending = 0;
     memset(fd_event_items, 0, sizeof(fd_event_items));
+    memset(fd_event_items_for_event, 0, sizeof(fd_event_items_for_event));
 }
 
 void fd_event_add_em2_check(fd_event_em2_check_t em2_check) {
-    if (fd_event_em2_check_count >= CHECK_LIMIT) {
+    if ((fd_event_em2_check_count >= CHECK_LIMIT) || (fd_event_em2_check_count >= FD_ACCOUNTING_VETO_LIMIT)) {
         fd_log_assert_fail("");
         return;
     }
@@ -45,18 +68,55 @@ void fd_event_add_em2_check(fd_event_em2_check_t em2_check) {
     fd_event_em2_checks[fd_event_em2_check_count++] = em2_check;
 }
 
-void fd_event_add_callback_with_identifier(uint32_t events, fd_event_callback_t callback, const char *identifier __attribute__((unused))) {
+void fd_event_add_prioritized_callback_with_identifier(
+    uint32_t events, fd_event_priority_t priority, fd_event_callback_t callback, const char *identifier __attribute__((unused))
+) {
     if (fd_event_item_count >= ITEM_LIMIT) {
         fd_log_assert_fail("");
         return;
     }
 
-    fd_event_item_t *item = &fd_event_items[fd_event_item_count++];
+    uint32_t index = fd_event_item_count;
+    while ((index > 0) && (fd_event_items[index - 1].priority > priority)) {
+        --index;
+    }
+    memmove(&fd_event_items[index + 1], &fd_event_items[index], (fd_event_item_count - index) * sizeof(fd_event_item_t));
+    ++fd_event_item_count;
+
+    // item indices at or after the insertion point move up by one
+    uint32_t below = ((uint32_t)1 << index) - 1;
+    for (uint32_t i = 0; i < EVENT_LIMIT; ++i) {
+        uint32_t items = fd_event_items_for_event[i];
+        items = (items & below) | ((items & ~below) << 1);
+        if (events & ((uint32_t)1 << i)) {
+            items |= (uint32_t)1 << index;
+        }
+        fd_event_items_for_event[i] = items;
+    }
+
+    fd_event_item_t *item = &fd_event_items[index];
     item->events = events;
     item->callback = callback;
+    item->priority = priority;
 #ifdef FD_EVENT_TIMING
     fd_timing_initialize(&item->timing, identifier);
+    fd_timing_initialize(&item->latency, identifier);
 #endif
+#ifdef FD_TRACE
+    item->trace_identifier = fd_trace_add_identifier(identifier);
+#endif
+}
+
+void fd_event_add_callback_with_identifier(uint32_t events, fd_event_callback_t callback, const char *identifier) {
+    fd_event_add_prioritized_callback_with_identifier(events, FD_EVENT_PRIORITY_NORMAL, callback, identifier);
+}
+
+uint32_t fd_event_get_item_count(void) {
+    return fd_event_item_count;
+}
+
+uint32_t fd_event_get_item_clocks(uint32_t index) {
+    return fd_event_items[index].clocks;
 }
 
 fd_timing_iterator_t fd_event_timing_iterator(void) {
@@ -68,6 +128,15 @@ fd_timing_iterator_t fd_event_timing_iterator(void) {
     return iterator;
 }
 
+fd_timing_iterator_t fd_event_latency_iterator(void) {
+#ifdef FD_EVENT_TIMING
+    fd_timing_iterator_t iterator = fd_timing_iterator_array_of_objects(fd_event_item_t, latency, fd_event_items, fd_event_item_count);
+#else
+    fd_timing_iterator_t iterator = fd_timing_iterator_nil();
+#endif
+    return iterator;
+}
+
 void fd_event_set_exclusive(uint32_t events) {
     fd_hal_processor_interrupts_disable();
     fd_event_set(events);
@@ -75,9 +144,39 @@ void fd_event_set_exclusive(uint32_t events) {
 }
 
 void fd_event_set(uint32_t events) {
+#ifdef FD_EVENT_TIMING
+    uint32_t new_events = events & ~fd_event_pending;
+    if (new_events && fd_hal_timing_get_enable()) {
+        uint32_t now = fd_hal_timing_get_timestamp();
+        do {
+            fd_event_set_timestamps[__builtin_ctz(new_events)] = now;
+            new_events &= new_events - 1;
+        } while (new_events);
+    }
+#endif
     fd_event_pending |= events;
 }
 
+#ifdef FD_EVENT_TIMING
+// latency is measured from when the earliest of the item's pending events was set
+static
+void fd_event_latency(fd_event_item_t *item, uint32_t pending, uint32_t now) {
+    // the item is ready, so at least one of its events is pending
+    uint32_t events = item->events & pending;
+    uint32_t earliest = fd_event_set_timestamps[__builtin_ctz(events)];
+    events &= events - 1;
+    while (events) {
+        uint32_t start = fd_event_set_timestamps[__builtin_ctz(events)];
+        if ((now - start) > (now - earliest)) {
+            earliest = start;
+        }
+        events &= events - 1;
+    }
+    item->latency.start = earliest;
+    fd_timing_end(&item->latency);
+}
+#endif
+
 bool fd_event_process_pending(void) {
     fd_hal_processor_interrupts_disable();
     uint32_t pending = fd_event_pending;
@@ -87,26 +186,48 @@ bool fd_event_process_pending(void) {
     fd_hal_reset_feed_watchdog();
     
     if (pending) {
+        fd_accounting_category_t category = fd_accounting_switch(FD_ACCOUNTING_EVENT);
+        uint32_t clock = fd_hal_rtc_get_clock();
 #ifdef FD_EVENT_TIMING
         bool is_timing = fd_hal_timing_get_enable();
 #endif
-        fd_event_item_t *item = fd_event_items;
-        fd_event_item_t *end = &fd_event_items[fd_event_item_count];
-        for (; item < end; ++item) {
-            if (item->events & pending) {
+        // gather the items for each pending event
+        uint32_t ready = 0;
+        uint32_t events = pending;
+        do {
+            uint32_t event = 31 - __builtin_clz(events);
+            ready |= fd_event_items_for_event[event];
+            events &= ~((uint32_t)1 << event);
+        } while (events);
+
+        // lowest index is highest priority
+        while (ready) {
+            uint32_t index = __builtin_ctz(ready);
+            ready &= ready - 1;
+            fd_event_item_t *item = &fd_event_items[index];
 #ifdef FD_EVENT_TIMING
-                if (is_timing) {
-                    fd_timing_start(&item->timing);
-                }
+            if (is_timing) {
+                fd_event_latency(item, pending, fd_hal_timing_get_timestamp());
+                fd_timing_start(&item->timing);
+            }
 #endif
-                (*item->callback)();
-#ifdef FD_EVENT_TIMING
-                if (is_timing) {
-                    fd_timing_end(&item->timing);
-                }
+#ifdef FD_TRACE
+            uint32_t trace_start = fd_trace_start();
+#endif
+            (*item->callback)();
+#ifdef FD_TRACE
+            fd_trace_end(item->trace_identifier, trace_start);
 #endif
+#ifdef FD_EVENT_TIMING
+            if (is_timing) {
+                fd_timing_end(&item->timing);
             }
+#endif
+            uint32_t now = fd_hal_rtc_get_clock();
+            item->clocks += now - clock;
+            clock = now;
         }
+        fd_accounting_switch(category);
     }
     return pending != 0;
 }
@@ -117,10 +238,14 @@ void fd_event_process(void) {
         for (uint32_t i = 0; i < fd_event_em2_check_count; ++i) {
             fd_event_em2_check_t em2_check = fd_event_em2_checks[i];
             if (!em2_check()) {
+                fd_accounting_switch(FD_ACCOUNTING_VETO + i);
                 return;
             }
         }
+        fd_accounting_switch(FD_ACCOUNTING_SLEEP);
         fd_hal_processor_wait();
+        fd_accounting_switch(FD_ACCOUNTING_IDLE);
+        fd_accounting_wakeup();
     }
 }
 
@@ -14,7 +14,6 @@
 #define FD_EVENT_ADC_TEMPERATURE (1 << 5)
 #define FD_EVENT_ADC_BATTERY_VOLTAGE (1 << 6)
 #define FD_EVENT_ADC_CHARGE_CURRENT (1 << 7)
-#define FD_EVENT_RTC_TICK (1 << 8)
 #define FD_EVENT_RTC_COUNTDOWN (1 << 9)
 #define FD_EVENT_TIMER_SCHEDULE (1 << 10)
 #define FD_EVENT_USB_STATE (1 << 11)
@@ -26,9 +25,18 @@
 #define FD_EVENT_COMMAND (1 << 17)
 #define FD_EVENT_LOCK_STATE (1 << 18)
 #define FD_EVENT_USB_POWER (1 << 19)
+#define FD_EVENT_HRTIMER (1 << 20)
+#define FD_EVENT_NRF_SPI (1 << 21)
 
 typedef void (*fd_event_callback_t)(void);
 
+// callbacks for the same pending events are called highest priority first (then in order added)
+typedef enum {
+    FD_EVENT_PRIORITY_HIGH,
+    FD_EVENT_PRIORITY_NORMAL,
+    FD_EVENT_PRIORITY_LOW,
+} fd_event_priority_t;
+
 typedef bool (*fd_event_em2_check_t)(void);
 
 void fd_event_initialize(void);
@@ -38,6 +46,12 @@ void fd_event_add_em2_check(fd_event_em2_check_t em2_check);
 void fd_event_add_callback_with_identifier(uint32_t events, fd_event_callback_t callback, const char *identifier);
 #define fd_event_add_callback(events, callback) fd_event_add_callback_with_identifier(events, callback, #callback)
 
+void fd_event_add_prioritized_callback_with_identifier(
+    uint32_t events, fd_event_priority_t priority, fd_event_callback_t callback, const char *identifier
+);
+#define fd_event_add_prioritized_callback(events, priority, callback)\
+    fd_event_add_prioritized_callback_with_identifier(events, priority, callback, #callback)
+
 void fd_event_set_exclusive(uint32_t events);
 void fd_event_set(uint32_t events);
 
@@ -45,6 +59,11 @@ bool fd_event_process_pending(void);
 
 void fd_event_process(void);
 
+// items are in dispatch order (the same order as the timing iterators)
+uint32_t fd_event_get_item_count(void);
+uint32_t fd_event_get_item_clocks(uint32_t index);
+
 fd_timing_iterator_t fd_event_timing_iterator(void);
+fd_timing_iterator_t fd_event_latency_iterator(void);
 
 #endif
\ No newline at end of file
@@ -10,6 +10,14 @@ void fd_hal_accelerometer_set_sample_callback(fd_hal_accelerometer_sample_callba
     fd_lis3dh_set_sample_callback(callback);
 }
 
+void fd_hal_accelerometer_set_sample_rate(uint32_t rate) {
+    fd_lis3dh_set_sample_rate(rate);
+}
+
+uint32_t fd_hal_accelerometer_get_sample_rate(void) {
+    return fd_lis3dh_get_sample_rate();
+}
+
 void fd_hal_accelerometer_sleep(void) {
     fd_lis3dh_sleep();
 }
@@ -22,6 +30,13 @@ void fd_hal_accelerometer_read_fifo(void) {
     fd_lis3dh_read_fifo();
 }
 
+void fd_hal_accelerometer_diagnostics(fd_binary_t *binary) {
+    fd_binary_put_uint32(binary, 12 /* length of following bytes */);
+    fd_binary_put_uint32(binary, 1 /* version */);
+    fd_binary_put_uint32(binary, fd_lis3dh_get_fifo_reads());
+    fd_binary_put_uint32(binary, fd_lis3dh_get_fifo_overruns());
+}
+
 void fd_hal_accelerometer_read(int16_t *x, int16_t *y, int16_t *z) {
     fd_lis3dh_read(x, y, z);
 }
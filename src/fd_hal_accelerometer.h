@@ -1,6 +1,8 @@
 #ifndef FD_HAL_ACCELEROMETER_H
 #define FD_HAL_ACCELEROMETER_H
 
+#include "fd_binary.h"
+
 #include <stdint.h>
 
 #define FD_HAL_ACCELEROMETER_SCALE (1.0f / 4096.0f)
@@ -11,11 +13,16 @@ typedef void (*fd_hal_accelerometer_sample_callback_t)(int16_t x, int16_t y, int
 
 void fd_hal_accelerometer_set_sample_callback(fd_hal_accelerometer_sample_callback_t callback);
 
+void fd_hal_accelerometer_set_sample_rate(uint32_t rate);
+uint32_t fd_hal_accelerometer_get_sample_rate(void);
+
 void fd_hal_accelerometer_sleep(void);
 void fd_hal_accelerometer_wake(void);
 
 void fd_hal_accelerometer_read_fifo(void);
 
+void fd_hal_accelerometer_diagnostics(fd_binary_t *binary);
+
 void fd_hal_accelerometer_read(int16_t *x, int16_t *y, int16_t *z);
 
 #endif
\ No newline at end of file
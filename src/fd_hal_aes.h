@@ -8,6 +8,10 @@
 
 typedef struct {
     uint32_t prev[4];
+#ifdef FD_HAL_AES_SOFT
+    // decryption round keys (equivalent inverse cipher order), expanded once in fd_hal_aes_decrypt_start
+    uint32_t round_keys[44];
+#endif
 } fd_hal_aes_decrypt_t;
 
 void fd_hal_aes_decrypt_start(fd_hal_aes_decrypt_t *decrypt, const uint8_t *key, const uint8_t *iv);
@@ -0,0 +1,67 @@
+#include "fd_hal_aes.h"
+#include "fd_log.h"
+
+#include <string.h>
+
+// NIST SP 800-38A F.2.2 CBC-AES128.Decrypt
+
+static const uint8_t fd_hal_aes_test_key[FD_HAL_AES_KEY_SIZE] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c,
+};
+
+static const uint8_t fd_hal_aes_test_iv[FD_HAL_AES_IV_SIZE] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+};
+
+static const uint8_t fd_hal_aes_test_cipher_text[64] = {
+    0x76, 0x49, 0xab, 0xac, 0x81, 0x19, 0xb2, 0x46, 0xce, 0xe9, 0x8e, 0x9b, 0x12, 0xe9, 0x19, 0x7d,
+    0x50, 0x86, 0xcb, 0x9b, 0x50, 0x72, 0x19, 0xee, 0x95, 0xdb, 0x11, 0x3a, 0x91, 0x76, 0x78, 0xb2,
+    0x73, 0xbe, 0xd6, 0xb8, 0xe3, 0xc1, 0x74, 0x3b, 0x71, 0x16, 0xe6, 0x9e, 0x22, 0x22, 0x95, 0x16,
+    0x3f, 0xf1, 0xca, 0xa1, 0x68, 0x1f, 0xac, 0x09, 0x12, 0x0e, 0xca, 0x30, 0x75, 0x86, 0xe1, 0xa7,
+};
+
+static const uint8_t fd_hal_aes_test_plain_text[64] = {
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+    0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+    0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10,
+};
+
+// decrypt the test cipher text passing chunk bytes to each fd_hal_aes_decrypt_blocks call
+static
+void fd_hal_aes_test_decrypt(uint32_t chunk) {
+    // word aligned, the EFM32 AES hardware version accesses the data as words
+    uint32_t in_words[16];
+    uint32_t out_words[16];
+    uint8_t *in = (uint8_t *)in_words;
+    uint8_t *out = (uint8_t *)out_words;
+    memcpy(in, fd_hal_aes_test_cipher_text, sizeof(fd_hal_aes_test_cipher_text));
+    memset(out, 0, sizeof(out_words));
+
+    fd_hal_aes_decrypt_t decrypt;
+    fd_hal_aes_decrypt_start(&decrypt, fd_hal_aes_test_key, fd_hal_aes_test_iv);
+    for (uint32_t offset = 0; offset < sizeof(fd_hal_aes_test_cipher_text); offset += chunk) {
+        fd_hal_aes_decrypt_blocks(&decrypt, &in[offset], &out[offset], chunk);
+    }
+    fd_hal_aes_decrypt_stop(&decrypt);
+
+    fd_log_assert(memcmp(out, fd_hal_aes_test_plain_text, sizeof(fd_hal_aes_test_plain_text)) == 0);
+}
+
+void fd_hal_aes_unit_tests(void) {
+    // all blocks in one call
+    fd_hal_aes_test_decrypt(64);
+    // the cbc chain carries over between calls
+    fd_hal_aes_test_decrypt(16);
+    fd_hal_aes_test_decrypt(32);
+
+    // decrypting in place
+    uint32_t data_words[16];
+    uint8_t *data = (uint8_t *)data_words;
+    memcpy(data, fd_hal_aes_test_cipher_text, sizeof(fd_hal_aes_test_cipher_text));
+    fd_hal_aes_decrypt_t decrypt;
+    fd_hal_aes_decrypt_start(&decrypt, fd_hal_aes_test_key, fd_hal_aes_test_iv);
+    fd_hal_aes_decrypt_blocks(&decrypt, data, data, sizeof(fd_hal_aes_test_cipher_text));
+    fd_hal_aes_decrypt_stop(&decrypt);
+    fd_log_assert(memcmp(data, fd_hal_aes_test_plain_text, sizeof(fd_hal_aes_test_plain_text)) == 0);
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "fd_event.h"
+#include "fd_hal_hrtimer.h"
+#include "fd_hal_processor.h"
+
+#include <em_cmu.h>
+#include <em_letimer.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// LETIMER0 runs from the LFXO (so it keeps running in EM2) and counts down from 0xffff.  The 16-bit counter is
+// extended to 32 bits by counting underflows.  COMP1 matches once per 2 s period, so the compare interrupt checks
+// that the whole 32-bit compare value has been reached.
+//
+// LETIMER0 is only running while a compare is set, so there are no underflow interrupts when no fd_hrtimer is
+// pending.  The ticks stand still while it is stopped (fd_hrtimer deadlines are relative, so that is fine).
+
+// deadlines closer than this may be missed by COMP1, so they are triggered right away
+#define MINIMUM_COMPARE_TICKS 2
+
+static volatile uint32_t fd_hal_hrtimer_high;
+static volatile bool fd_hal_hrtimer_armed;
+static volatile uint32_t fd_hal_hrtimer_compare;
+static volatile bool fd_hal_hrtimer_running;
+
+void fd_hal_hrtimer_initialize(void) {
+    fd_hal_hrtimer_high = 0;
+    fd_hal_hrtimer_armed = false;
+    fd_hal_hrtimer_compare = 0;
+    fd_hal_hrtimer_running = false;
+
+    CMU_ClockEnable(cmuClock_LETIMER0, true);
+    LETIMER_Init_TypeDef init = LETIMER_INIT_DEFAULT;
+    init.enable = false;
+    LETIMER_Init(LETIMER0, &init);
+    LETIMER_IntClear(LETIMER0, LETIMER_IF_UF | LETIMER_IF_COMP1);
+    LETIMER_IntEnable(LETIMER0, LETIMER_IF_UF);
+    NVIC_ClearPendingIRQ(LETIMER0_IRQn);
+    NVIC_EnableIRQ(LETIMER0_IRQn);
+}
+
+uint32_t fd_hal_hrtimer_get_ticks(void) {
+    fd_hal_processor_interrupts_disable();
+    uint32_t high = fd_hal_hrtimer_high;
+    uint32_t low = 0xffff - LETIMER_CounterGet(LETIMER0);
+    if (LETIMER_IntGet(LETIMER0) & LETIMER_IF_UF) {
+        // underflow has not been handled yet - read again to be sure the low count is after it
+        low = 0xffff - LETIMER_CounterGet(LETIMER0);
+        high += 0x10000;
+    }
+    fd_hal_processor_interrupts_enable();
+    return high | low;
+}
+
+static
+void fd_hal_hrtimer_check_compare(void) {
+    if (fd_hal_hrtimer_armed && ((int32_t)(fd_hal_hrtimer_compare - fd_hal_hrtimer_get_ticks()) < MINIMUM_COMPARE_TICKS)) {
+        fd_hal_hrtimer_armed = false;
+        LETIMER_IntDisable(LETIMER0, LETIMER_IF_COMP1);
+        fd_event_set(FD_EVENT_HRTIMER);
+    }
+}
+
+void fd_hal_hrtimer_set_compare(uint32_t ticks) {
+    fd_hal_processor_interrupts_disable();
+    fd_hal_hrtimer_compare = ticks;
+    fd_hal_hrtimer_armed = true;
+    LETIMER_CompareSet(LETIMER0, 1, 0xffff - (ticks & 0xffff));
+    LETIMER_IntClear(LETIMER0, LETIMER_IF_COMP1);
+    LETIMER_IntEnable(LETIMER0, LETIMER_IF_COMP1);
+    if (!fd_hal_hrtimer_running) {
+        fd_hal_hrtimer_running = true;
+        LETIMER_Enable(LETIMER0, true);
+    }
+    fd_hal_hrtimer_check_compare();
+    fd_hal_processor_interrupts_enable();
+}
+
+void fd_hal_hrtimer_clear_compare(void) {
+    fd_hal_processor_interrupts_disable();
+    fd_hal_hrtimer_armed = false;
+    LETIMER_IntDisable(LETIMER0, LETIMER_IF_COMP1);
+    if (fd_hal_hrtimer_running) {
+        fd_hal_hrtimer_running = false;
+        LETIMER_Enable(LETIMER0, false);
+    }
+    fd_hal_processor_interrupts_enable();
+}
+
+void LETIMER0_IRQHandler(void) {
+    uint32_t interrupts = LETIMER_IntGet(LETIMER0);
+    LETIMER_IntClear(LETIMER0, interrupts);
+
+    if (interrupts & LETIMER_IF_UF) {
+        fd_hal_hrtimer_high += 0x10000;
+    }
+    if (interrupts & LETIMER_IF_COMP1) {
+        fd_hal_hrtimer_check_compare();
+    }
+}
\ No newline at end of file
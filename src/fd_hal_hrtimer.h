@@ -0,0 +1,20 @@
+#ifndef FD_HAL_HRTIMER_H
+#define FD_HAL_HRTIMER_H
+
+#include <stdint.h>
+
+// tick counter for fd_hrtimer (~30.5 us per tick), only counts while a compare is set
+#define FD_HAL_HRTIMER_FREQUENCY 32768
+
+void fd_hal_hrtimer_initialize(void);
+
+uint32_t fd_hal_hrtimer_get_ticks(void);
+
+// FD_EVENT_HRTIMER is set once the tick counter reaches the compare value
+void fd_hal_hrtimer_set_compare(uint32_t ticks);
+void fd_hal_hrtimer_clear_compare(void);
+
+// host simulation backend (fd_hal_hrtimer_sim.c) only
+void fd_hal_hrtimer_sim_advance(uint32_t ticks);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,46 @@
+#include "fd_event.h"
+#include "fd_hal_hrtimer.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// host simulation of the high resolution timer:  time only moves when fd_hal_hrtimer_sim_advance is called
+
+static uint32_t fd_hal_hrtimer_ticks;
+static bool fd_hal_hrtimer_armed;
+static uint32_t fd_hal_hrtimer_compare;
+
+void fd_hal_hrtimer_initialize(void) {
+    fd_hal_hrtimer_ticks = 0;
+    fd_hal_hrtimer_armed = false;
+    fd_hal_hrtimer_compare = 0;
+}
+
+uint32_t fd_hal_hrtimer_get_ticks(void) {
+    return fd_hal_hrtimer_ticks;
+}
+
+static
+void fd_hal_hrtimer_check_compare(void) {
+    if (fd_hal_hrtimer_armed && ((int32_t)(fd_hal_hrtimer_compare - fd_hal_hrtimer_ticks) <= 0)) {
+        fd_hal_hrtimer_armed = false;
+        fd_event_set(FD_EVENT_HRTIMER);
+    }
+}
+
+void fd_hal_hrtimer_set_compare(uint32_t ticks) {
+    fd_hal_hrtimer_compare = ticks;
+    fd_hal_hrtimer_armed = true;
+    fd_hal_hrtimer_check_compare();
+}
+
+void fd_hal_hrtimer_clear_compare(void) {
+    fd_hal_hrtimer_armed = false;
+}
+
+void fd_hal_hrtimer_sim_advance(uint32_t ticks) {
+    while (ticks--) {
+        ++fd_hal_hrtimer_ticks;
+        fd_hal_hrtimer_check_compare();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#include "fd_hal_nrf8001.h"
+#include "fd_hal_processor.h"
+#include "fd_pins.h"
+
+#include <em_gpio.h>
+
+void fd_hal_nrf8001_reset(void) {
+    GPIO_PinOutClear(NRF_RESETN_PORT_PIN);
+    fd_hal_processor_delay_ms(100);
+    GPIO_PinOutSet(NRF_RESETN_PORT_PIN);
+    fd_hal_processor_delay_ms(100); // wait for nRF8001 to come out of reset (62ms)
+}
+
+bool fd_hal_nrf8001_is_ready(void) {
+    return GPIO_PinInGet(NRF_RDYN_PORT_PIN) == 0;
+}
+
+void fd_hal_nrf8001_request(void) {
+    GPIO_PinOutClear(NRF_REQN_PORT_PIN);
+}
\ No newline at end of file
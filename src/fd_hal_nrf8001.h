@@ -0,0 +1,18 @@
+#ifndef FD_HAL_NRF8001_H
+#define FD_HAL_NRF8001_H
+
+#include <stdbool.h>
+
+// nRF8001 control lines (REQN is also the chip select of the nRF8001 on SPI bus 1, so fd_spi keeps the bus for the
+// nRF8001 while REQN is low)
+
+// pulse RESETN and wait for the nRF8001 to come out of reset
+void fd_hal_nrf8001_reset(void);
+
+// RDYN is low:  the nRF8001 has an event for us or is ready for the requested transfer
+bool fd_hal_nrf8001_is_ready(void);
+
+// pull REQN low to ask the nRF8001 for a transfer
+void fd_hal_nrf8001_request(void);
+
+#endif
\ No newline at end of file
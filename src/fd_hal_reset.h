@@ -11,6 +11,10 @@
 #define FD_HAL_RESET_CONTEXT_SIZE 12
 #endif
 
+#ifndef FD_HAL_RESET_ACCOUNTING_SIZE
+#define FD_HAL_RESET_ACCOUNTING_SIZE 8
+#endif
+
 typedef struct {
     uint32_t magic;
 
@@ -25,6 +29,10 @@ typedef struct {
     char context[FD_HAL_RESET_CONTEXT_SIZE];
 
     uint32_t startup_command;
+
+    uint32_t accounting_magic;
+    uint64_t accounting_clocks[FD_HAL_RESET_ACCOUNTING_SIZE];
+    uint32_t accounting_wakeups;
 } fd_hal_reset_retained_t;
 
 typedef struct {
@@ -6,9 +6,41 @@
 #include <em_cmu.h>
 #include <em_rtc.h>
 
+#include <stdbool.h>
 #include <stdint.h>
 
-static volatile uint32_t rtc_countdown;
+/*
+The RTC counts at 32768 Hz and wraps every 2 s (COMP0 is the top).  Retained RAM has the time at the start of
+the current 2 s period, the counter has the time since then.  There is no periodic tick interrupt:  COMP1 is
+only enabled while a countdown is set and its deadline is in the current period.  So the core is woken by
+the RTC once per 2 s period plus once per countdown deadline (the same when awake and in storage mode).
+
+The clock and ticks are derived from the number of periods and the counter, so they are monotonic (other
+than wrapping) whether or not the device is asleep.
+
+Because retained RAM only has the start of the period, the time in the counter is added to it at initialize when
+the RTC kept running through the reset.  When the reset also stopped the RTC the time since the period start (up
+to 2 s) is lost.
+*/
+
+#define FD_HAL_RTC_TOP 65535
+#define FD_HAL_RTC_PERIOD_SHIFT 16
+#define FD_HAL_RTC_PERIOD_SECONDS 2
+// 1/32 s ticks
+#define FD_HAL_RTC_TICK_SHIFT 10
+#define FD_HAL_RTC_TICK_MICROSECONDS 31250
+// longer countdowns end early (the caller finds nothing due and sets the countdown again), so the end clock
+// is always within half the range of the wrapping clock
+#define FD_HAL_RTC_COUNTDOWN_LIMIT (1 << 20)
+// compare writes take a few 32 kHz cycles to synchronize, so a compare is never set closer than this
+#define FD_HAL_RTC_COMPARE_MARGIN 5
+
+static volatile uint32_t rtc_periods;
+static volatile bool rtc_countdown_set;
+// the clock value that the countdown ends at
+static volatile uint32_t rtc_countdown_clock;
+static volatile bool rtc_asleep;
+static volatile uint32_t rtc_interrupt_count;
 
 void fd_hal_rtc_set_utc_offset(int32_t utc_offset __attribute__((unused))) {
 }
@@ -17,8 +49,78 @@ int32_t fd_hal_rtc_get_utc_offset(void) {
     return 0;
 }
 
+// must be called with interrupts disabled.  returns true when the counter has wrapped but the interrupt has
+// not been handled yet (the period count and retained time are one period behind).
+static
+bool fd_hal_rtc_read(uint32_t *periods, uint32_t *counter) {
+    *counter = RTC_CounterGet();
+    *periods = rtc_periods;
+    if ((RTC_IntGet() & RTC_IF_COMP0) && (*counter < ((FD_HAL_RTC_TOP + 1) / 2))) {
+        ++*periods;
+        return true;
+    }
+    return false;
+}
+
+static
+void fd_hal_rtc_schedule(void) {
+    if (!rtc_countdown_set || rtc_asleep) {
+        RTC_IntDisable(RTC_IF_COMP1);
+        return;
+    }
+
+    uint32_t periods;
+    uint32_t counter;
+    fd_hal_rtc_read(&periods, &counter);
+    uint32_t clock = (periods << FD_HAL_RTC_PERIOD_SHIFT) + counter;
+    int32_t remaining = (int32_t)(rtc_countdown_clock - clock);
+    if (remaining <= 0) {
+        rtc_countdown_set = false;
+        RTC_IntDisable(RTC_IF_COMP1);
+        fd_event_set(FD_EVENT_RTC_COUNTDOWN);
+        return;
+    }
+
+    if (remaining < FD_HAL_RTC_COMPARE_MARGIN) {
+        remaining = FD_HAL_RTC_COMPARE_MARGIN;
+    }
+    uint32_t compare = counter + remaining;
+    if (compare > FD_HAL_RTC_TOP) {
+        // in a later period, scheduled again when the period ends
+        RTC_IntDisable(RTC_IF_COMP1);
+        return;
+    }
+    RTC_CompareSet(1, compare);
+    RTC_IntClear(RTC_IFC_COMP1);
+    RTC_IntEnable(RTC_IF_COMP1);
+}
+
+static
+fd_time_t fd_hal_rtc_get_period_offset(uint32_t counter) {
+    fd_time_t offset;
+    uint32_t microseconds = (counter >> FD_HAL_RTC_TICK_SHIFT) * FD_HAL_RTC_TICK_MICROSECONDS;
+    offset.seconds = microseconds / 1000000;
+    offset.microseconds = microseconds % 1000000;
+    return offset;
+}
+
+static
+fd_time_t fd_hal_rtc_get_period_start(bool wrapped) {
+    fd_time_t start;
+    start.seconds = RETAINED->rtc.seconds;
+    start.microseconds = RETAINED->rtc.microseconds;
+    if (wrapped) {
+        start.seconds += FD_HAL_RTC_PERIOD_SECONDS;
+    }
+    return start;
+}
+
 void fd_hal_rtc_initialize(void) {
-    rtc_countdown = 0;
+    rtc_periods = 0;
+    rtc_countdown_set = false;
+    rtc_countdown_clock = 0;
+    rtc_asleep = false;
+    rtc_interrupt_count = 0;
 
     CMU_ClockEnable(cmuClock_CORELE, true);
     CMU_OscillatorEnable(cmuOsc_LFXO, true, true);
@@ -30,91 +132,151 @@ void fd_hal_rtc_initialize(void) {
     CMU->CTRL = (CMU->CTRL & ~_CMU_CTRL_CLKOUTSEL1_MASK) | CMU_CTRL_CLKOUTSEL1_LFXO;
     CMU->ROUTE = CMU_ROUTE_LOCATION_LOC0 | CMU_ROUTE_CLKOUT1PEN;
 
-    fd_hal_rtc_wake();
+    if (RTC->CTRL & RTC_CTRL_EN) {
+        // still running from before the reset:  move the retained time up to now before the counter is reset
+        uint32_t periods;
+        uint32_t counter;
+        bool wrapped = fd_hal_rtc_read(&periods, &counter);
+        fd_time_t now = fd_time_add(fd_hal_rtc_get_period_start(wrapped), fd_hal_rtc_get_period_offset(counter));
+        RETAINED->rtc.seconds = now.seconds;
+        RETAINED->rtc.microseconds = now.microseconds;
+        RTC_Enable(false);
+    }
 
-    RTC_IntEnable(RTC_IFC_COMP0);
+    RTC_CompareSet(0, FD_HAL_RTC_TOP); // 2 s
+    RTC_CounterReset();
+    RTC_IntClear(_RTC_IFC_MASK);
+
+    RTC_IntEnable(RTC_IF_COMP0);
     NVIC_EnableIRQ(RTC_IRQn);
     RTC_Init_TypeDef init = RTC_INIT_DEFAULT;
     RTC_Init(&init);
 }
 
+// countdowns do not end while asleep (storage mode), the clock keeps counting
 void fd_hal_rtc_sleep(void) {
-    RTC_CompareSet(0, 65535); // 2 s
+    fd_hal_processor_interrupts_disable();
+    rtc_asleep = true;
+    fd_hal_rtc_schedule();
+    fd_hal_processor_interrupts_enable();
 }
 
 void fd_hal_rtc_wake(void) {
-    RTC_CompareSet(0, 1023); // 31250 us
-    RTC_CounterReset();
+    fd_hal_processor_interrupts_disable();
+    rtc_asleep = false;
+    fd_hal_rtc_schedule();
+    fd_hal_processor_interrupts_enable();
 }
 
 void fd_hal_rtc_set_time(fd_time_t time) {
+    time.microseconds = (time.microseconds / FD_HAL_RTC_TICK_MICROSECONDS) * FD_HAL_RTC_TICK_MICROSECONDS;
     fd_hal_processor_interrupts_disable();
-    RETAINED->rtc.seconds = time.seconds;
-    RETAINED->rtc.microseconds = (time.microseconds / 31250) * 31250;
+    uint32_t periods;
+    uint32_t counter;
+    bool wrapped = fd_hal_rtc_read(&periods, &counter);
+    fd_time_t start = fd_time_subtract(time, fd_hal_rtc_get_period_offset(counter));
+    if (wrapped) {
+        // the pending interrupt will add the period
+        start.seconds -= FD_HAL_RTC_PERIOD_SECONDS;
+    }
+    RETAINED->rtc.seconds = start.seconds;
+    RETAINED->rtc.microseconds = start.microseconds;
     fd_hal_processor_interrupts_enable();
 }
 
 uint32_t fd_hal_rtc_get_seconds(void) {
-    return RETAINED->rtc.seconds;
+    return fd_hal_rtc_get_time().seconds;
 }
 
+// time to 1/32 s
 fd_time_t fd_hal_rtc_get_time(void) {
-    fd_time_t time;
     fd_hal_processor_interrupts_disable();
-    time.microseconds = RETAINED->rtc.microseconds;
-    time.seconds = RETAINED->rtc.seconds;
+    uint32_t periods;
+    uint32_t counter;
+    bool wrapped = fd_hal_rtc_read(&periods, &counter);
+    fd_time_t start = fd_hal_rtc_get_period_start(wrapped);
     fd_hal_processor_interrupts_enable();
-    return time;
+    return fd_time_add(start, fd_hal_rtc_get_period_offset(counter));
 }
 
+// time to 1/32768 s
 fd_time_t fd_hal_rtc_get_accurate_time(void) {
-    fd_time_t time;
+    fd_hal_processor_interrupts_disable();
+    uint32_t periods;
     uint32_t counter;
-    while (true) {
-        time.microseconds = RETAINED->rtc.microseconds;
-        time.seconds = RETAINED->rtc.seconds;
-        counter = RTC_CounterGet();
-        uint32_t again = RETAINED->rtc.microseconds;
-        if (time.microseconds == again) {
-            break;
-        }
-    }
-    time.microseconds += (counter * 31250) / 1024;
-    return time;
+    bool wrapped = fd_hal_rtc_read(&periods, &counter);
+    fd_time_t start = fd_hal_rtc_get_period_start(wrapped);
+    fd_hal_processor_interrupts_enable();
+    uint32_t microseconds = (counter * 15625) / 512; // 1000000 / 32768
+    fd_time_t offset;
+    offset.seconds = microseconds / 1000000;
+    offset.microseconds = microseconds % 1000000;
+    return fd_time_add(start, offset);
+}
+
+uint32_t fd_hal_rtc_get_ticks(void) {
+    fd_hal_processor_interrupts_disable();
+    uint32_t periods;
+    uint32_t counter;
+    fd_hal_rtc_read(&periods, &counter);
+    fd_hal_processor_interrupts_enable();
+    return (periods << (FD_HAL_RTC_PERIOD_SHIFT - FD_HAL_RTC_TICK_SHIFT)) + (counter >> FD_HAL_RTC_TICK_SHIFT);
+}
+
+uint32_t fd_hal_rtc_get_clock(void) {
+    fd_hal_processor_interrupts_disable();
+    uint32_t periods;
+    uint32_t counter;
+    fd_hal_rtc_read(&periods, &counter);
+    fd_hal_processor_interrupts_enable();
+    return (periods << FD_HAL_RTC_PERIOD_SHIFT) + counter;
 }
 
 void fd_hal_rtc_set_countdown(uint32_t countdown) {
     fd_hal_processor_interrupts_disable();
-    rtc_countdown = countdown;
+    if (countdown == 0) {
+        rtc_countdown_set = false;
+    } else {
+        if (countdown > FD_HAL_RTC_COUNTDOWN_LIMIT) {
+            countdown = FD_HAL_RTC_COUNTDOWN_LIMIT;
+        }
+        // ends on a tick boundary (like the countdown did when it was decremented every tick)
+        uint32_t tick_start = fd_hal_rtc_get_clock() & ~((1 << FD_HAL_RTC_TICK_SHIFT) - 1);
+        rtc_countdown_clock = tick_start + (countdown << FD_HAL_RTC_TICK_SHIFT);
+        rtc_countdown_set = true;
+    }
+    fd_hal_rtc_schedule();
     fd_hal_processor_interrupts_enable();
 }
 
 uint32_t fd_hal_rtc_get_countdown(void) {
     fd_hal_processor_interrupts_disable();
-    uint32_t countdown = rtc_countdown;
+    uint32_t countdown = 0;
+    if (rtc_countdown_set) {
+        int32_t remaining = (int32_t)(rtc_countdown_clock - fd_hal_rtc_get_clock());
+        if (remaining > 0) {
+            countdown = (remaining + (1 << FD_HAL_RTC_TICK_SHIFT) - 1) >> FD_HAL_RTC_TICK_SHIFT;
+        }
+    }
     fd_hal_processor_interrupts_enable();
     return countdown;
 }
 
-void RTC_IRQHandler(void) {
-    RTC_IntClear(RTC_IFC_COMP0);
-
-    if (RTC->COMP0 == 1023) {
-        uint32_t microseconds = RETAINED->rtc.microseconds + 31250;
-        if (microseconds >= 1000000) {
-            microseconds -= 1000000;
-            ++RETAINED->rtc.seconds;
-        }
-        RETAINED->rtc.microseconds = microseconds;
+uint32_t fd_hal_rtc_get_interrupt_count(void) {
+    return rtc_interrupt_count;
+}
 
-        fd_event_set(FD_EVENT_RTC_TICK);
+void RTC_IRQHandler(void) {
+    uint32_t interrupts = RTC_IntGet() & RTC->IEN;
+    RTC_IntClear(interrupts);
+    ++rtc_interrupt_count;
 
-        if (rtc_countdown) {
-            if (--rtc_countdown == 0) {
-                fd_event_set(FD_EVENT_RTC_COUNTDOWN);
-            }
-        }
-    } else {
-        RETAINED->rtc.seconds += 2;
+    if (interrupts & RTC_IF_COMP0) {
+        // the flag is set when the counter reaches the top, wait for the wrap so the period count and counter agree
+        while (RTC_CounterGet() > ((FD_HAL_RTC_TOP + 1) / 2));
+        ++rtc_periods;
+        RETAINED->rtc.seconds += FD_HAL_RTC_PERIOD_SECONDS;
     }
-}
+
+    fd_hal_rtc_schedule();
+}
\ No newline at end of file
@@ -23,7 +23,16 @@ fd_time_t fd_hal_rtc_get_time(void);
 
 fd_time_t fd_hal_rtc_get_accurate_time(void);
 
+// 1/32 s ticks (wraps)
+uint32_t fd_hal_rtc_get_ticks(void);
+// 1/32768 s clock (wraps)
+uint32_t fd_hal_rtc_get_clock(void);
+
+// FD_EVENT_RTC_COUNTDOWN is set after the given number of ticks (0 cancels)
 void fd_hal_rtc_set_countdown(uint32_t countdown);
 uint32_t fd_hal_rtc_get_countdown(void);
 
+// number of RTC interrupts (each one wakes the core)
+uint32_t fd_hal_rtc_get_interrupt_count(void);
+
 #endif
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "fd_hal_aes.h"
 #include "fd_hal_processor.h"
 #include "fd_hal_system.h"
+#include "fd_hrtimer.h"
 #include "fd_pins.h"
 
 #include <em_gpio.h>
@@ -34,7 +35,9 @@
  FD_CONTROL_CAPABILITY_RECOGNITION |\
  FD_CONTROL_CAPABILITY_HARDWARE_VERSION |\
  FD_CONTROL_CAPABILITY_RTC |\
- FD_CONTROL_CAPABILITY_HARDWARE)
+ FD_CONTROL_CAPABILITY_HARDWARE |\
+ FD_CONTROL_CAPABILITY_SENSING_RATE |\
+ FD_CONTROL_CAPABILITY_SENSING_HISTORY)
 
 // should come from gcc command line define for release build -denis
 #ifndef FIRMWARE_COMMIT
@@ -130,13 +133,21 @@ void fd_hal_system_set_update_metadata(uint8_t area, fd_version_metadata_t *meta
     fd_hal_processor_write_flash_data((void *)fd_hal_system_get_firmware_update_metadata_range(area).address, (uint8_t *)&metadata_stored, sizeof(fd_version_metadata_stored_t));
 }
 
+// the switching regulator is selected 1 ms after it is enabled (so it has time to start)
+static fd_hrtimer_t fd_hal_system_regulator_timer;
+
+static
+void fd_hal_system_regulator_select_switching(void) {
+    GPIO_PinModeSet(PWR_SEL_PORT_PIN, gpioModePushPull, 1);
+}
+
 void fd_hal_system_set_regulator(bool switching) {
     if (switching) {
         GPIO_PinModeSet(PWR_MODE_PORT_PIN, gpioModePushPull, 0);
         GPIO_PinModeSet(PWR_HIGH_PORT_PIN, gpioModePushPull, 1);
-        fd_hal_processor_delay_ms(1);
-        GPIO_PinModeSet(PWR_SEL_PORT_PIN, gpioModePushPull, 1);
+        fd_hrtimer_start_us(&fd_hal_system_regulator_timer, 1000);
     } else {
+        fd_hrtimer_stop(&fd_hal_system_regulator_timer);
         GPIO_PinModeSet(PWR_SEL_PORT_PIN, gpioModePushPull, 0);
         GPIO_PinModeSet(PWR_MODE_PORT_PIN, gpioModePushPull, 0);
         GPIO_PinModeSet(PWR_HIGH_PORT_PIN, gpioModePushPull, 0);
@@ -230,6 +241,8 @@ void fd_hal_system_charge_current_callback(void) {
 }
 
 void fd_hal_system_initialize(void) {
+    fd_hrtimer_add(&fd_hal_system_regulator_timer, fd_hal_system_regulator_select_switching);
+
     fd_event_add_callback(FD_EVENT_ADC_TEMPERATURE, fd_hal_system_temperature_callback);
     fd_event_add_callback(FD_EVENT_ADC_BATTERY_VOLTAGE, fd_hal_system_battery_voltage_callback);
     fd_event_add_callback(FD_EVENT_ADC_CHARGE_CURRENT, fd_hal_system_charge_current_callback);
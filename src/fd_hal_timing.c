@@ -0,0 +1,32 @@
+#include "fd_timing.h"
+
+#include <em_part.h>
+
+#include <stdbool.h>
+
+// timestamps are core clock cycles from the DWT cycle counter (which does not count in EM2)
+
+static bool fd_hal_timing_enable;
+
+void fd_hal_timing_initialize(void) {
+    fd_hal_timing_enable = false;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+bool fd_hal_timing_get_enable(void) {
+    return fd_hal_timing_enable;
+}
+
+void fd_hal_timing_set_enable(bool enable) {
+    fd_hal_timing_enable = enable;
+}
+
+void fd_hal_timing_adjust(void) {
+}
+
+uint32_t fd_hal_timing_get_timestamp(void) {
+    return DWT->CYCCNT;
+}
\ No newline at end of file
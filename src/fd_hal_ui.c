@@ -208,10 +208,10 @@ void fd_hal_ui_initialize(void) {
     owner_indicates[1].state = fd_hal_ui_owner_indicate_state_unset;
     owner_indicates[1].time = 0;
 
-    fd_event_add_callback(FD_EVENT_CHG_STAT, fd_hal_ui_charge_status_callback);
-    fd_event_add_callback(FD_EVENT_USB_STATE, fd_hal_ui_usb_state_callback);
-    fd_event_add_callback(FD_EVENT_BLE_STATE, fd_hal_ui_ble_state_callback);
-    fd_event_add_callback(FD_EVENT_LOCK_STATE, fd_hal_ui_lock_state_callback);
+    fd_event_add_prioritized_callback(FD_EVENT_CHG_STAT, FD_EVENT_PRIORITY_LOW, fd_hal_ui_charge_status_callback);
+    fd_event_add_prioritized_callback(FD_EVENT_USB_STATE, FD_EVENT_PRIORITY_LOW, fd_hal_ui_usb_state_callback);
+    fd_event_add_prioritized_callback(FD_EVENT_BLE_STATE, FD_EVENT_PRIORITY_LOW, fd_hal_ui_ble_state_callback);
+    fd_event_add_prioritized_callback(FD_EVENT_LOCK_STATE, FD_EVENT_PRIORITY_LOW, fd_hal_ui_lock_state_callback);
 
     fd_timer_add(&error_check_timer, error_check_timer_callback);
 
@@ -0,0 +1,104 @@
+#include "fd_event.h"
+#include "fd_hal_hrtimer.h"
+#include "fd_hrtimer.h"
+
+// active timers in deadline order
+static fd_hrtimer_t *fd_hrtimer_head;
+
+static
+bool fd_hrtimer_is_before(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) < 0;
+}
+
+static
+void fd_hrtimer_schedule(void) {
+    if (fd_hrtimer_head) {
+        fd_hal_hrtimer_set_compare(fd_hrtimer_head->deadline);
+    } else {
+        fd_hal_hrtimer_clear_compare();
+    }
+}
+
+static
+void fd_hrtimer_update(void) {
+    uint32_t now = fd_hal_hrtimer_get_ticks();
+    while (fd_hrtimer_head && !fd_hrtimer_is_before(now, fd_hrtimer_head->deadline)) {
+        fd_hrtimer_t *timer = fd_hrtimer_head;
+        fd_hrtimer_head = timer->next;
+        timer->next = 0;
+        timer->active = false;
+        (*timer->callback)();
+    }
+    fd_hrtimer_schedule();
+}
+
+void fd_hrtimer_initialize(void) {
+    fd_hrtimer_head = 0;
+
+    fd_event_add_prioritized_callback(FD_EVENT_HRTIMER, FD_EVENT_PRIORITY_HIGH, fd_hrtimer_update);
+}
+
+void fd_hrtimer_add(fd_hrtimer_t *timer, fd_hrtimer_callback_t callback) {
+    timer->next = 0;
+    timer->callback = callback;
+    timer->active = false;
+    timer->deadline = 0;
+}
+
+static
+void fd_hrtimer_remove(fd_hrtimer_t *timer) {
+    fd_hrtimer_t **link = &fd_hrtimer_head;
+    while (*link) {
+        if (*link == timer) {
+            *link = timer->next;
+            break;
+        }
+        link = &(*link)->next;
+    }
+    timer->next = 0;
+    timer->active = false;
+}
+
+static
+void fd_hrtimer_start_ticks(fd_hrtimer_t *timer, uint32_t ticks) {
+    bool was_first = timer == fd_hrtimer_head;
+    if (timer->active) {
+        fd_hrtimer_remove(timer);
+    }
+    timer->deadline = fd_hal_hrtimer_get_ticks() + ticks;
+    timer->active = true;
+
+    // timers with the same deadline expire in the order started
+    fd_hrtimer_t **link = &fd_hrtimer_head;
+    while (*link && !fd_hrtimer_is_before(timer->deadline, (*link)->deadline)) {
+        link = &(*link)->next;
+    }
+    timer->next = *link;
+    *link = timer;
+
+    if (was_first || (timer == fd_hrtimer_head)) {
+        fd_hrtimer_schedule();
+    }
+}
+
+// 32768 / 1000000 = 512 / 15625 (rounded up so the timer never expires early)
+void fd_hrtimer_start_us(fd_hrtimer_t *timer, uint32_t microseconds) {
+    uint32_t ticks = (microseconds / 1000000) * FD_HAL_HRTIMER_FREQUENCY + ((microseconds % 1000000) * 512 + 15625 - 1) / 15625;
+    fd_hrtimer_start_ticks(timer, ticks);
+}
+
+void fd_hrtimer_start(fd_hrtimer_t *timer, fd_time_t duration) {
+    uint32_t ticks = duration.seconds * FD_HAL_HRTIMER_FREQUENCY + (duration.microseconds * 512 + 15625 - 1) / 15625;
+    fd_hrtimer_start_ticks(timer, ticks);
+}
+
+void fd_hrtimer_stop(fd_hrtimer_t *timer) {
+    if (!timer->active) {
+        return;
+    }
+    bool was_first = timer == fd_hrtimer_head;
+    fd_hrtimer_remove(timer);
+    if (was_first) {
+        fd_hrtimer_schedule();
+    }
+}
\ No newline at end of file
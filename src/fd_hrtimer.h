@@ -0,0 +1,28 @@
+#ifndef FD_HRTIMER_H
+#define FD_HRTIMER_H
+
+#include "fd_time.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Like fd_timer, but with ~30.5 us resolution (instead of 1/32 s) for short waits.
+
+typedef void (*fd_hrtimer_callback_t)(void);
+
+typedef struct fd_hrtimer_s {
+    struct fd_hrtimer_s *next;
+    fd_hrtimer_callback_t callback;
+    bool active;
+    // absolute fd_hal_hrtimer tick that the timer expires at
+    uint32_t deadline;
+} fd_hrtimer_t;
+
+void fd_hrtimer_initialize(void);
+void fd_hrtimer_add(fd_hrtimer_t *timer, fd_hrtimer_callback_t callback);
+
+void fd_hrtimer_start(fd_hrtimer_t *timer, fd_time_t duration);
+void fd_hrtimer_start_us(fd_hrtimer_t *timer, uint32_t microseconds);
+void fd_hrtimer_stop(fd_hrtimer_t *timer);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include "fd_event.h"
+#include "fd_hal_hrtimer.h"
+#include "fd_hrtimer.h"
+#include "fd_log.h"
+
+static fd_hrtimer_t fd_hrtimer_test_a;
+static fd_hrtimer_t fd_hrtimer_test_b;
+static uint32_t fd_hrtimer_test_a_at;
+static uint32_t fd_hrtimer_test_b_at;
+static uint32_t fd_hrtimer_test_a_count;
+
+static
+void fd_hrtimer_test_a_callback(void) {
+    fd_hrtimer_test_a_at = fd_hal_hrtimer_get_ticks();
+    ++fd_hrtimer_test_a_count;
+}
+
+static
+void fd_hrtimer_test_b_callback(void) {
+    fd_hrtimer_test_b_at = fd_hal_hrtimer_get_ticks();
+}
+
+static
+void fd_hrtimer_test_run(uint32_t ticks) {
+    fd_event_process_pending();
+    while (ticks--) {
+        fd_hal_hrtimer_sim_advance(1);
+        fd_event_process_pending();
+    }
+}
+
+void fd_hrtimer_unit_tests(void) {
+    fd_event_initialize();
+    fd_hal_hrtimer_initialize();
+    fd_hrtimer_initialize();
+    fd_hrtimer_add(&fd_hrtimer_test_a, fd_hrtimer_test_a_callback);
+    fd_hrtimer_add(&fd_hrtimer_test_b, fd_hrtimer_test_b_callback);
+    fd_hrtimer_test_a_count = 0;
+
+    // 1 ms is 32.768 ticks, rounded up
+    uint32_t start = fd_hal_hrtimer_get_ticks();
+    fd_hrtimer_start_us(&fd_hrtimer_test_a, 1000);
+    fd_hrtimer_start_us(&fd_hrtimer_test_b, 500);
+    fd_hrtimer_test_run(100);
+    fd_log_assert(fd_hrtimer_test_b_at == start + 17);
+    fd_log_assert(fd_hrtimer_test_a_at == start + 33);
+    fd_log_assert(!fd_hrtimer_test_a.active);
+
+    // restarting moves the deadline, stopping cancels it
+    fd_hrtimer_test_a_count = 0;
+    start = fd_hal_hrtimer_get_ticks();
+    fd_hrtimer_start_us(&fd_hrtimer_test_a, 100);
+    fd_hrtimer_start_us(&fd_hrtimer_test_b, 200);
+    fd_hrtimer_test_run(2);
+    fd_hrtimer_start_us(&fd_hrtimer_test_a, 1000);
+    fd_hrtimer_stop(&fd_hrtimer_test_b);
+    fd_hrtimer_test_b_at = 0;
+    fd_hrtimer_test_run(100);
+    fd_log_assert(fd_hrtimer_test_a_count == 1);
+    fd_log_assert(fd_hrtimer_test_a_at == start + 2 + 33);
+    fd_log_assert(fd_hrtimer_test_b_at == 0);
+
+    // fd_time_t durations
+    start = fd_hal_hrtimer_get_ticks();
+    fd_time_t duration = {.seconds = 1, .microseconds = 250000};
+    fd_hrtimer_start(&fd_hrtimer_test_a, duration);
+    fd_hrtimer_test_run(FD_HAL_HRTIMER_FREQUENCY * 2);
+    fd_log_assert(fd_hrtimer_test_a_at == start + FD_HAL_HRTIMER_FREQUENCY + FD_HAL_HRTIMER_FREQUENCY / 4);
+}
\ No newline at end of file
@@ -38,8 +38,11 @@ void fd_i2c1_power_on(void) {
     GPIO_PinModeSet(I2C1_SDA_PORT_PIN, gpioModeWiredAnd, 1);
     GPIO_PinModeSet(I2C1_SCL_PORT_PIN, gpioModeWiredAnd, 1);
 
-    GPIO_PinOutSet(I2C1_PWR_PORT_PIN);
-    fd_hal_processor_delay_ms(100); // wait for power to come up (?ms)
+    // the power is left on in storage mode, so only wait when it is actually being turned on
+    if (!GPIO_PinOutGet(I2C1_PWR_PORT_PIN)) {
+        GPIO_PinOutSet(I2C1_PWR_PORT_PIN);
+        fd_hal_processor_delay_ms(100); // wait for power to come up (?ms)
+    }
 
     NVIC_ClearPendingIRQ(I2C1_IRQn);
 //    NVIC_EnableIRQ(I2C1_IRQn);
@@ -1,4 +1,3 @@
-#include "fd_event.h"
 #include "fd_indicator.h"
 #include "fd_led.h"
 #include "fd_timer.h"
@@ -758,14 +757,28 @@ void fd_indicator_set_error_condition(fd_indicator_error_condition_t condition)
 // indicator
 
 static bool fd_indicator_running;
+// animations step every 1/32 s, only while any are running (so the core is not woken when idle)
+static fd_timer_t fd_indicator_timer;
+
+static
+void fd_indicator_start_step(void) {
+    fd_time_t duration;
+    duration.seconds = 0;
+    duration.microseconds = 31250;
+    fd_timer_start(&fd_indicator_timer, duration);
+}
 
 void fd_indicator_running_check(void) {
+    bool was_running = fd_indicator_running;
     fd_indicator_running =
         usb.animation.running |
         usb_connection.animation.running |
         ble_connection.animation.running |
         identify.animation.running |
         error.animation.running;
+    if (fd_indicator_running && !was_running) {
+        fd_indicator_start_step();
+    }
 }
 
 void fd_indicator_step(void) {
@@ -776,6 +789,9 @@ void fd_indicator_step(void) {
         fd_indicator_animation_step(&identify.animation);
         fd_indicator_animation_step(&error.animation);
     }
+    if (fd_indicator_running) {
+        fd_indicator_start_step();
+    }
 }
 
 void fd_indicator_sleep(void) {
@@ -784,11 +800,12 @@ void fd_indicator_sleep(void) {
     connection_initialize(&ble_connection, 1, 0.0f, 0.0f, 1.0f, ble_connection_show);
     identify_initialize();
     error_initialize();
+    fd_indicator_running = false;
+    fd_timer_stop(&fd_indicator_timer);
 }
 
 void fd_indicator_initialize(void) {
     fd_indicator_running = false;
+    fd_timer_add(&fd_indicator_timer, fd_indicator_step);
     fd_indicator_sleep();
-
-    fd_event_add_callback(FD_EVENT_RTC_TICK, fd_indicator_step);
 }
@@ -7,6 +7,7 @@
 
 #include <em_gpio.h>
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #define LIS3DH_WHO_AM_I 0x0f
@@ -87,6 +88,28 @@
 
 #define FIFO_THRESHOLD 16
 
+// poll the 32 deep fifo when it should be about 75% full
+#define FIFO_POLL_SAMPLES (FIFO_THRESHOLD + FIFO_THRESHOLD / 2)
+// the poll can be delayed (to share a wakeup with other timers) by this many samples without overrunning the fifo
+#define FIFO_POLL_SLACK_SAMPLES 6
+
+typedef struct {
+    uint32_t rate;
+    uint8_t odr;
+} fd_lis3dh_rate_t;
+
+static const fd_lis3dh_rate_t fd_lis3dh_rates[] = {
+    {1, LIS3DH_CTRL_REG1_ODR_1HZ},
+    {10, LIS3DH_CTRL_REG1_ODR_10HZ},
+    {25, LIS3DH_CTRL_REG1_ODR_25HZ},
+    {50, LIS3DH_CTRL_REG1_ODR_50HZ},
+    {100, LIS3DH_CTRL_REG1_ODR_100HZ},
+    {200, LIS3DH_CTRL_REG1_ODR_200HZ},
+    {400, LIS3DH_CTRL_REG1_ODR_400HZ},
+};
+
+#define FD_LIS3DH_RATE_COUNT (sizeof(fd_lis3dh_rates) / sizeof(fd_lis3dh_rate_t))
+
 typedef union {
     uint8_t bytes[6];
     struct __attribute__ ((packed)) {
@@ -101,20 +124,35 @@ typedef union {
 
 static fd_hal_accelerometer_sample_callback_t sample_callback;
 static fd_timer_t fifo_timer;
+static const fd_lis3dh_rate_t *fd_lis3dh_rate;
+static bool fd_lis3dh_awake;
+static uint32_t fd_lis3dh_fifo_reads;
+static uint32_t fd_lis3dh_fifo_overruns;
 
 static
 void fd_lis3dh_schedule(void) {
     // Early board revisions use pin 4 (same as radio) so we can't use interrupts for fifo
-    // and a timer is used instead.  At 25 samples per second and 32 deep fifo we check
-    // the fifo every 1s at which point it should be about 75% full. -denis
+    // and a timer is used instead.  The fifo is checked when it should be about 75% full
+    // (~1s at 25 samples per second). -denis
+    uint32_t microseconds = (FIFO_POLL_SAMPLES * 1000000) / fd_lis3dh_rate->rate;
     fd_time_t duration;
-    duration.seconds = 1;
-    duration.microseconds = 0;
+    duration.seconds = microseconds / 1000000;
+    duration.microseconds = microseconds % 1000000;
+    uint32_t slack_microseconds = (FIFO_POLL_SLACK_SAMPLES * 1000000) / fd_lis3dh_rate->rate;
+    fd_time_t slack;
+    slack.seconds = slack_microseconds / 1000000;
+    slack.microseconds = slack_microseconds % 1000000;
+    fd_timer_set_slack(&fifo_timer, slack);
     fd_timer_start(&fifo_timer, duration);
 }
 
 void fd_lis3dh_read_fifo(void) {
+    ++fd_lis3dh_fifo_reads;
     uint8_t src = fd_spi_sync_tx1_rx1(FD_SPI_BUS_1_SLAVE_LIS3DH, SPI_READ | LIS3DH_FIFO_SRC_REG);
+    if (src & LIS3DH_FIFO_SRC_REG_OVRN_FIFO) {
+        // the fifo filled up and the oldest samples were overwritten
+        ++fd_lis3dh_fifo_overruns;
+    }
     uint8_t count = src & LIS3DH_FIFO_SRC_REG_FSS;
     while (count--) {
         uint8_t tx_bytes[] = {SPI_READ | SPI_ADDRESS_INCREMENT | LIS3DH_OUT_X_L};
@@ -134,6 +172,10 @@ void fd_lis3dh_read_fifo(void) {
 
 void fd_lis3dh_initialize(void) {
     sample_callback = 0;
+    fd_lis3dh_rate = &fd_lis3dh_rates[2]; // 25 Hz
+    fd_lis3dh_awake = false;
+    fd_lis3dh_fifo_reads = 0;
+    fd_lis3dh_fifo_overruns = 0;
 
     uint8_t who_am_i = fd_spi_sync_tx1_rx1(FD_SPI_BUS_1_SLAVE_LIS3DH, SPI_READ | LIS3DH_WHO_AM_I);
     if (who_am_i != 0x33) {
@@ -180,11 +222,61 @@ void fd_lis3dh_initialize(void) {
     fd_timer_add(&fifo_timer, fd_lis3dh_read_fifo);
 }
 
+uint32_t fd_lis3dh_get_fifo_reads(void) {
+    return fd_lis3dh_fifo_reads;
+}
+
+uint32_t fd_lis3dh_get_fifo_overruns(void) {
+    return fd_lis3dh_fifo_overruns;
+}
+
 void fd_lis3dh_set_sample_callback(fd_hal_accelerometer_sample_callback_t callback) {
     sample_callback = callback;
 }
 
+static
+void fd_lis3dh_set_data_rate(void) {
+    fd_spi_sync_tx2(
+        FD_SPI_BUS_1_SLAVE_LIS3DH,
+        LIS3DH_CTRL_REG1,
+        fd_lis3dh_rate->odr |
+//        LIS3DH_CTRL_REG1_LPEN |
+        LIS3DH_CTRL_REG1_ZEN |
+        LIS3DH_CTRL_REG1_YEN |
+        LIS3DH_CTRL_REG1_XEN
+    );
+}
+
+void fd_lis3dh_set_sample_rate(uint32_t rate) {
+    // use the slowest output data rate that is at least the requested rate
+    const fd_lis3dh_rate_t *match = &fd_lis3dh_rates[FD_LIS3DH_RATE_COUNT - 1];
+    for (uint32_t i = 0; i < FD_LIS3DH_RATE_COUNT; ++i) {
+        if (fd_lis3dh_rates[i].rate >= rate) {
+            match = &fd_lis3dh_rates[i];
+            break;
+        }
+    }
+    if (match == fd_lis3dh_rate) {
+        return;
+    }
+
+    if (fd_lis3dh_awake) {
+        // deliver samples taken at the old rate before switching
+        fd_lis3dh_read_fifo();
+    }
+    fd_lis3dh_rate = match;
+    if (fd_lis3dh_awake) {
+        fd_lis3dh_set_data_rate();
+        fd_lis3dh_schedule();
+    }
+}
+
+uint32_t fd_lis3dh_get_sample_rate(void) {
+    return fd_lis3dh_rate->rate;
+}
+
 void fd_lis3dh_sleep(void) {
+    fd_lis3dh_awake = false;
     fd_timer_stop(&fifo_timer);
 
     fd_spi_sync_tx2(
@@ -195,17 +287,10 @@ void fd_lis3dh_sleep(void) {
 }
 
 void fd_lis3dh_wake(void) {
+    fd_lis3dh_awake = true;
     fd_lis3dh_schedule();
 
-    fd_spi_sync_tx2(
-        FD_SPI_BUS_1_SLAVE_LIS3DH,
-        LIS3DH_CTRL_REG1,
-        LIS3DH_CTRL_REG1_ODR_25HZ |
-//        LIS3DH_CTRL_REG1_LPEN |
-        LIS3DH_CTRL_REG1_ZEN |
-        LIS3DH_CTRL_REG1_YEN |
-        LIS3DH_CTRL_REG1_XEN
-    );
+    fd_lis3dh_set_data_rate();
 }
 
 void fd_lis3dh_read(int16_t *x, int16_t *y, int16_t *z) {
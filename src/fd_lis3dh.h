@@ -3,15 +3,23 @@
 
 #include "fd_hal_accelerometer.h"
 
+#include <stdint.h>
+
 void fd_lis3dh_initialize(void);
 
 void fd_lis3dh_set_sample_callback(fd_hal_accelerometer_sample_callback_t callback);
 
+void fd_lis3dh_set_sample_rate(uint32_t rate);
+uint32_t fd_lis3dh_get_sample_rate(void);
+
 void fd_lis3dh_sleep(void);
 void fd_lis3dh_wake(void);
 
 void fd_lis3dh_read_fifo(void);
 
+uint32_t fd_lis3dh_get_fifo_reads(void);
+uint32_t fd_lis3dh_get_fifo_overruns(void);
+
 void fd_lis3dh_read(int16_t *x, int16_t *y, int16_t *z);
 
 #endif
\ No newline at end of file
@@ -1,3 +1,4 @@
+#include "fd_binary.h"
 #include "fd_map.h"
 
 #include <string.h>
@@ -9,37 +10,170 @@
 //   - uint8_t type of value
 //   - uint16_t length of value
 //   - uint16_t offset of key, value bytes
+// - key, value bytes
+//
+// A sorted map has a uint16_t 0 (so older code that only knows the format above sees an empty map), then
+// uint16_t FD_MAP_SORTED_V1 and the uint16_t number of entries, then the entries and bytes as above.  Sorted
+// entries are ordered by key length, then key bytes, then type, so they can be binary searched.  A map with one
+// entry is written in the original format (it is already sorted).
+//
+// All values are little endian and the map may be at any alignment.
+
+// 'S' and the sorted format version (a later incompatible layout changes the version, and is not read as this one)
+#define FD_MAP_SORTED_V1 0x0153
+#define FD_MAP_SORTED_HEADER_SIZE 4
+
+#define FD_MAP_COUNT_LIMIT 0xffff
+
+#define FD_MAP_ENTRY_SIZE 6
+
+// nothing written to flash yet
+#define FD_MAP_ERASED 0xffff
+
+static
+int fd_map_compare(uint8_t *entry, uint8_t *content, const char *key, uint8_t key_length, uint8_t type) {
+    uint8_t entry_key_length = entry[0];
+    if (entry_key_length != key_length) {
+        return entry_key_length < key_length ? -1 : 1;
+    }
+    uint16_t key_value_offset = fd_binary_unpack_uint16(&entry[4]);
+    int result = memcmp(content + key_value_offset, key, key_length);
+    if (result != 0) {
+        return result;
+    }
+    uint8_t entry_type = entry[1];
+    if (entry_type != type) {
+        return entry_type < type ? -1 : 1;
+    }
+    return 0;
+}
+
+static
+void fd_map_found(uint8_t *entry, uint8_t *content, uint8_t **value, uint16_t *length) {
+    uint16_t key_value_offset = fd_binary_unpack_uint16(&entry[4]);
+    *value = content + key_value_offset + entry[0];
+    *length = fd_binary_unpack_uint16(&entry[2]);
+}
 
 void fd_map_get(uint8_t *map, const char *key, uint8_t type, uint8_t **value, uint16_t *length) {
     *value = 0;
     *length = 0;
 
-    uint8_t *p = map;
-    uint16_t count = *((uint16_t *)p);
-    p += 2;
-    if (count == 0xffff) { // nothing written to flash yet
+    uint16_t count = fd_binary_unpack_uint16(map);
+    if (count == FD_MAP_ERASED) {
+        return;
+    }
+    uint8_t *entries = map + 2;
+    bool sorted = false;
+    if ((count == 0) && (fd_binary_unpack_uint16(entries) == FD_MAP_SORTED_V1)) {
+        sorted = true;
+        count = fd_binary_unpack_uint16(&entries[2]);
+        entries += FD_MAP_SORTED_HEADER_SIZE;
+    }
+    uint8_t *content = entries + FD_MAP_ENTRY_SIZE * count;
+    size_t key_length = strlen(key);
+    if (key_length > 0xff) {
+        return;
+    }
+
+    if (sorted) {
+        uint32_t low = 0;
+        uint32_t high = count;
+        while (low < high) {
+            uint32_t middle = (low + high) / 2;
+            uint8_t *entry = entries + FD_MAP_ENTRY_SIZE * middle;
+            int result = fd_map_compare(entry, content, key, key_length, type);
+            if (result == 0) {
+                fd_map_found(entry, content, value, length);
+                return;
+            }
+            if (result < 0) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
         return;
     }
-    uint8_t *content = p + 6 * count;
-    uint16_t key_length = strlen(key);
-    for (int i = 0; i < count; ++i) {
-        uint8_t entry_key_length = *p++;
-        uint8_t value_type = *p++;
-        uint16_t value_length = *((uint16_t *)p);
-        p += 2;
-        uint16_t key_value_offset = *((uint16_t *)p);
-        p += 2;
-        if (value_type != type) {
-            continue;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        uint8_t *entry = entries + FD_MAP_ENTRY_SIZE * i;
+        if (fd_map_compare(entry, content, key, key_length, type) == 0) {
+            fd_map_found(entry, content, value, length);
+            return;
         }
-        if (entry_key_length != key_length) {
-            continue;
+    }
+}
+
+static
+int fd_map_entry_compare(fd_map_entry_t *a, fd_map_entry_t *b) {
+    size_t a_length = strlen(a->key);
+    size_t b_length = strlen(b->key);
+    if (a_length != b_length) {
+        return a_length < b_length ? -1 : 1;
+    }
+    int result = memcmp(a->key, b->key, a_length);
+    if (result != 0) {
+        return result;
+    }
+    if (a->type != b->type) {
+        return a->type < b->type ? -1 : 1;
+    }
+    return 0;
+}
+
+uint32_t fd_map_build(fd_map_entry_t *entries, uint32_t count, uint8_t *map, uint32_t size) {
+    if (count >= FD_MAP_COUNT_LIMIT) {
+        return 0;
+    }
+
+    // insertion sort: maps are small
+    for (uint32_t i = 1; i < count; ++i) {
+        fd_map_entry_t entry = entries[i];
+        uint32_t j = i;
+        while ((j > 0) && (fd_map_entry_compare(&entries[j - 1], &entry) > 0)) {
+            entries[j] = entries[j - 1];
+            --j;
         }
-        if (memcmp(content + key_value_offset, key, key_length) != 0) {
-            continue;
+        entries[j] = entry;
+    }
+
+    uint32_t content_size = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        fd_map_entry_t *entry = &entries[i];
+        size_t key_length = strlen(entry->key);
+        if (key_length > 0xff) {
+            return 0;
         }
-        *value = content + key_value_offset + key_length;
-        *length = value_length;
-        break;
+        content_size += key_length + entry->length;
+    }
+    bool sorted = count > 1;
+    uint32_t header_size = 2 + (sorted ? FD_MAP_SORTED_HEADER_SIZE : 0);
+    if ((content_size > 0xffff) || ((header_size + FD_MAP_ENTRY_SIZE * count + content_size) > size)) {
+        return 0;
+    }
+
+    fd_binary_t binary;
+    fd_binary_initialize(&binary, map, size);
+    if (sorted) {
+        fd_binary_put_uint16(&binary, 0);
+        fd_binary_put_uint16(&binary, FD_MAP_SORTED_V1);
+    }
+    fd_binary_put_uint16(&binary, count);
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        fd_map_entry_t *entry = &entries[i];
+        size_t key_length = strlen(entry->key);
+        fd_binary_put_uint8(&binary, key_length);
+        fd_binary_put_uint8(&binary, entry->type);
+        fd_binary_put_uint16(&binary, entry->length);
+        fd_binary_put_uint16(&binary, offset);
+        offset += key_length + entry->length;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        fd_map_entry_t *entry = &entries[i];
+        fd_binary_put_bytes(&binary, (const uint8_t *)entry->key, strlen(entry->key));
+        fd_binary_put_bytes(&binary, entry->value, entry->length);
     }
+    return binary.put_index;
 }
\ No newline at end of file
@@ -7,4 +7,15 @@
 
 void fd_map_get(uint8_t *map, const char *key, uint8_t type, uint8_t **value, uint16_t *length);
 
+typedef struct {
+    const char *key;
+    uint8_t type;
+    const uint8_t *value;
+    uint16_t length;
+} fd_map_entry_t;
+
+// builds a sorted map (the entries are sorted in place), returns the map size or 0 if it does not fit.  code that
+// only knows the original unsorted format sees a sorted map with more than one entry as empty.
+uint32_t fd_map_build(fd_map_entry_t *entries, uint32_t count, uint8_t *map, uint32_t size);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include "fd_log.h"
+#include "fd_map.h"
+
+#include <string.h>
+
+#define FD_MAP_TEST_LIMIT 64
+
+static
+void fd_map_test_key(char *key, uint32_t i) {
+    // keys of varying lengths, not in sorted order
+    uint32_t n = (i * 37) % FD_MAP_TEST_LIMIT;
+    key[0] = 'k';
+    uint32_t length = 1;
+    for (uint32_t j = 0; j < n % 5; ++j) {
+        key[length++] = 'x';
+    }
+    key[length++] = 'a' + n / 8;
+    key[length++] = 'a' + n % 8;
+    key[length] = '\0';
+}
+
+void fd_map_unit_tests(void) {
+    uint8_t *value;
+    uint16_t length;
+
+    // nothing written to flash yet
+    uint8_t erased[] = {0xff, 0xff};
+    fd_map_get(erased, "name", FD_MAP_TYPE_UTF8, &value, &length);
+    fd_log_assert((value == 0) && (length == 0));
+
+    // original (unsorted) format
+    uint8_t unsorted[] = {
+        0x02, 0x00,
+        4, FD_MAP_TYPE_UTF8, 3, 0, 0, 0,
+        4, FD_MAP_TYPE_UTF8, 2, 0, 7, 0,
+        'n', 'a', 'm', 'e', 'i', 'c', 'e',
+        's', 'i', 't', 'e', 'h', 'q',
+    };
+    fd_map_get(unsorted, "site", FD_MAP_TYPE_UTF8, &value, &length);
+    fd_log_assert((length == 2) && (memcmp(value, "hq", 2) == 0));
+    fd_map_get(unsorted, "name", FD_MAP_TYPE_UTF8, &value, &length);
+    fd_log_assert((length == 3) && (memcmp(value, "ice", 3) == 0));
+    fd_map_get(unsorted, "name", 0x02, &value, &length);
+    fd_log_assert(value == 0);
+
+    // original format with no entries
+    uint8_t empty[] = {0x00, 0x00, 0xff, 0xff};
+    fd_map_get(empty, "name", FD_MAP_TYPE_UTF8, &value, &length);
+    fd_log_assert(value == 0);
+
+    // sorted maps of increasing size (built at an odd alignment)
+    static char keys[FD_MAP_TEST_LIMIT][8];
+    static uint8_t values[FD_MAP_TEST_LIMIT];
+    static fd_map_entry_t entries[FD_MAP_TEST_LIMIT];
+    static uint8_t buffer[1 + 6 + FD_MAP_TEST_LIMIT * (6 + 8 + 1)];
+    uint8_t *map = &buffer[1];
+    for (uint32_t count = 1; count <= FD_MAP_TEST_LIMIT; count *= 2) {
+        for (uint32_t i = 0; i < count; ++i) {
+            fd_map_test_key(keys[i], i);
+            values[i] = i;
+            entries[i].key = keys[i];
+            entries[i].type = FD_MAP_TYPE_UTF8;
+            entries[i].value = &values[i];
+            entries[i].length = 1;
+        }
+        uint32_t size = fd_map_build(entries, count, map, sizeof(buffer) - 1);
+        fd_log_assert(size > 0);
+        // one entry is written in the original format, more have a count of 0 for code that only knows that format
+        uint16_t legacy_count = map[0] | (map[1] << 8);
+        fd_log_assert(legacy_count == ((count == 1) ? 1 : 0));
+        for (uint32_t i = 0; i < count; ++i) {
+            fd_map_get(map, keys[i], FD_MAP_TYPE_UTF8, &value, &length);
+            fd_log_assert((length == 1) && (value != 0) && (*value == i));
+        }
+        fd_map_get(map, "missing", FD_MAP_TYPE_UTF8, &value, &length);
+        fd_log_assert(value == 0);
+    }
+
+    // does not fit
+    fd_log_assert(fd_map_build(entries, FD_MAP_TEST_LIMIT, map, 16) == 0);
+}
\ No newline at end of file
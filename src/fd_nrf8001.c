@@ -4,6 +4,8 @@
 
 static uint32_t system_credits;
 static uint32_t data_credits;
+static uint32_t data_credits_maximum;
+static fd_nrf8001_data_credit_statistics_t data_credit_statistics;
 
 uint8_t fd_nrf8001_spi_tx_buffer[FD_NRF8001_SPI_TX_BUFFER_SIZE];
 uint32_t fd_nrf8001_spi_tx_length;
@@ -11,6 +13,8 @@ uint32_t fd_nrf8001_spi_tx_length;
 void fd_nrf8001_initialize(void) {
     system_credits = 0;
     data_credits = 0;
+    data_credits_maximum = 2;
+    memset(&data_credit_statistics, 0, sizeof(data_credit_statistics));
 
     fd_nrf8001_spi_tx_length = 0;
     for (int i = 0; i < FD_NRF8001_SPI_TX_BUFFER_SIZE; ++i) {
@@ -76,16 +80,30 @@ void fd_nrf8001_data_credit_change(void) {
 
 void fd_nrf8001_set_data_credits(uint32_t credits) {
     data_credits = credits;
+    // the device started event reports how many data credits the nRF8001 has
+    if (credits > data_credits_maximum) {
+        data_credits_maximum = credits;
+    }
 
     fd_nrf8001_data_credit_change();
 }
 
+void fd_nrf8001_get_data_credit_statistics(fd_nrf8001_data_credit_statistics_t *statistics) {
+    *statistics = data_credit_statistics;
+}
+
 void fd_nrf8001_add_data_credits(uint32_t credits) {
     data_credits += credits;
 
-    if (data_credits > 2) {
+    ++data_credit_statistics.events;
+    data_credit_statistics.returned += credits;
+    if (credits > data_credit_statistics.max_returned) {
+        data_credit_statistics.max_returned = credits;
+    }
+
+    if (data_credits > data_credits_maximum) {
         fd_nrf8001_error();
-        data_credits = 2;
+        data_credits = data_credits_maximum;
     }
 
     fd_nrf8001_data_credit_change();
@@ -100,6 +118,11 @@ void fd_nrf8001_use_data_credits(uint32_t credits) {
 
     data_credits -= credits;
 
+    data_credit_statistics.used += credits;
+    if ((credits > 0) && (data_credits == 0)) {
+        ++data_credit_statistics.exhausted;
+    }
+
     fd_nrf8001_data_credit_change();
 }
 
@@ -121,6 +144,10 @@ void fd_nrf8001_spi_tx_queue(uint8_t *data, uint32_t length) {
     fd_nrf8001_spi_tx_length += length;
 }
 
+bool fd_nrf8001_can_send(void) {
+    return fd_nrf8001_spi_tx_length == 0;
+}
+
 void fd_nrf8001_send(uint8_t *message, uint32_t length) {
     if (fd_nrf8001_spi_tx_length != 0) {
         fd_nrf8001_error();
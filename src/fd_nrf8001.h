@@ -16,6 +16,9 @@ void fd_nrf8001_set_data_credits(uint32_t credits);
 void fd_nrf8001_add_data_credits(uint32_t credits);
 void fd_nrf8001_use_data_credits(uint32_t credits);
 
+// the command staging buffer is free (the previous command has been moved out to its spi transfer)
+bool fd_nrf8001_can_send(void);
+
 void fd_nrf8001_send(uint8_t *message, uint32_t length);
 
 void fd_nrf8001_send_with_data(uint8_t *message, uint32_t length, uint8_t *data, uint32_t data_length);
@@ -24,6 +27,16 @@ void fd_nrf8001_error(void);
 uint32_t fd_nrf8001_get_system_credits(void);
 uint32_t fd_nrf8001_get_data_credits(void);
 
+typedef struct {
+    uint32_t used; // data credits used (packets sent)
+    uint32_t returned; // data credits returned by the nRF8001
+    uint32_t events; // data credit events (at most one per connection event)
+    uint32_t max_returned; // most data credits returned by one event
+    uint32_t exhausted; // number of times all the data credits were in use
+} fd_nrf8001_data_credit_statistics_t;
+
+void fd_nrf8001_get_data_credit_statistics(fd_nrf8001_data_credit_statistics_t *statistics);
+
 
 void fd_nrf8001_spi_tx_clear(void);
 
@@ -0,0 +1,61 @@
+#ifndef FD_NRF8001_SIM_H
+#define FD_NRF8001_SIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Simulated nRF8001 (and the central it is connected to) for testing fd_bluetooth without a radio.  It
+// replaces fd_hal_nrf8001.c and fd_spi.c:  ACI commands sent with fd_spi_io are handled by the simulated
+// nRF8001, and ACI events are returned in the same SPI transfers (with FD_EVENT_NRF_RDYN set when RDYN goes
+// low).  Radio time only passes when fd_nrf8001_sim_connection_event is called.
+
+#define FD_NRF8001_SIM_PACKETS_PER_EVENT_LIMIT 8
+
+typedef struct {
+    uint32_t commands;
+    uint32_t events;
+    uint32_t setup_messages;
+    uint32_t connection_events;
+    uint32_t packets_sent; // device to central
+    uint32_t packets_received; // central to device
+    uint32_t waits; // fd_spi_wait calls (blocking on the nRF8001)
+    // number of connection events that sent each number of packets
+    uint32_t packets_per_event[FD_NRF8001_SIM_PACKETS_PER_EVENT_LIMIT + 1];
+} fd_nrf8001_sim_statistics_t;
+
+typedef enum {
+    fd_nrf8001_sim_state_reset,
+    fd_nrf8001_sim_state_setup,
+    fd_nrf8001_sim_state_standby,
+    fd_nrf8001_sim_state_advertising,
+    fd_nrf8001_sim_state_connected,
+    fd_nrf8001_sim_state_sleep,
+    fd_nrf8001_sim_state_test
+} fd_nrf8001_sim_state_t;
+
+void fd_nrf8001_sim_initialize(void);
+
+// most packets the central takes from the nRF8001 in one connection event
+void fd_nrf8001_sim_set_packets_per_event(uint32_t packets);
+// shortest connection interval the central will accept (1.25ms units)
+void fd_nrf8001_sim_set_minimum_interval(uint16_t interval);
+
+fd_nrf8001_sim_state_t fd_nrf8001_sim_get_state(void);
+// current connection interval (1.25ms units)
+uint16_t fd_nrf8001_sim_get_interval(void);
+void fd_nrf8001_sim_get_statistics(fd_nrf8001_sim_statistics_t *statistics);
+
+// call any fd_spi_io completion callback (as the SPI interrupt would)
+void fd_nrf8001_sim_complete(void);
+
+// central actions
+bool fd_nrf8001_sim_connect(uint16_t interval);
+void fd_nrf8001_sim_disconnect(void);
+// write (with response) to the detour rx pipe, written in a later connection event
+bool fd_nrf8001_sim_write(uint8_t *data, uint32_t length);
+// take the next notification the central has received on the detour tx pipe
+bool fd_nrf8001_sim_read(uint8_t *data, uint32_t *length);
+
+void fd_nrf8001_sim_connection_event(void);
+
+#endif
\ No newline at end of file
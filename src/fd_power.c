@@ -56,6 +56,8 @@ static uint32_t fd_power_state;
 static uint32_t fd_power_state_start;
 
 #define UPDATE_INTERVAL 60
+// the update can be delayed a few seconds to share a wakeup with other timers
+#define UPDATE_SLACK 5
 
 #define FD_POWER_HIGH_DURATION (2 * 60)
 #define FD_POWER_LOW_DURATION (5 * 60)
@@ -307,6 +309,8 @@ void fd_power_initialize(void) {
     fd_event_add_callback(FD_EVENT_USB_POWER, fd_power_usb_power_callback);
 
     fd_timer_add(&fd_power_update_timer, fd_power_update_callback);
+    fd_time_t slack = {.seconds = UPDATE_SLACK, .microseconds = 0};
+    fd_timer_set_slack(&fd_power_update_timer, slack);
     fd_timer_start_next(&fd_power_update_timer, UPDATE_INTERVAL);
 }
 
@@ -11,9 +11,9 @@
 // recognize acceleration over 2g
 #define FD_RECOGNITION_THRESHOLD 2.0f
 // record raw activity for 2 seconds after event detection
-#define FD_RECOGNITION_AFTER_COUNT 50
+#define FD_RECOGNITION_AFTER_DURATION 2
 // ignore raw activity for 2 seconds after event detection
-#define FD_RECOGNITION_AFTER_SKIP 50
+#define FD_RECOGNITION_AFTER_SKIP_DURATION 2
 
 static bool fd_recognition_enable;
 static uint32_t fd_recognition_skip_count;
@@ -34,8 +34,9 @@ void fd_recognition_set_enable(bool enable) {
 void fd_recognition_match(void) {
     fd_sensing_history_save();
 
-    if (fd_sensing_get_stream_sample_count() < FD_RECOGNITION_AFTER_COUNT) {
-        fd_sensing_set_stream_sample_count(FD_RECOGNITION_AFTER_COUNT);
+    uint32_t count = FD_RECOGNITION_AFTER_DURATION * fd_sensing_get_active_sample_rate();
+    if (fd_sensing_get_stream_sample_count() < count) {
+        fd_sensing_set_stream_sample_count(count);
     }
 }
 
@@ -58,6 +59,6 @@ void fd_recognition_sensing(int16_t x, int16_t y, int16_t z) {
 
     if (match) {
         fd_recognition_match();
-        fd_recognition_skip_count = FD_RECOGNITION_AFTER_SKIP;
+        fd_recognition_skip_count = FD_RECOGNITION_AFTER_SKIP_DURATION * fd_sensing_get_active_sample_rate();
     }
 }
\ No newline at end of file
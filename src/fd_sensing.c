@@ -4,36 +4,66 @@
 #include "fd_hal_rtc.h"
 #include "fd_recognition.h"
 #include "fd_sensing.h"
+#include "fd_step.h"
 #include "fd_storage.h"
 #include "fd_storage_buffer.h"
 #include "fd_timer.h"
 
 #include <string.h>
 
-// 25 Hz sample rate
-#define FD_SENSING_INTERVAL_US 40000
-#define FD_SENSING_INTERVAL_MS 40
+// 25 Hz default sample rate (stream pages store the sample interval in whole milliseconds)
+#define FD_SENSING_SAMPLE_RATE 25
+// the fastest rate with a whole millisecond interval (the accelerometer 400 Hz rate would be stored as 2 ms)
+#define FD_SENSING_MAX_SAMPLE_RATE 200
 
-// ~4 seconds / 118 samples / 2 pages of 32-bit xyz values (3-axis of 10-bits each), each page with 10 byte header containing the time and interval
-#define FD_SENSING_HISTORY_LENGTH ((int)(1 * ((FD_STORAGE_MAX_DATA_LENGTH - 10) / sizeof(uint32_t))))
-static uint32_t fd_sensing_history[FD_SENSING_HISTORY_LENGTH];
-static int fd_sensing_history_tail;
-static int fd_sensing_history_count;
+// Adaptive sampling: when the activity stays below the threshold for the quiet duration the
+// sample rate is stepped down (to 10 Hz and then to 1 Hz).  Any activity above the threshold
+// restores the configured sample rate.
+#define FD_SENSING_ADAPTIVE_THRESHOLD 0.1f
+#define FD_SENSING_ADAPTIVE_QUIET_DURATION 60
+#define FD_SENSING_ADAPTIVE_MEDIUM_RATE 10
+#define FD_SENSING_ADAPTIVE_LOW_RATE 1
+
+// the interval timer can be delayed to share a wakeup with other timers (must be less than the interval)
+#define FD_SENSING_TIMER_SLACK_MS 1000
+
+// step counts are stored once per minute
+#define FD_SENSING_STEP_INTERVAL 60
+
+// samples of 32-bit xyz values (3-axis of 10-bits each) that fit in one stream page with its 10 byte header containing the time and interval
+#define FD_SENSING_HISTORY_PAGE_LENGTH ((FD_STORAGE_MAX_DATA_LENGTH - 10) / sizeof(uint32_t))
+
+// pre-trigger ring capacity in stream pages (~4.7 seconds / 118 samples at 25 Hz by default)
+#ifndef FD_SENSING_HISTORY_PAGES
+#define FD_SENSING_HISTORY_PAGES 2
+#endif
+#define FD_SENSING_HISTORY_CAPACITY (FD_SENSING_HISTORY_PAGES * FD_SENSING_HISTORY_PAGE_LENGTH)
+
+static uint32_t fd_sensing_history[FD_SENSING_HISTORY_CAPACITY];
+static uint32_t fd_sensing_history_length;
+static uint32_t fd_sensing_history_tail;
+static uint32_t fd_sensing_history_count;
 
 static fd_storage_area_t fd_sensing_storage_area;
 static fd_storage_buffer_t fd_sensing_storage_buffer;
 static fd_storage_buffer_t fd_sensing_stream_storage_buffer;
+static fd_storage_buffer_t fd_sensing_step_storage_buffer;
 static uint32_t fd_sensing_interval;
 static fd_timer_t fd_sensing_timer;
 static fd_time_t fd_sensing_time;
 static uint32_t fd_sensing_samples;
 static uint32_t fd_sensing_stream_remaining_sample_count;
 static fd_time_t fd_sensing_stream_time;
+static uint32_t fd_sensing_sample_rate;
+static bool fd_sensing_adaptive;
+static uint32_t fd_sensing_active_sample_rate;
+static uint32_t fd_sensing_interval_us;
+static uint32_t fd_sensing_quiet_duration;
 
 static
 fd_time_t fd_sensing_get_sample_time(void) {
     fd_time_t time = fd_hal_rtc_get_time();
-    time.microseconds = (time.microseconds / FD_SENSING_INTERVAL_US) * FD_SENSING_INTERVAL_US;
+    time.microseconds = (time.microseconds / fd_sensing_interval_us) * fd_sensing_interval_us;
     return time;
 }
 
@@ -47,30 +77,51 @@ void fd_sensing_history_initialize(void) {
 static
 void fd_sensing_history_add(uint32_t xyz) {
     fd_sensing_history[fd_sensing_history_tail] = xyz;
-    if (++fd_sensing_history_tail >= FD_SENSING_HISTORY_LENGTH) {
+    if (++fd_sensing_history_tail >= fd_sensing_history_length) {
         fd_sensing_history_tail = 0;
     }
-    if (fd_sensing_history_count < FD_SENSING_HISTORY_LENGTH) {
+    if (fd_sensing_history_count < fd_sensing_history_length) {
         ++fd_sensing_history_count;
     }
 }
 
+void fd_sensing_set_history_length(uint32_t length) {
+    if (length > FD_SENSING_HISTORY_CAPACITY) {
+        length = FD_SENSING_HISTORY_CAPACITY;
+    }
+    if (length == 0) {
+        length = 1;
+    }
+    fd_sensing_history_length = length;
+    fd_sensing_history_initialize();
+}
+
+uint32_t fd_sensing_get_history_length(void) {
+    return fd_sensing_history_length;
+}
+
 void fd_sensing_history_save(void) {
     fd_time_t interval;
     interval.seconds = 0;
-    interval.microseconds = FD_SENSING_INTERVAL_US;
-    int index = fd_sensing_history_tail - fd_sensing_history_count;
-    if (index < 0) {
-        index += FD_SENSING_HISTORY_LENGTH;
-    }
+    interval.microseconds = fd_sensing_interval_us;
+    uint16_t interval_ms = fd_sensing_interval_us / 1000;
     fd_time_t time = fd_time_subtract(fd_sensing_get_sample_time(), fd_time_multiply(interval, fd_sensing_history_count));
-    for (int i = 0; i < fd_sensing_history_count; ++i) {
-        uint32_t xyz = fd_sensing_history[index];
-        if (++index >= FD_SENSING_HISTORY_LENGTH) {
-            index = 0;
+
+    // the ring holds at most two contiguous runs: from the oldest sample to the end of the ring, then from the start
+    uint32_t index = fd_sensing_history_length - fd_sensing_history_count + fd_sensing_history_tail;
+    if (index >= fd_sensing_history_length) {
+        index -= fd_sensing_history_length;
+    }
+    uint32_t remaining = fd_sensing_history_count;
+    while (remaining > 0) {
+        uint32_t count = fd_sensing_history_length - index;
+        if (count > remaining) {
+            count = remaining;
         }
-        fd_storage_buffer_add_time_series_ms_uint32(&fd_sensing_stream_storage_buffer, time, FD_SENSING_INTERVAL_MS, xyz);
-        time = fd_time_add(time, interval);
+        fd_storage_buffer_add_time_series_ms_uint32s(&fd_sensing_stream_storage_buffer, time, interval_ms, &fd_sensing_history[index], count);
+        time = fd_time_add(time, fd_time_multiply(interval, count));
+        remaining -= count;
+        index = 0;
     }
 
     fd_sensing_history_tail = 0;
@@ -88,9 +139,9 @@ void fd_sensing_stream(int16_t x, int16_t y, int16_t z) {
     if (fd_sensing_stream_remaining_sample_count > 0) {
         fd_time_t interval;
         interval.seconds = 0;
-        interval.microseconds = FD_SENSING_INTERVAL_US;
+        interval.microseconds = fd_sensing_interval_us;
         fd_sensing_stream_time = fd_time_add(fd_sensing_stream_time, interval);
-        fd_storage_buffer_add_time_series_ms_uint32(&fd_sensing_stream_storage_buffer, fd_sensing_stream_time, FD_SENSING_INTERVAL_MS, xyz);
+        fd_storage_buffer_add_time_series_ms_uint32(&fd_sensing_stream_storage_buffer, fd_sensing_stream_time, fd_sensing_interval_us / 1000, xyz);
         --fd_sensing_stream_remaining_sample_count;
     } else {
         fd_sensing_history_add(xyz);
@@ -100,6 +151,7 @@ void fd_sensing_stream(int16_t x, int16_t y, int16_t z) {
 static
 void fd_sensing_sample_callback(int16_t x, int16_t y, int16_t z) {
     fd_activity_accumulate(x, y, z);
+    fd_step_accumulate(x, y, z);
     ++fd_sensing_samples;
 
     fd_sensing_stream(x, y, z);
@@ -107,12 +159,63 @@ void fd_sensing_sample_callback(int16_t x, int16_t y, int16_t z) {
     fd_recognition_sensing(x, y, z);
 }
 
+static
+void fd_sensing_set_active_sample_rate(uint32_t rate) {
+    if (rate == fd_sensing_active_sample_rate) {
+        return;
+    }
+
+    // delivers any samples taken at the old rate before switching
+    fd_hal_accelerometer_set_sample_rate(rate);
+
+    // the stream page header and history only support a single sample interval
+    fd_storage_buffer_flush(&fd_sensing_stream_storage_buffer);
+    fd_sensing_history_initialize();
+
+    fd_sensing_active_sample_rate = fd_hal_accelerometer_get_sample_rate();
+    fd_sensing_interval_us = 1000000 / fd_sensing_active_sample_rate;
+    fd_step_set_sample_rate(fd_sensing_active_sample_rate);
+}
+
+static
+void fd_sensing_adapt(float activity) {
+    if (!fd_sensing_adaptive || (fd_sensing_stream_remaining_sample_count > 0) || (activity > FD_SENSING_ADAPTIVE_THRESHOLD)) {
+        fd_sensing_quiet_duration = 0;
+        fd_sensing_set_active_sample_rate(fd_sensing_sample_rate);
+        return;
+    }
+
+    fd_sensing_quiet_duration += fd_sensing_interval;
+    if (fd_sensing_quiet_duration < FD_SENSING_ADAPTIVE_QUIET_DURATION) {
+        return;
+    }
+    fd_sensing_quiet_duration = 0;
+    if (fd_sensing_active_sample_rate > FD_SENSING_ADAPTIVE_MEDIUM_RATE) {
+        fd_sensing_set_active_sample_rate(FD_SENSING_ADAPTIVE_MEDIUM_RATE);
+    } else {
+        fd_sensing_set_active_sample_rate(FD_SENSING_ADAPTIVE_LOW_RATE);
+    }
+}
+
+static
+void fd_sensing_step_save(uint32_t time) {
+    uint8_t data[2];
+    fd_binary_pack_uint16(data, fd_step_value());
+    fd_storage_buffer_add_time_series_s(&fd_sensing_step_storage_buffer, time, FD_SENSING_STEP_INTERVAL, data, sizeof(data));
+    fd_step_start();
+}
+
 static
 void fd_sensing_timer_callback(void) {
     fd_hal_accelerometer_read_fifo();
     if (fd_sensing_samples > 0) {
         float activity = fd_activity_value(fd_sensing_interval);
         fd_storage_buffer_add_time_series_s_float16(&fd_sensing_storage_buffer, fd_sensing_time.seconds, fd_sensing_interval, activity);
+        fd_sensing_adapt(activity);
+    }
+    uint32_t end = fd_sensing_time.seconds + fd_sensing_interval;
+    if ((end % FD_SENSING_STEP_INTERVAL) == 0) {
+        fd_sensing_step_save(end - FD_SENSING_STEP_INTERVAL);
     }
 
     fd_sensing_wake();
@@ -135,6 +238,7 @@ void fd_sensing_synthesize(fd_detour_source_collection_t *detour_source_collecti
 }
 
 void fd_sensing_initialize(void) {
+    fd_sensing_history_length = FD_SENSING_HISTORY_CAPACITY;
     fd_sensing_history_initialize();
 
     // sensing storage will use sectors 64-511 (sectors 0-63 are for firmware updates)
@@ -146,10 +250,23 @@ void fd_sensing_initialize(void) {
     fd_storage_buffer_collection_push(&fd_sensing_stream_storage_buffer);
     fd_sensing_stream_remaining_sample_count = 0;
 
+    fd_storage_buffer_initialize(&fd_sensing_step_storage_buffer, &fd_sensing_storage_area, FD_STORAGE_TYPE('F', 'D', 'S', 'T'));
+    fd_storage_buffer_collection_push(&fd_sensing_step_storage_buffer);
+
     fd_hal_accelerometer_set_sample_callback(fd_sensing_sample_callback);
 
+    fd_sensing_sample_rate = FD_SENSING_SAMPLE_RATE;
+    fd_sensing_adaptive = false;
+    fd_sensing_active_sample_rate = 0;
+    fd_sensing_quiet_duration = 0;
+    fd_sensing_set_active_sample_rate(fd_sensing_sample_rate);
+
     fd_sensing_interval = 10;
     fd_timer_add(&fd_sensing_timer, fd_sensing_timer_callback);
+    fd_time_t slack;
+    slack.seconds = FD_SENSING_TIMER_SLACK_MS / 1000;
+    slack.microseconds = (FD_SENSING_TIMER_SLACK_MS % 1000) * 1000;
+    fd_timer_set_slack(&fd_sensing_timer, slack);
 }
 
 void fd_sensing_set_stream_sample_count(uint32_t count) {
@@ -161,6 +278,29 @@ uint32_t fd_sensing_get_stream_sample_count(void) {
     return fd_sensing_stream_remaining_sample_count;
 }
 
+void fd_sensing_set_sample_rate(uint32_t rate, bool adaptive) {
+    if (rate > FD_SENSING_MAX_SAMPLE_RATE) {
+        rate = FD_SENSING_MAX_SAMPLE_RATE;
+    }
+    fd_sensing_adaptive = adaptive;
+    fd_sensing_quiet_duration = 0;
+    fd_sensing_set_active_sample_rate(rate);
+    // the accelerometer may not support the exact rate requested
+    fd_sensing_sample_rate = fd_sensing_active_sample_rate;
+}
+
+uint32_t fd_sensing_get_sample_rate(void) {
+    return fd_sensing_sample_rate;
+}
+
+bool fd_sensing_get_adaptive(void) {
+    return fd_sensing_adaptive;
+}
+
+uint32_t fd_sensing_get_active_sample_rate(void) {
+    return fd_sensing_active_sample_rate;
+}
+
 void fd_sensing_wake(void) {
     fd_sensing_samples = 0;
     fd_activity_start();
@@ -182,5 +322,6 @@ void fd_sensing_sleep(void) {
 void fd_sensing_erase(void) {
     fd_storage_buffer_erase(&fd_sensing_storage_buffer);
     fd_storage_buffer_erase(&fd_sensing_stream_storage_buffer);
+    fd_storage_buffer_erase(&fd_sensing_step_storage_buffer);
     fd_storage_area_free_all_pages(&fd_sensing_storage_area);
 }
\ No newline at end of file
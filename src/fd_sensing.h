@@ -3,16 +3,27 @@
 
 #include "fd_detour.h"
 
+#include <stdbool.h>
+#include <stdint.h>
+
 void fd_sensing_initialize(void);
 
 void fd_sensing_wake(void);
 void fd_sensing_sleep(void);
 
+void fd_sensing_set_history_length(uint32_t length);
+uint32_t fd_sensing_get_history_length(void);
 void fd_sensing_history_save(void);
 
 void fd_sensing_set_stream_sample_count(uint32_t count);
 uint32_t fd_sensing_get_stream_sample_count(void);
 
+// rates above 200 Hz are set to 200 Hz (the stream page interval is in whole milliseconds)
+void fd_sensing_set_sample_rate(uint32_t rate, bool adaptive);
+uint32_t fd_sensing_get_sample_rate(void);
+bool fd_sensing_get_adaptive(void);
+uint32_t fd_sensing_get_active_sample_rate(void);
+
 void fd_sensing_erase(void);
 
 void fd_sensing_synthesize(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length);
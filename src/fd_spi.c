@@ -2,6 +2,7 @@
 #include "fd_spi.h"
 
 #include <em_cmu.h>
+#include <em_emu.h>
 #include <em_gpio.h>
 #include <em_usart.h>
 
@@ -16,8 +17,14 @@ typedef struct {
 
     GPIO_Port_TypeDef csn_port;
     unsigned int csn_pin;
+
+    // set for a slave that asks for a transfer by pulling its own chip select low (nRF8001 REQN)
+    fd_spi_request_callback_t request_callback;
 } fd_spi_slave_t;
 
+// at most one io per slave is waiting for the bus
+#define FD_SPI_QUEUE_SIZE 2
+
 typedef struct fd_spi_t {
     USART_TypeDef *usart;
     CMU_Clock_TypeDef clock;
@@ -39,7 +46,13 @@ typedef struct fd_spi_t {
     fd_spi_slave_t *slave;
     fd_spi_io_t *io;
     //
-    bool in_progress;
+    volatile bool in_progress;
+    // io with a completion callback runs from the usart interrupts, otherwise fd_spi_wait polls
+    bool interrupt_driven;
+    // ios waiting for the bus, started in order as it becomes free
+    fd_spi_device_t queue_devices[FD_SPI_QUEUE_SIZE];
+    fd_spi_io_t *queue_ios[FD_SPI_QUEUE_SIZE];
+    uint32_t queue_count;
     bool variable_length;
     uint32_t transfer_index;
     uint32_t transfer_length;
@@ -84,12 +97,15 @@ void fd_spi_initialize(void) {
     spi0_slaves[0].init_sync = init_sync;
     spi0_slaves[0].csn_port = gpioPortA;
     spi0_slaves[0].csn_pin = 2;
+    spi0_slaves[0].request_callback = 0;
 
     spi0->slaves = spi0_slaves;
     spi0->slaves_count = sizeof(spi0_slaves) / sizeof(fd_spi_slave_t);
 
     spi0->slave = &spi0_slaves[0];
     spi0->in_progress = false;
+    spi0->interrupt_driven = false;
+    spi0->queue_count = 0;
 
     // SPI 1
     fd_spi_t *spi1 = &spis[1];
@@ -115,6 +131,7 @@ void fd_spi_initialize(void) {
     spi1_slaves[0].init_sync = init_sync;
     spi1_slaves[0].csn_port = gpioPortD;
     spi1_slaves[0].csn_pin = 8;
+    spi1_slaves[0].request_callback = 0;
 
     // NRF8001
     init_sync = init_sync_default;
@@ -124,12 +141,15 @@ void fd_spi_initialize(void) {
     spi1_slaves[1].init_sync = init_sync;
     spi1_slaves[1].csn_port = gpioPortD;
     spi1_slaves[1].csn_pin = 3;
+    spi1_slaves[1].request_callback = 0;
 
     spi1->slaves = spi1_slaves;
     spi1->slaves_count = sizeof(spi1_slaves) / sizeof(fd_spi_slave_t);
 
     spi1->slave = &spi1_slaves[0];
     spi1->in_progress = false;
+    spi1->interrupt_driven = false;
+    spi1->queue_count = 0;
 }
 
 bool fd_spi_is_on(fd_spi_bus_t bus) {
@@ -193,6 +213,9 @@ void fd_spi_wake(fd_spi_bus_t bus) {
 static
 void start_async_transfer(fd_spi_t *spi);
 
+static
+void fd_spi_start_next(fd_spi_t *spi);
+
 static
 void spi_rx_irq_handler(fd_spi_t *spi) {
     USART_TypeDef *usart = spi->usart;
@@ -215,6 +238,7 @@ void spi_rx_irq_handler(fd_spi_t *spi) {
                 }
                 if (rx_length > spi->transfer_length) {
                     spi->transfer_length = rx_length;
+                    usart->IEN |= USART_IEN_TXBL;
                 }
             }
         } else {
@@ -240,6 +264,8 @@ void spi_rx_irq_handler(fd_spi_t *spi) {
                 if (io->completion_callback != 0) {
                     (*io->completion_callback)();
                 }
+
+                fd_spi_start_next(spi);
             }
         }
     }
@@ -256,6 +282,9 @@ void spi_tx_irq_handler(fd_spi_t *spi) {
                 usart->TXDATA = 0;
             }
             ++spi->tx_index;
+        } else {
+            // nothing more to send until a variable length transfer is extended
+            usart->IEN &= ~USART_IEN_TXBL;
         }
     }
 }
@@ -321,13 +350,33 @@ void fd_spi_set_device(fd_spi_device_t device) {
     }
 }
 
-void fd_spi_io(fd_spi_device_t device, fd_spi_io_t *io) {
-    fd_spi_set_device(device);
-
+void fd_spi_set_request_callback(fd_spi_device_t device, fd_spi_request_callback_t request_callback) {
     uint32_t bus = device >> 16;
     fd_spi_t *spi = &spis[bus];
+    spi->slaves[device & 0xffff].request_callback = request_callback;
+}
+
+// A slave with a request callback that has pulled its chip select low while the bus is free has asked for a
+// transfer.  Anything clocked on the bus now would go to it, so the bus is kept for its io.
+static
+fd_spi_slave_t *fd_spi_requesting_slave(fd_spi_t *spi) {
+    for (uint32_t i = 0; i < spi->slaves_count; ++i) {
+        fd_spi_slave_t *slave = &spi->slaves[i];
+        if (slave->request_callback && !GPIO_PinOutGet(slave->csn_port, slave->csn_pin)) {
+            return slave;
+        }
+    }
+    return 0;
+}
+
+// must be called with interrupts disabled
+static
+void fd_spi_start(fd_spi_t *spi, fd_spi_device_t device, fd_spi_io_t *io) {
+    fd_spi_set_device(device);
+
     spi->io = io;
     spi->in_progress = true;
+    spi->interrupt_driven = io->completion_callback != 0;
     spi->variable_length = io->options & FD_SPI_OPTION_VARLEN ? true : false;
     spi->transfer_index = 0;
 
@@ -336,14 +385,99 @@ void fd_spi_io(fd_spi_device_t device, fd_spi_io_t *io) {
     }
 
     start_async_transfer(spi);
+
+    if (spi->interrupt_driven) {
+        NVIC_EnableIRQ(spi->rx_irqn);
+        NVIC_EnableIRQ(spi->tx_irqn);
+    }
 }
 
-void fd_spi_wait(fd_spi_bus_t bus) {
+// start the next queued io (the one for the requesting slave first) once the bus is free
+static
+void fd_spi_start_next(fd_spi_t *spi) {
+    fd_hal_processor_interrupts_disable();
+    if (!spi->in_progress) {
+        fd_spi_slave_t *requesting = fd_spi_requesting_slave(spi);
+        for (uint32_t i = 0; i < spi->queue_count; ++i) {
+            fd_spi_device_t device = spi->queue_devices[i];
+            if ((requesting != 0) && (&spi->slaves[device & 0xffff] != requesting)) {
+                continue;
+            }
+            fd_spi_io_t *io = spi->queue_ios[i];
+            --spi->queue_count;
+            for (uint32_t j = i; j < spi->queue_count; ++j) {
+                spi->queue_devices[j] = spi->queue_devices[j + 1];
+                spi->queue_ios[j] = spi->queue_ios[j + 1];
+            }
+            fd_spi_start(spi, device, io);
+            break;
+        }
+    }
+    fd_hal_processor_interrupts_enable();
+}
+
+static
+bool fd_spi_is_pending(fd_spi_t *spi, fd_spi_io_t *io) {
+    if (spi->in_progress && ((io == 0) || (spi->io == io))) {
+        return true;
+    }
+    for (uint32_t i = 0; i < spi->queue_count; ++i) {
+        if ((io == 0) || (spi->queue_ios[i] == io)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// wait for the io (or all ios on the bus when 0) to complete
+static
+void fd_spi_wait_for(fd_spi_t *spi, fd_spi_io_t *io) {
+    while (true) {
+        fd_hal_processor_interrupts_disable();
+        if (!fd_spi_is_pending(spi, io)) {
+            fd_hal_processor_interrupts_enable();
+            break;
+        }
+        if (spi->in_progress) {
+            if (spi->interrupt_driven) {
+                // the usart keeps running in em1, and a pending interrupt ends the wait even while they are disabled
+                EMU_EnterEM1();
+                fd_hal_processor_interrupts_enable();
+            } else {
+                fd_hal_processor_interrupts_enable();
+                spi_rx_irq_handler(spi);
+                spi_tx_irq_handler(spi);
+            }
+            continue;
+        }
+        fd_spi_slave_t *requesting = fd_spi_requesting_slave(spi);
+        if (requesting == 0) {
+            fd_spi_start_next(spi);
+        } else
+        if (!(*requesting->request_callback)()) {
+            // the slave is not ready for its transfer yet (the nRF8001 interrupts when RDYN goes low)
+            EMU_EnterEM1();
+        }
+        fd_hal_processor_interrupts_enable();
+    }
+}
+
+void fd_spi_io(fd_spi_device_t device, fd_spi_io_t *io) {
+    uint32_t bus = device >> 16;
     fd_spi_t *spi = &spis[bus];
-    while (spi->in_progress) {
-        spi_rx_irq_handler(spi);
-        spi_tx_irq_handler(spi);
+    if (spi->queue_count >= FD_SPI_QUEUE_SIZE) {
+        fd_spi_wait_for(spi, 0);
     }
+    fd_hal_processor_interrupts_disable();
+    spi->queue_devices[spi->queue_count] = device;
+    spi->queue_ios[spi->queue_count] = io;
+    ++spi->queue_count;
+    fd_spi_start_next(spi);
+    fd_hal_processor_interrupts_enable();
+}
+
+void fd_spi_wait(fd_spi_bus_t bus) {
+    fd_spi_wait_for(&spis[bus], 0);
 }
 
 void fd_spi_chip_select(fd_spi_device_t device, bool select) {
@@ -385,8 +519,7 @@ void fd_spi_sync_txn(fd_spi_device_t device, uint8_t *bytes, uint32_t length) {
         .completion_callback = 0,
     };
     fd_spi_io(device, &io);
-    uint32_t bus = device >> 16;
-    fd_spi_wait(bus);
+    fd_spi_wait_for(&spis[device >> 16], &io);
 }
 
 void fd_spi_sync_txn_rxn(
@@ -421,8 +554,7 @@ void fd_spi_sync_txn_rxn(
         .completion_callback = 0,
     };
     fd_spi_io(device, &io);
-    uint32_t bus = device >> 16;
-    fd_spi_wait(bus);
+    fd_spi_wait_for(&spis[device >> 16], &io);
 }
 
 uint8_t fd_spi_sync_tx1_rx1(fd_spi_device_t device, uint8_t byte) {
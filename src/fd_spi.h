@@ -50,11 +50,18 @@ bool fd_spi_is_on(fd_spi_bus_t bus);
 void fd_spi_sleep(fd_spi_bus_t bus);
 void fd_spi_wake(fd_spi_bus_t bus);
 
-// start an asynchronous transfer
+// start an asynchronous transfer (queued behind any io already on the bus)
 void fd_spi_io(fd_spi_device_t device, fd_spi_io_t *io);
-// wait for an asynchronous transfer to complete
+// wait for all transfers on the bus to complete
 void fd_spi_wait(fd_spi_bus_t bus);
 
+// A slave that asks for a transfer by pulling its own chip select low (the nRF8001 REQN) keeps the bus until its
+// io has run, so ios for other slaves are queued behind it.  While they wait the callback is called to start the
+// slave's io, and returns false if the slave is not ready for it yet.
+typedef bool (*fd_spi_request_callback_t)(void);
+
+void fd_spi_set_request_callback(fd_spi_device_t device, fd_spi_request_callback_t request_callback);
+
 // for use with FD_SPI_OPTION_NO_CSN option
 void fd_spi_set_device(fd_spi_device_t device);
 void fd_spi_chip_select(fd_spi_device_t device, bool select);
@@ -0,0 +1,145 @@
+#include "fd_math.h"
+#include "fd_step.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ Incremental step detector using only integer math (so it is cheap enough to run on every sample).
+
+ The vector magnitude of each sample (in accelerometer counts, 4096 per g) is band-pass filtered:
+ a slow exponential average removes gravity (high-pass ~0.12 Hz) and a 4 sample moving average removes
+ jitter (low-pass ~2.8 Hz).  A step is a peak in the filtered signal:  it must rise above the high
+ threshold and then fall below the low threshold.  Steps closer together than the minimum interval are
+ ignored.  Steps are only counted once a run of regular steps has been seen, so that isolated bumps
+ (sitting down, tapping the device) are not counted as walking.
+
+ Sample rates that are a multiple of 25 Hz are decimated down to 25 Hz.  Step counting is not supported at
+ lower sample rates (they are only used when the device is still).  An interval where no samples could be
+ used is reported as FD_STEP_UNSUPPORTED instead of 0 steps.
+ */
+
+// filter and thresholds assume a 25 Hz sample rate (higher rates are decimated)
+#define FD_STEP_SAMPLE_RATE 25
+#define FD_STEP_DC_SHIFT 5
+#define FD_STEP_SMOOTH_LENGTH 4
+// ~0.1 g
+#define FD_STEP_HIGH_THRESHOLD 410
+// ~-0.05 g
+#define FD_STEP_LOW_THRESHOLD -205
+// 0.24 s (at most ~4 steps per second)
+#define FD_STEP_MIN_INTERVAL 6
+// 2 s
+#define FD_STEP_MAX_INTERVAL 50
+// number of regular steps before counting starts
+#define FD_STEP_RUN_MINIMUM 4
+
+static uint32_t fd_step_decimation;
+static uint32_t fd_step_decimation_count;
+static bool fd_step_primed;
+static int32_t fd_step_dc;
+static int32_t fd_step_smooth[FD_STEP_SMOOTH_LENGTH];
+static int32_t fd_step_smooth_sum;
+static uint32_t fd_step_smooth_index;
+static bool fd_step_above;
+static uint32_t fd_step_since;
+static uint32_t fd_step_run;
+static uint32_t fd_step_count;
+static bool fd_step_supported;
+
+void fd_step_initialize(void) {
+    fd_step_decimation = 1;
+    fd_step_decimation_count = 0;
+    fd_step_primed = false;
+    fd_step_dc = 0;
+    for (int i = 0; i < FD_STEP_SMOOTH_LENGTH; ++i) {
+        fd_step_smooth[i] = 0;
+    }
+    fd_step_smooth_sum = 0;
+    fd_step_smooth_index = 0;
+    fd_step_above = false;
+    fd_step_since = FD_STEP_MAX_INTERVAL + 1;
+    fd_step_run = 0;
+    fd_step_count = 0;
+    fd_step_supported = false;
+}
+
+void fd_step_set_sample_rate(uint32_t rate) {
+    fd_step_decimation = rate / FD_STEP_SAMPLE_RATE;
+    fd_step_decimation_count = 0;
+}
+
+void fd_step_start(void) {
+    fd_step_count = 0;
+    fd_step_supported = false;
+}
+
+static
+void fd_step_detected(void) {
+    fd_step_since = 0;
+    if (fd_step_run < FD_STEP_RUN_MINIMUM) {
+        if (++fd_step_run == FD_STEP_RUN_MINIMUM) {
+            fd_step_count += FD_STEP_RUN_MINIMUM;
+        }
+    } else {
+        ++fd_step_count;
+    }
+}
+
+void fd_step_accumulate(int16_t x, int16_t y, int16_t z) {
+    if (fd_step_decimation == 0) {
+        return;
+    }
+    if (++fd_step_decimation_count < fd_step_decimation) {
+        return;
+    }
+    fd_step_decimation_count = 0;
+    fd_step_supported = true;
+
+    uint32_t xx = (int32_t)x * x;
+    uint32_t yy = (int32_t)y * y;
+    uint32_t zz = (int32_t)z * z;
+    int32_t magnitude = (int32_t)(fd_math_isqrt(xx + yy + zz) >> 16);
+
+    // high-pass: remove gravity
+    if (!fd_step_primed) {
+        fd_step_dc = magnitude << FD_STEP_DC_SHIFT;
+        fd_step_primed = true;
+    }
+    fd_step_dc += magnitude - (fd_step_dc >> FD_STEP_DC_SHIFT);
+    int32_t high = magnitude - (fd_step_dc >> FD_STEP_DC_SHIFT);
+
+    // low-pass: moving average
+    fd_step_smooth_sum += high - fd_step_smooth[fd_step_smooth_index];
+    fd_step_smooth[fd_step_smooth_index] = high;
+    if (++fd_step_smooth_index >= FD_STEP_SMOOTH_LENGTH) {
+        fd_step_smooth_index = 0;
+    }
+    int32_t value = fd_step_smooth_sum / FD_STEP_SMOOTH_LENGTH;
+
+    if (fd_step_since <= FD_STEP_MAX_INTERVAL) {
+        ++fd_step_since;
+    } else {
+        // too long since the last step - any partial run is discarded
+        fd_step_run = 0;
+    }
+
+    if (!fd_step_above) {
+        if (value > FD_STEP_HIGH_THRESHOLD) {
+            fd_step_above = true;
+        }
+    } else
+    if (value < FD_STEP_LOW_THRESHOLD) {
+        fd_step_above = false;
+        if (fd_step_since >= FD_STEP_MIN_INTERVAL) {
+            fd_step_detected();
+        }
+    }
+}
+
+uint32_t fd_step_value(void) {
+    if (!fd_step_supported) {
+        return FD_STEP_UNSUPPORTED;
+    }
+    return fd_step_count;
+}
\ No newline at end of file
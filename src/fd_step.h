@@ -0,0 +1,17 @@
+#ifndef FD_STEP_H
+#define FD_STEP_H
+
+#include <stdint.h>
+
+// step value when no samples since fd_step_start could be used (the sample rate was below 25 Hz)
+#define FD_STEP_UNSUPPORTED 0xffff
+
+void fd_step_initialize(void);
+
+void fd_step_set_sample_rate(uint32_t rate);
+
+void fd_step_start(void);
+void fd_step_accumulate(int16_t x, int16_t y, int16_t z);
+uint32_t fd_step_value(void);
+
+#endif
\ No newline at end of file
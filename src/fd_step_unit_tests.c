@@ -0,0 +1,55 @@
+#include "fd_log.h"
+#include "fd_step.h"
+
+// 1 g
+#define G 4096
+
+static
+void walk(uint32_t samples, uint32_t period, int16_t amplitude) {
+    for (uint32_t i = 0; i < samples; ++i) {
+        // triangle wave on top of gravity
+        uint32_t phase = i % period;
+        uint32_t half = period / 2;
+        int32_t ramp = (phase < half) ? phase : (period - phase);
+        int16_t z = G - amplitude + (int16_t)((2 * amplitude * ramp) / half);
+        fd_step_accumulate(0, 0, z);
+    }
+}
+
+void fd_step_unit_tests(void) {
+    fd_step_initialize();
+
+    // standing still - no steps
+    walk(250, 12, 0);
+    fd_log_assert(fd_step_value() == 0);
+
+    // 10 seconds of walking at ~2 steps per second (25 Hz samples) with +/- 0.5 g
+    fd_step_start();
+    walk(250, 12, G / 2);
+    uint32_t steps = fd_step_value();
+    fd_log_assert((steps >= 18) && (steps <= 21));
+
+    // a couple of isolated bumps are not counted as walking
+    fd_step_initialize();
+    walk(250, 125, G / 2);
+    fd_log_assert(fd_step_value() == 0);
+
+    // higher sample rates are decimated down to 25 Hz
+    fd_step_initialize();
+    fd_step_set_sample_rate(50);
+    walk(500, 24, G / 2);
+    steps = fd_step_value();
+    fd_log_assert((steps >= 18) && (steps <= 21));
+
+    // steps are not counted below 25 Hz, and that is reported (not 0 steps)
+    fd_step_start();
+    fd_step_set_sample_rate(10);
+    walk(100, 5, G / 2);
+    fd_log_assert(fd_step_value() == FD_STEP_UNSUPPORTED);
+
+    // back at 25 Hz the next interval is counted again
+    fd_step_set_sample_rate(25);
+    fd_step_start();
+    walk(250, 12, 0);
+    fd_log_assert(fd_step_value() == 0);
+}
\ No newline at end of file
@@ -247,6 +247,15 @@ uint32_t fd_storage_used_page_count(void) {
     return count;
 }
 
+fd_storage_area_t *fd_storage_get_area(uint32_t index) {
+    fd_storage_area_t *area = storage_area_collection.first;
+    while ((area != 0) && (index > 0)) {
+        area = area->next;
+        --index;
+    }
+    return area;
+}
+
 uint32_t fd_storage_read_nth_page(uint32_t offset, fd_storage_metadata_t *metadata, uint8_t *data, uint32_t length) {
     uint32_t n = offset;
     fd_storage_area_t *area = storage_area_collection.first;
@@ -30,6 +30,7 @@ uint32_t fd_storage_used_page_count(void);
 bool fd_storage_read_first_page(fd_storage_metadata_t *metadata, uint8_t *data, uint32_t length);
 uint32_t fd_storage_read_nth_page(uint32_t n, fd_storage_metadata_t *metadata, uint8_t *data, uint32_t length);
 void fd_storage_erase_page(fd_storage_metadata_t *metadata);
+fd_storage_area_t *fd_storage_get_area(uint32_t index);
 
 void fd_storage_area_initialize(fd_storage_area_t *area, uint32_t start_sector, uint32_t end_sector);
 uint32_t fd_storage_area_used_page_count(fd_storage_area_t *area);
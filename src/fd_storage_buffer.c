@@ -179,4 +179,39 @@ void fd_storage_buffer_add_time_series_ms_uint32(
     }
     fd_binary_pack_uint32(&storage_buffer->data[storage_buffer->index], value);
     storage_buffer->index += SIZEOF_UINT32;
+}
+
+// Adds consecutive samples a page at a time.  The time is only calculated when a new page header is needed.
+void fd_storage_buffer_add_time_series_ms_uint32s(
+    fd_storage_buffer_t *storage_buffer, fd_time_t time, uint16_t interval_ms, uint32_t *values, uint32_t count
+) {
+    fd_time_t interval;
+    interval.seconds = interval_ms / 1000;
+    interval.microseconds = (interval_ms % 1000) * 1000;
+    while (count > 0) {
+        if ((storage_buffer->index + SIZEOF_UINT32) > FD_STORAGE_MAX_DATA_LENGTH) {
+            fd_storage_buffer_flush(storage_buffer);
+        }
+        if (storage_buffer->index == 0) {
+            fd_binary_pack_uint32(&storage_buffer->data[storage_buffer->index], time.seconds);
+            storage_buffer->index += SIZEOF_UINT32;
+            fd_binary_pack_uint32(&storage_buffer->data[storage_buffer->index], time.microseconds);
+            storage_buffer->index += SIZEOF_UINT32;
+            fd_binary_pack_uint16(&storage_buffer->data[storage_buffer->index], interval_ms);
+            storage_buffer->index += SIZEOF_UINT16;
+        }
+        uint32_t n = (FD_STORAGE_MAX_DATA_LENGTH - storage_buffer->index) / SIZEOF_UINT32;
+        if (n > count) {
+            n = count;
+        }
+        uint8_t *data = &storage_buffer->data[storage_buffer->index];
+        for (uint32_t i = 0; i < n; ++i) {
+            fd_binary_pack_uint32(data, values[i]);
+            data += SIZEOF_UINT32;
+        }
+        storage_buffer->index += n * SIZEOF_UINT32;
+        values += n;
+        count -= n;
+        time = fd_time_add(time, fd_time_multiply(interval, n));
+    }
 }
\ No newline at end of file
@@ -36,6 +36,10 @@ void fd_storage_buffer_add_time_series_ms_uint32(
     fd_storage_buffer_t *storage_buffer, fd_time_t time, uint16_t interval_ms, uint32_t value
 );
 
+void fd_storage_buffer_add_time_series_ms_uint32s(
+    fd_storage_buffer_t *storage_buffer, fd_time_t time, uint16_t interval_ms, uint32_t *values, uint32_t count
+);
+
 void fd_storage_buffer_collection_initialize(void);
 
 void fd_storage_buffer_collection_flush(void);
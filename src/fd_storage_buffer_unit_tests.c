@@ -1,3 +1,4 @@
+#include "fd_binary.h"
 #include "fd_log.h"
 #include "fd_storage.h"
 #include "fd_storage_buffer.h"
@@ -38,4 +39,28 @@ void fd_storage_buffer_unit_tests(void) {
     fd_storage_buffer_clear_page(&metadata);
     result = fd_storage_buffer_get_first_page(&metadata, bytes, sizeof(bytes));
     fd_log_assert(result == false);
+
+    // samples added a page at a time get a header on each page with the time of its first sample (intervals of a
+    // second or more included)
+    fd_storage_area_free_all_pages(&area);
+    uint32_t values[2 * 59 + 1];
+    for (uint32_t i = 0; i < (sizeof(values) / sizeof(values[0])); ++i) {
+        values[i] = i;
+    }
+    fd_time_t start;
+    start.seconds = 665193600;
+    start.microseconds = 500000;
+    uint16_t interval_ms = 1500;
+    fd_storage_buffer_add_time_series_ms_uint32s(&storage_buffer, start, interval_ms, values, sizeof(values) / sizeof(values[0]));
+    fd_storage_buffer_flush(&storage_buffer);
+    fd_log_assert(fd_storage_area_used_page_count(&area) == 3);
+    uint8_t page[FD_STORAGE_MAX_DATA_LENGTH];
+    for (uint32_t n = 0; n < 3; ++n) {
+        fd_storage_area_read_nth_page(&area, n, &metadata, page, sizeof(page));
+        uint32_t ms = 500 + n * 59 * interval_ms;
+        fd_log_assert(fd_binary_unpack_uint32(&page[0]) == (start.seconds + ms / 1000));
+        fd_log_assert(fd_binary_unpack_uint32(&page[4]) == ((ms % 1000) * 1000));
+        fd_log_assert(fd_binary_unpack_uint16(&page[8]) == interval_ms);
+        fd_log_assert(fd_binary_unpack_uint32(&page[10]) == (n * 59));
+    }
 }
\ No newline at end of file
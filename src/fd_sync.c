@@ -26,7 +26,14 @@ void fd_sync_detour_supplier(uint32_t offset, uint8_t *data, uint32_t length) {
     memcpy(data, &fd_sync_detour_buffer[offset], length);
 }
 
-void fd_sync_start(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length) {
+void fd_sync_put(fd_binary_t *binary, uint8_t *data, uint32_t length) {
+    if ((binary->size - binary->put_index) < (HARDWARE_ID_SIZE + METADATA_SIZE + FD_STORAGE_MAX_DATA_LENGTH)) {
+        fd_log_assert_fail("");
+        binary->flags |= FD_BINARY_FLAG_OUT_OF_BOUNDS;
+        return;
+    }
+    uint8_t *page_data = &binary->buffer[binary->put_index + HARDWARE_ID_SIZE + METADATA_SIZE];
+
     uint32_t flags = 0;
     uint32_t offset = 0;
     if (length >= 4) {
@@ -39,11 +46,11 @@ void fd_sync_start(fd_detour_source_collection_t *detour_source_collection, uint
     }
 
     fd_storage_metadata_t metadata;
-    uint32_t shortage = fd_storage_read_nth_page(offset, &metadata, &fd_sync_detour_buffer[COMMAND_SIZE + HARDWARE_ID_SIZE + METADATA_SIZE], FD_STORAGE_MAX_DATA_LENGTH);
+    uint32_t shortage = fd_storage_read_nth_page(offset, &metadata, page_data, FD_STORAGE_MAX_DATA_LENGTH);
     if (shortage > 0) {
         bool has_page = false;
         if (shortage == 1) {
-            has_page = fd_storage_buffer_get_first_page(&metadata, &fd_sync_detour_buffer[COMMAND_SIZE + HARDWARE_ID_SIZE + METADATA_SIZE], FD_STORAGE_MAX_DATA_LENGTH);
+            has_page = fd_storage_buffer_get_first_page(&metadata, page_data, FD_STORAGE_MAX_DATA_LENGTH);
         }
         if (has_page) {
             --shortage;
@@ -61,19 +68,22 @@ void fd_sync_start(fd_detour_source_collection_t *detour_source_collection, uint
         metadata.length = FD_STORAGE_MAX_DATA_LENGTH;
     }
 
+    fd_hal_processor_get_hardware_id(binary);
+    fd_binary_put_uint32(binary, metadata.page);
+    fd_binary_put_uint16(binary, metadata.length);
+    fd_binary_put_uint16(binary, metadata.hash);
+    fd_binary_put_uint32(binary, metadata.type);
+    binary->put_index += metadata.length;
+    // encrypt
+}
+
+void fd_sync_start(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length) {
     fd_binary_t binary;
-    fd_binary_initialize(&binary, fd_sync_detour_buffer, COMMAND_SIZE + HARDWARE_ID_SIZE + METADATA_SIZE);
+    fd_binary_initialize(&binary, fd_sync_detour_buffer, SYNC_SIZE);
     fd_binary_put_uint8(&binary, FD_CONTROL_SYNC_DATA);
-    fd_hal_processor_get_hardware_id(&binary);
-    fd_binary_put_uint32(&binary, metadata.page);
-    fd_binary_put_uint16(&binary, metadata.length);
-    fd_binary_put_uint16(&binary, metadata.hash);
-    fd_binary_put_uint32(&binary, metadata.type);
-
-    uint32_t sync_length = COMMAND_SIZE + HARDWARE_ID_SIZE + METADATA_SIZE + metadata.length;
-    // encrypt
+    fd_sync_put(&binary, data, length);
 
-    fd_detour_source_set(&fd_sync_detour_source, fd_sync_detour_supplier, sync_length);
+    fd_detour_source_set(&fd_sync_detour_source, fd_sync_detour_supplier, binary.put_index);
     bool result = fd_detour_source_collection_push(detour_source_collection, &fd_sync_detour_source);
     if (!result) {
         fd_log_assert_fail("");
@@ -1,12 +1,16 @@
 #ifndef FD_SYNC_H
 #define FD_SYNC_H
 
+#include "fd_binary.h"
 #include "fd_detour.h"
 
 #include <stdint.h>
 
 void fd_sync_initialize(void);
 
+// put the sync data (after the command code) for the given sync start request
+void fd_sync_put(fd_binary_t *binary, uint8_t *data, uint32_t length);
+
 void fd_sync_start(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length);
 void fd_sync_ack(fd_detour_source_collection_t *detour_source_collection, uint8_t *data, uint32_t length);
 
@@ -25,6 +25,8 @@ fd_storage_metadata_t get_metadata(uint8_t *bytes, uint32_t length) {
 
 void fd_sync_unit_tests(void) {
     fd_storage_initialize();
+    // drop any storage buffers left by other tests (their pages would be synced first)
+    fd_storage_buffer_collection_initialize();
     fd_storage_area_t area;
     fd_storage_area_initialize(&area, 0, 1);
     fd_log_assert(fd_storage_used_page_count() == 0);
@@ -47,6 +47,7 @@ fd_time_t fd_time_multiply(fd_time_t t, unsigned n) {
     uint64_t us = ((uint64_t)t.microseconds) * n;
     uint64_t s = us / 1000000;
     us = us - (s * 1000000);
+    s += ((uint64_t)t.seconds) * n;
     fd_time_t r = {
         .seconds = (uint32_t)s,
         .microseconds = (uint32_t)us
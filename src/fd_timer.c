@@ -1,34 +1,51 @@
+#include "fd_accounting.h"
 #include "fd_event.h"
 #include "fd_hal_processor.h"
 #include "fd_hal_rtc.h"
 #include "fd_log.h"
 #include "fd_timer.h"
+#include "fd_trace.h"
 
-#define TIMERS_LIMIT 16
+#define TIMERS_LIMIT 32
 
+// all timers (for timing)
 static fd_timer_t *timers[TIMERS_LIMIT];
 static uint32_t timer_count;
-static uint32_t scheduled_countdown;
+// active timers as a binary min-heap ordered by deadline
+static fd_timer_t *heap[TIMERS_LIMIT];
+static uint32_t heap_count;
+// the RTC tick that the countdown is currently scheduled to wake at (if scheduled)
+static bool wakeup_scheduled;
+static uint32_t wakeup_deadline;
+static uint32_t wakeup_count;
 
 void fd_timer_update(void);
+void fd_timer_countdown(void);
 
 void fd_timer_initialize(void) {
     timer_count = 0;
-    scheduled_countdown = 0;
+    heap_count = 0;
+    wakeup_scheduled = false;
+    wakeup_deadline = 0;
+    wakeup_count = 0;
 
-    fd_event_add_callback(FD_EVENT_RTC_COUNTDOWN, fd_timer_update);
+    fd_event_add_callback(FD_EVENT_RTC_COUNTDOWN, fd_timer_countdown);
     fd_event_add_callback(FD_EVENT_TIMER_SCHEDULE, fd_timer_update);
 }
 
 void fd_timer_add_with_identifier(fd_timer_t *timer, fd_timer_callback_t callback, const char *identifier __attribute__((unused))) {
     timer->callback = callback;
     timer->active = false;
-    timer->scheduled = false;
     timer->triggered = false;
-    timer->countdown = 0;
+    timer->deadline = 0;
+    timer->slack = 0;
+    timer->index = 0;
 #ifdef FD_TIMER_TIMING
     fd_timing_initialize(&timer->timing, identifier);
 #endif
+#ifdef FD_TRACE
+    timer->trace_identifier = fd_trace_add_identifier(identifier);
+#endif
 
     if (timer_count >= TIMERS_LIMIT) {
         fd_log_assert_fail("timer limit");
@@ -47,57 +64,147 @@ fd_timing_iterator_t fd_timer_timing_iterator(void) {
     return iterator;
 }
 
+// deadlines are compared relative to each other so that RTC tick wrap around is handled
 static
-void fd_timer_schedule_countdown(void) {
-    uint32_t new_countdown = UINT32_MAX;
-    uint32_t remaining_countdown = fd_hal_rtc_get_countdown();
-    uint32_t elapsed_countdown = scheduled_countdown - remaining_countdown;
-    for (uint32_t i = 0; i < timer_count; ++i) {
-        fd_timer_t *timer = timers[i];
-        if (!timer->active) {
-            continue;
+bool fd_timer_is_before(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) < 0;
+}
+
+static
+void fd_timer_heap_place(fd_timer_t *timer, uint32_t index) {
+    heap[index] = timer;
+    timer->index = index;
+}
+
+static
+void fd_timer_heap_up(uint32_t index) {
+    fd_timer_t *timer = heap[index];
+    while (index > 0) {
+        uint32_t parent = (index - 1) / 2;
+        if (!fd_timer_is_before(timer->deadline, heap[parent]->deadline)) {
+            break;
         }
-        if (timer->scheduled) {
-            if (timer->countdown <= elapsed_countdown) {
-                timer->active = false;
-                timer->triggered = true;
-                timer->countdown = 0;
-                continue;
-            }
-            timer->countdown -= elapsed_countdown;
-        } else {
-            timer->scheduled = true;
+        fd_timer_heap_place(heap[parent], index);
+        index = parent;
+    }
+    fd_timer_heap_place(timer, index);
+}
+
+static
+void fd_timer_heap_down(uint32_t index) {
+    fd_timer_t *timer = heap[index];
+    while (true) {
+        uint32_t child = 2 * index + 1;
+        if (child >= heap_count) {
+            break;
+        }
+        if (((child + 1) < heap_count) && fd_timer_is_before(heap[child + 1]->deadline, heap[child]->deadline)) {
+            ++child;
         }
-        if (timer->countdown < new_countdown) {
-            new_countdown = timer->countdown;
+        if (!fd_timer_is_before(heap[child]->deadline, timer->deadline)) {
+            break;
         }
+        fd_timer_heap_place(heap[child], index);
+        index = child;
     }
-    if (new_countdown == 0) {
-        new_countdown = 1;
+    fd_timer_heap_place(timer, index);
+}
+
+static
+void fd_timer_heap_insert(fd_timer_t *timer) {
+    if (heap_count >= TIMERS_LIMIT) {
+        fd_log_assert_fail("timer limit");
+        return;
     }
-    if (new_countdown == UINT32_MAX) {
-        // nothing to do, but schedule a countdown in 5 seconds as a fail-safe
-        new_countdown = 5 * 32;
+    fd_timer_heap_place(timer, heap_count++);
+    fd_timer_heap_up(timer->index);
+}
+
+static
+void fd_timer_heap_remove(fd_timer_t *timer) {
+    uint32_t index = timer->index;
+    fd_timer_t *last = heap[--heap_count];
+    if (last != timer) {
+        fd_timer_heap_place(last, index);
+        fd_timer_heap_up(index);
+        fd_timer_heap_down(last->index);
     }
-    scheduled_countdown = new_countdown;
-    fd_hal_rtc_set_countdown(new_countdown);
 }
 
+// Find the earliest latest-allowed time (deadline plus slack) of the active timers.  Only timers with a
+// deadline before the best time found so far can lower it, so subtrees of the heap past it are skipped.
 static
-void fd_timer_callback_triggered(void) {
+uint32_t fd_timer_find_wakeup(uint32_t index, uint32_t wakeup) {
+    if (index >= heap_count) {
+        return wakeup;
+    }
+    fd_timer_t *timer = heap[index];
+    if (!fd_timer_is_before(timer->deadline, wakeup)) {
+        return wakeup;
+    }
+    uint32_t latest = timer->deadline + timer->slack;
+    if (fd_timer_is_before(latest, wakeup)) {
+        wakeup = latest;
+    }
+    wakeup = fd_timer_find_wakeup(2 * index + 1, wakeup);
+    return fd_timer_find_wakeup(2 * index + 2, wakeup);
+}
+
+static
+void fd_timer_schedule_countdown(void) {
+    if (heap_count == 0) {
+        // nothing to do, so no need to wake up
+        wakeup_scheduled = false;
+        fd_hal_rtc_set_countdown(0);
+        return;
+    }
+
+    fd_timer_t *root = heap[0];
+    uint32_t wakeup = fd_timer_find_wakeup(0, root->deadline + root->slack);
+    uint32_t now = fd_hal_rtc_get_ticks();
+    uint32_t countdown = fd_timer_is_before(now, wakeup) ? wakeup - now : 1;
+    wakeup_scheduled = true;
+    wakeup_deadline = now + countdown;
+    fd_hal_rtc_set_countdown(countdown);
+}
+
+static
+uint32_t fd_timer_expire(fd_timer_t **expired) {
+    uint32_t count = 0;
+    uint32_t now = fd_hal_rtc_get_ticks();
+    while ((heap_count > 0) && !fd_timer_is_before(now, heap[0]->deadline)) {
+        fd_timer_t *timer = heap[0];
+        fd_timer_heap_remove(timer);
+        timer->active = false;
+        timer->triggered = true;
+        expired[count++] = timer;
+    }
+    return count;
+}
+
+static
+void fd_timer_callback_triggered(fd_timer_t **expired, uint32_t count) {
+    fd_accounting_category_t category = fd_accounting_switch(FD_ACCOUNTING_TIMER);
 #ifdef FD_TIMER_TIMING
     bool is_timing = fd_hal_timing_get_enable();
 #endif
-    for (uint32_t i = 0; i < timer_count; ++i) {
-        fd_timer_t *timer = timers[i];
+    for (uint32_t i = 0; i < count; ++i) {
+        fd_timer_t *timer = expired[i];
+        // an earlier callback may have restarted or stopped the timer
         if (timer->triggered) {
             timer->triggered = false;
 #ifdef FD_TIMER_TIMING
             if (is_timing) {
                 fd_timing_start(&timer->timing);
             }
+#endif
+#ifdef FD_TRACE
+            uint32_t trace_start = fd_trace_start();
 #endif
             (*timer->callback)();
+#ifdef FD_TRACE
+            fd_trace_end(timer->trace_identifier, trace_start);
+#endif
 #ifdef FD_TIMER_TIMING
             if (is_timing) {
                 fd_timing_end(&timer->timing);
@@ -105,21 +212,52 @@ void fd_timer_callback_triggered(void) {
 #endif
         }
     }
+    fd_accounting_switch(category);
 }
 
 void fd_timer_update(void) {
+    fd_timer_t *expired[TIMERS_LIMIT];
+    uint32_t count = fd_timer_expire(expired);
     fd_timer_schedule_countdown();
-    fd_timer_callback_triggered();
+    fd_timer_callback_triggered(expired, count);
+}
+
+void fd_timer_countdown(void) {
+    ++wakeup_count;
+    fd_timer_update();
+}
+
+uint32_t fd_timer_get_wakeup_count(void) {
+    return wakeup_count;
+}
+
+void fd_timer_diagnostics(fd_binary_t *binary) {
+    fd_binary_put_uint32(binary, 16 /* length of following bytes */);
+    fd_binary_put_uint32(binary, 2 /* version */);
+    fd_binary_put_uint32(binary, wakeup_count);
+    fd_binary_put_uint32(binary, fd_hal_rtc_get_ticks());
+    // all RTC wakeups (timer countdowns and the 2 s RTC period)
+    fd_binary_put_uint32(binary, fd_hal_rtc_get_interrupt_count());
+}
+
+void fd_timer_set_slack(fd_timer_t *timer, fd_time_t slack) {
+    timer->slack = slack.seconds * 32 + slack.microseconds / 31250;
 }
 
 void fd_timer_start(fd_timer_t *timer, fd_time_t duration) {
     uint32_t countdown = duration.seconds * 32 + (duration.microseconds + 31250 - 1) / 31250;
-    timer->countdown = countdown;
+    if (timer->active) {
+        fd_timer_heap_remove(timer);
+    }
+    timer->deadline = fd_hal_rtc_get_ticks() + countdown;
     timer->active = true;
-    timer->scheduled = false;
     timer->triggered = false;
+    fd_timer_heap_insert(timer);
 
-    fd_event_set_exclusive(FD_EVENT_TIMER_SCHEDULE);
+    // the RTC countdown only needs to change when the scheduled wakeup is too late for this timer
+    if (!wakeup_scheduled || fd_timer_is_before(timer->deadline + timer->slack, wakeup_deadline)) {
+        fd_event_set_exclusive(FD_EVENT_TIMER_SCHEDULE);
+    }
 }
 
 void fd_timer_start_next(fd_timer_t *timer, uint32_t interval) {
@@ -132,5 +270,9 @@ void fd_timer_start_next(fd_timer_t *timer, uint32_t interval) {
 }
 
 void fd_timer_stop(fd_timer_t *timer) {
+    if (timer->active) {
+        fd_timer_heap_remove(timer);
+    }
     timer->active = false;
+    timer->triggered = false;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef FD_TIMER_H
 #define FD_TIMER_H
 
+#include "fd_binary.h"
 #include "fd_time.h"
 #include "fd_timing.h"
 
@@ -11,22 +12,34 @@ typedef void (*fd_timer_callback_t)(void);
 typedef struct {
     fd_timer_callback_t callback;
     bool active;
-    bool scheduled;
     bool triggered;
-    uint32_t countdown;
-#ifdef FD_EVENT_TIMING
+    // absolute RTC tick (1/32 s) that the timer expires at
+    uint32_t deadline;
+    // ticks the callback may be delayed past the deadline so that it can share a wakeup with other timers
+    uint32_t slack;
+    // position in the deadline heap (while active)
+    uint32_t index;
+#ifdef FD_TIMER_TIMING
     fd_timing_t timing;
 #endif
+#ifdef FD_TRACE
+    uint16_t trace_identifier;
+#endif
 } fd_timer_t;
 
 void fd_timer_initialize(void);
 void fd_timer_add_with_identifier(fd_timer_t *timer, fd_timer_callback_t callback, const char *identifier);
 #define fd_timer_add(timer, callback) fd_timer_add_with_identifier(timer, callback, #callback)
 
+void fd_timer_set_slack(fd_timer_t *timer, fd_time_t slack);
+
 void fd_timer_start(fd_timer_t *timer, fd_time_t duration);
 void fd_timer_start_next(fd_timer_t *timer, uint32_t interval);
 void fd_timer_stop(fd_timer_t *timer);
 
+uint32_t fd_timer_get_wakeup_count(void);
+void fd_timer_diagnostics(fd_binary_t *binary);
+
 fd_timing_iterator_t fd_timer_timing_iterator(void);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,202 @@
+#include "fd_event.h"
+#include "fd_hal_rtc.h"
+#include "fd_log.h"
+#include "fd_timer.h"
+
+// simulated RTC:  ticks at 32 Hz and sets the countdown event like RTC_IRQHandler does
+
+static uint32_t fd_timer_test_ticks;
+static uint32_t fd_timer_test_countdown;
+
+uint32_t fd_hal_rtc_get_ticks(void) {
+    return fd_timer_test_ticks;
+}
+
+uint32_t fd_hal_rtc_get_clock(void) {
+    return fd_timer_test_ticks * 1024;
+}
+
+void fd_hal_rtc_set_countdown(uint32_t countdown) {
+    fd_timer_test_countdown = countdown;
+}
+
+uint32_t fd_hal_rtc_get_countdown(void) {
+    return fd_timer_test_countdown;
+}
+
+uint32_t fd_hal_rtc_get_interrupt_count(void) {
+    return 0;
+}
+
+fd_time_t fd_hal_rtc_get_time(void) {
+    fd_time_t time;
+    time.seconds = fd_timer_test_ticks / 32;
+    time.microseconds = (fd_timer_test_ticks % 32) * 31250;
+    return time;
+}
+
+static
+void fd_timer_test_run(uint32_t ticks) {
+    fd_event_process_pending();
+    while (ticks--) {
+        ++fd_timer_test_ticks;
+        if (fd_timer_test_countdown) {
+            if (--fd_timer_test_countdown == 0) {
+                fd_event_set(FD_EVENT_RTC_COUNTDOWN);
+            }
+        }
+        fd_event_process_pending();
+    }
+}
+
+static
+fd_time_t fd_timer_test_duration(uint32_t ticks) {
+    fd_time_t duration;
+    duration.seconds = ticks / 32;
+    duration.microseconds = (ticks % 32) * 31250;
+    return duration;
+}
+
+#define FD_TIMER_TEST_COUNT 3
+
+static fd_timer_t fd_timer_test_timers[FD_TIMER_TEST_COUNT];
+static uint32_t fd_timer_test_fired_at[FD_TIMER_TEST_COUNT];
+static uint32_t fd_timer_test_fired_count[FD_TIMER_TEST_COUNT];
+static uint32_t fd_timer_test_period;
+
+static
+void fd_timer_test_fired(uint32_t i) {
+    fd_timer_test_fired_at[i] = fd_timer_test_ticks;
+    ++fd_timer_test_fired_count[i];
+}
+
+static
+void fd_timer_test_callback_0(void) {
+    fd_timer_test_fired(0);
+}
+
+static
+void fd_timer_test_callback_1(void) {
+    fd_timer_test_fired(1);
+}
+
+static
+void fd_timer_test_callback_2(void) {
+    fd_timer_test_fired(2);
+    if (fd_timer_test_period) {
+        fd_timer_start(&fd_timer_test_timers[2], fd_timer_test_duration(fd_timer_test_period));
+    }
+}
+
+#define FD_TIMER_TEST_MANY 24
+
+static fd_timer_t fd_timer_test_many[FD_TIMER_TEST_MANY];
+static uint32_t fd_timer_test_many_count;
+static uint32_t fd_timer_test_many_last;
+static bool fd_timer_test_many_ordered;
+
+static
+void fd_timer_test_many_callback(void) {
+    if (fd_timer_test_ticks < fd_timer_test_many_last) {
+        fd_timer_test_many_ordered = false;
+    }
+    fd_timer_test_many_last = fd_timer_test_ticks;
+    ++fd_timer_test_many_count;
+}
+
+void fd_timer_unit_tests(void) {
+    fd_timer_test_ticks = 0;
+    fd_timer_test_countdown = 0;
+    fd_timer_test_period = 0;
+    for (uint32_t i = 0; i < FD_TIMER_TEST_COUNT; ++i) {
+        fd_timer_test_fired_at[i] = 0;
+        fd_timer_test_fired_count[i] = 0;
+    }
+
+    fd_event_initialize();
+    fd_timer_initialize();
+    fd_timer_add(&fd_timer_test_timers[0], fd_timer_test_callback_0);
+    fd_timer_add(&fd_timer_test_timers[1], fd_timer_test_callback_1);
+    fd_timer_add(&fd_timer_test_timers[2], fd_timer_test_callback_2);
+
+    // no countdown (and no wakeups) when nothing is active
+    fd_timer_test_countdown = 5 * 32;
+    fd_event_set(FD_EVENT_TIMER_SCHEDULE);
+    fd_timer_test_run(0);
+    fd_log_assert(fd_timer_test_countdown == 0);
+
+    // timers fire in deadline order at their deadlines (durations round up to whole ticks)
+    uint32_t start = fd_timer_test_ticks;
+    fd_timer_start(&fd_timer_test_timers[0], fd_timer_test_duration(32));
+    fd_timer_start(&fd_timer_test_timers[1], fd_timer_test_duration(16));
+    fd_time_t duration = fd_timer_test_duration(64);
+    duration.microseconds += 1;
+    fd_timer_start(&fd_timer_test_timers[2], duration);
+    fd_timer_test_run(80);
+    fd_log_assert(fd_timer_test_fired_at[1] == start + 16);
+    fd_log_assert(fd_timer_test_fired_at[0] == start + 32);
+    fd_log_assert(fd_timer_test_fired_at[2] == start + 65);
+    fd_log_assert(!fd_timer_test_timers[0].active);
+
+    // a stopped timer does not fire, and restarting moves the deadline
+    fd_timer_test_fired_count[0] = 0;
+    fd_timer_test_fired_count[1] = 0;
+    start = fd_timer_test_ticks;
+    fd_timer_start(&fd_timer_test_timers[0], fd_timer_test_duration(10));
+    fd_timer_start(&fd_timer_test_timers[1], fd_timer_test_duration(10));
+    fd_timer_test_run(5);
+    fd_timer_stop(&fd_timer_test_timers[0]);
+    fd_timer_start(&fd_timer_test_timers[1], fd_timer_test_duration(10));
+    fd_timer_test_run(20);
+    fd_log_assert(fd_timer_test_fired_count[0] == 0);
+    fd_log_assert(fd_timer_test_fired_count[1] == 1);
+    fd_log_assert(fd_timer_test_fired_at[1] == start + 15);
+
+    // a timer restarted from its own callback
+    fd_timer_test_fired_count[2] = 0;
+    fd_timer_test_period = 10;
+    fd_timer_start(&fd_timer_test_timers[2], fd_timer_test_duration(fd_timer_test_period));
+    fd_timer_test_run(100);
+    fd_log_assert(fd_timer_test_fired_count[2] == 10);
+    fd_timer_test_period = 0;
+    fd_timer_stop(&fd_timer_test_timers[2]);
+
+    // a timer with slack is delayed to share a wakeup with a later timer
+    start = fd_timer_test_ticks;
+    uint32_t wakeups = fd_timer_get_wakeup_count();
+    fd_time_t slack = fd_timer_test_duration(4);
+    fd_timer_set_slack(&fd_timer_test_timers[0], slack);
+    fd_timer_start(&fd_timer_test_timers[0], fd_timer_test_duration(10));
+    fd_timer_start(&fd_timer_test_timers[1], fd_timer_test_duration(12));
+    fd_timer_test_run(20);
+    fd_log_assert(fd_timer_test_fired_at[0] == start + 12);
+    fd_log_assert(fd_timer_test_fired_at[1] == start + 12);
+    fd_log_assert(fd_timer_get_wakeup_count() == wakeups + 1);
+
+    // but not past its slack
+    start = fd_timer_test_ticks;
+    wakeups = fd_timer_get_wakeup_count();
+    fd_timer_start(&fd_timer_test_timers[0], fd_timer_test_duration(10));
+    fd_timer_start(&fd_timer_test_timers[1], fd_timer_test_duration(15));
+    fd_timer_test_run(20);
+    fd_log_assert(fd_timer_test_fired_at[0] == start + 14);
+    fd_log_assert(fd_timer_test_fired_at[1] == start + 15);
+    fd_log_assert(fd_timer_get_wakeup_count() == wakeups + 2);
+    fd_timer_set_slack(&fd_timer_test_timers[0], fd_timer_test_duration(0));
+
+    // many timers started in scrambled order
+    fd_timer_test_many_count = 0;
+    fd_timer_test_many_last = fd_timer_test_ticks;
+    fd_timer_test_many_ordered = true;
+    for (uint32_t i = 0; i < FD_TIMER_TEST_MANY; ++i) {
+        fd_timer_add(&fd_timer_test_many[i], fd_timer_test_many_callback);
+    }
+    for (uint32_t i = 0; i < FD_TIMER_TEST_MANY; ++i) {
+        fd_timer_start(&fd_timer_test_many[i], fd_timer_test_duration(1 + (i * 7) % FD_TIMER_TEST_MANY));
+    }
+    fd_timer_stop(&fd_timer_test_many[3]);
+    fd_timer_stop(&fd_timer_test_many[17]);
+    fd_timer_test_run(FD_TIMER_TEST_MANY + 1);
+    fd_log_assert(fd_timer_test_many_count == FD_TIMER_TEST_MANY - 2);
+    fd_log_assert(fd_timer_test_many_ordered);
+}
\ No newline at end of file
@@ -27,6 +27,24 @@ fd_timing_t *fd_timing_iterate(fd_timing_iterator_t *iterator) {
     return timing;
 }
 
+static
+uint16_t fd_timing_histogram_mask(fd_timing_t *timing) {
+    uint16_t mask = 0;
+    for (uint32_t i = 0; i < FD_TIMING_HISTOGRAM_BUCKETS; ++i) {
+        if (timing->histogram[i]) {
+            mask |= 1 << i;
+        }
+    }
+    return mask;
+}
+
+static
+uint32_t fd_timing_binary_length(fd_timing_t *timing) {
+    uint32_t length = (uint32_t)strlen(timing->identifier);
+    return 1 + length + 4 * 3 + 8 + 2 + 2 * __builtin_popcount(fd_timing_histogram_mask(timing));
+}
+
+// only the non-zero histogram buckets are included (as indicated by the bucket mask)
 void fd_timing_put_binary(fd_timing_t *timing, fd_binary_t *binary) {
     uint32_t length = (uint32_t)strlen(timing->identifier);
     fd_binary_put_uint8(binary, length);
@@ -34,16 +52,47 @@ void fd_timing_put_binary(fd_timing_t *timing, fd_binary_t *binary) {
     fd_binary_put_uint32(binary, timing->count);
     fd_binary_put_uint32(binary, timing->min_duration);
     fd_binary_put_uint32(binary, timing->max_duration);
-    fd_binary_put_float32(binary, timing->total_duration);
-    fd_binary_put_float32(binary, timing->sum_squared_duration);
+    fd_binary_put_uint64(binary, timing->total_duration);
+    uint16_t mask = fd_timing_histogram_mask(timing);
+    fd_binary_put_uint16(binary, mask);
+    for (uint32_t i = 0; i < FD_TIMING_HISTOGRAM_BUCKETS; ++i) {
+        if (mask & (1 << i)) {
+            fd_binary_put_uint16(binary, timing->histogram[i]);
+        }
+    }
+}
+
+void fd_timing_diagnostics(fd_timing_iterator_t *iterator, uint32_t index, fd_binary_t *binary) {
+    uint32_t length_index = binary->put_index;
+    fd_binary_put_uint32(binary, 0 /* length of following bytes */);
+    fd_binary_put_uint32(binary, 1 /* version */);
+    fd_binary_put_uint8(binary, FD_TIMING_HISTOGRAM_SHIFT);
+    fd_binary_put_uint16(binary, iterator->count);
+    fd_binary_put_uint16(binary, index);
+    uint32_t n_index = binary->put_index;
+    fd_binary_put_uint8(binary, 0);
+    uint32_t n = 0;
+    iterator->index = index;
+    fd_timing_t *timing;
+    while ((timing = fd_timing_iterate(iterator)) != 0) {
+        if (binary->put_index + fd_timing_binary_length(timing) > binary->size) {
+            break;
+        }
+        fd_timing_put_binary(timing, binary);
+        ++n;
+    }
+    if (binary->put_index <= binary->size) {
+        binary->buffer[n_index] = n;
+        fd_binary_pack_uint32(&binary->buffer[length_index], binary->put_index - length_index - 4);
+    }
 }
 
 void fd_timing_clear(fd_timing_t *timing) {
     timing->count = 0;
     timing->min_duration = 0;
     timing->max_duration = 0;
-    timing->total_duration = 0.0;
-    timing->sum_squared_duration = 0.0;
+    timing->total_duration = 0;
+    memset(timing->histogram, 0, sizeof(timing->histogram));
     timing->start = 0;
 }
 
@@ -55,10 +104,17 @@ void fd_timing_start(fd_timing_t *timing) {
 void fd_timing_end(fd_timing_t *timing) {
     uint32_t now = fd_hal_timing_get_timestamp();
     uint32_t start = timing->start;
-    double duration = (now < start) ? ((0xffffffff - start) + 1 + now) : (now - start);
+    uint32_t duration = now - start;
     timing->total_duration += duration;
-    timing->sum_squared_duration += duration * duration;
     timing->count += 1;
+    uint32_t scaled = duration >> FD_TIMING_HISTOGRAM_SHIFT;
+    uint32_t bucket = scaled ? 32 - __builtin_clz(scaled) : 0;
+    if (bucket >= FD_TIMING_HISTOGRAM_BUCKETS) {
+        bucket = FD_TIMING_HISTOGRAM_BUCKETS - 1;
+    }
+    if (timing->histogram[bucket] < 0xffff) {
+        ++timing->histogram[bucket];
+    }
     if (timing->count == 1) {
         timing->min_duration = duration;
         timing->max_duration = duration;
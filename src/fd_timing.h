@@ -7,14 +7,27 @@
 #include <stddef.h>
 #include <stdint.h>
 
+/*
+ Durations (in fd_hal_timing_get_timestamp units) are also counted in a log2 histogram so that tail latencies
+ can be seen.  Bucket 0 counts durations less than 2^FD_TIMING_HISTOGRAM_SHIFT, bucket n counts durations in
+ [2^(FD_TIMING_HISTOGRAM_SHIFT + n - 1), 2^(FD_TIMING_HISTOGRAM_SHIFT + n)), and the last bucket also counts
+ everything longer.  Bucket counts saturate.
+ */
+
+#define FD_TIMING_HISTOGRAM_BUCKETS 16
+
+#ifndef FD_TIMING_HISTOGRAM_SHIFT
+#define FD_TIMING_HISTOGRAM_SHIFT 4
+#endif
+
 typedef struct {
     const char *identifier;
 
     uint32_t count;
     uint32_t min_duration;
     uint32_t max_duration;
-    double total_duration;
-    double sum_squared_duration;
+    uint64_t total_duration;
+    uint16_t histogram[FD_TIMING_HISTOGRAM_BUCKETS];
 
     uint32_t start;
 } fd_timing_t;
@@ -72,4 +85,7 @@ fd_timing_t *fd_timing_iterate_array_of_pointers(fd_timing_iterator_t *iterator)
 
 fd_timing_t *fd_timing_iterate(fd_timing_iterator_t *iterator);
 
+// puts as many timings (starting at index) as will fit in the binary
+void fd_timing_diagnostics(fd_timing_iterator_t *iterator, uint32_t index, fd_binary_t *binary);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,168 @@
+#include "fd_log.h"
+#include "fd_timing.h"
+#include "fd_trace.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#ifdef FD_TRACE
+
+#ifndef FD_TRACE_LENGTH
+#define FD_TRACE_LENGTH 256
+#endif
+
+#define FD_TRACE_IDENTIFIER_LIMIT 64
+#define FD_TRACE_IDENTIFIER_SIZE 16
+
+#define FD_TRACE_ENTRY_SIZE 10
+
+typedef struct {
+    uint32_t start;
+    uint32_t duration;
+    uint16_t identifier;
+} fd_trace_entry_t;
+
+static const char *fd_trace_identifiers[FD_TRACE_IDENTIFIER_LIMIT];
+static uint32_t fd_trace_identifier_count;
+
+static fd_trace_entry_t fd_trace_entries[FD_TRACE_LENGTH];
+static uint32_t fd_trace_head;
+static uint32_t fd_trace_count;
+static uint32_t fd_trace_overwritten;
+
+static bool fd_trace_paused;
+
+void fd_trace_initialize(void) {
+    fd_trace_identifier_count = 0;
+    fd_trace_head = 0;
+    fd_trace_count = 0;
+    fd_trace_overwritten = 0;
+    fd_trace_paused = false;
+}
+
+uint16_t fd_trace_add_identifier(const char *identifier) {
+    for (uint32_t i = 0; i < fd_trace_identifier_count; ++i) {
+        if (fd_trace_identifiers[i] == identifier) {
+            return i;
+        }
+    }
+    if (fd_trace_identifier_count >= FD_TRACE_IDENTIFIER_LIMIT) {
+        fd_log_assert_fail("trace identifier limit");
+        return FD_TRACE_IDENTIFIER_LIMIT - 1;
+    }
+    fd_trace_identifiers[fd_trace_identifier_count] = identifier;
+    return fd_trace_identifier_count++;
+}
+
+uint32_t fd_trace_start(void) {
+    return fd_hal_timing_get_timestamp();
+}
+
+void fd_trace_end(uint16_t identifier, uint32_t start) {
+    if (fd_trace_paused || !fd_hal_timing_get_enable()) {
+        return;
+    }
+
+    fd_trace_entry_t *entry = &fd_trace_entries[fd_trace_head];
+    entry->start = start;
+    entry->duration = fd_hal_timing_get_timestamp() - start;
+    entry->identifier = identifier;
+    if (++fd_trace_head >= FD_TRACE_LENGTH) {
+        fd_trace_head = 0;
+    }
+    if (fd_trace_count < FD_TRACE_LENGTH) {
+        ++fd_trace_count;
+    } else {
+        ++fd_trace_overwritten;
+    }
+}
+
+static
+void fd_trace_read_identifiers(uint32_t index, fd_binary_t *binary) {
+    fd_binary_put_uint16(binary, fd_trace_identifier_count);
+    fd_binary_put_uint16(binary, index);
+    uint32_t n_index = binary->put_index;
+    fd_binary_put_uint8(binary, 0);
+    uint32_t n = 0;
+    while (
+        (index + n < fd_trace_identifier_count) &&
+        (binary->put_index + FD_TRACE_IDENTIFIER_SIZE <= binary->size)
+    ) {
+        uint8_t name[FD_TRACE_IDENTIFIER_SIZE];
+        memset(name, 0, sizeof(name));
+        strncpy((char *)name, fd_trace_identifiers[index + n], sizeof(name));
+        fd_binary_put_bytes(binary, name, sizeof(name));
+        ++n;
+    }
+    binary->buffer[n_index] = n;
+}
+
+static
+void fd_trace_read_entries(uint32_t index, fd_binary_t *binary) {
+    // a page of entries is only consistent with the others if nothing is recorded in between
+    fd_trace_paused = true;
+
+    fd_binary_put_uint16(binary, fd_trace_count);
+    fd_binary_put_uint32(binary, fd_trace_overwritten);
+    fd_binary_put_uint16(binary, index);
+    uint32_t n_index = binary->put_index;
+    fd_binary_put_uint8(binary, 0);
+    uint32_t oldest = (fd_trace_head + FD_TRACE_LENGTH - fd_trace_count) % FD_TRACE_LENGTH;
+    uint32_t n = 0;
+    while (
+        (index + n < fd_trace_count) &&
+        (binary->put_index + FD_TRACE_ENTRY_SIZE <= binary->size)
+    ) {
+        fd_trace_entry_t *entry = &fd_trace_entries[(oldest + index + n) % FD_TRACE_LENGTH];
+        fd_binary_put_uint32(binary, entry->start);
+        fd_binary_put_uint32(binary, entry->duration);
+        fd_binary_put_uint16(binary, entry->identifier);
+        ++n;
+    }
+    binary->buffer[n_index] = n;
+}
+
+static
+void fd_trace_resume(void) {
+    fd_trace_head = 0;
+    fd_trace_count = 0;
+    fd_trace_overwritten = 0;
+    fd_trace_paused = false;
+}
+
+void fd_trace_read(uint8_t operation, uint32_t index, fd_binary_t *binary) {
+    fd_binary_put_uint8(binary, operation);
+    switch (operation) {
+        case FD_TRACE_OPERATION_IDENTIFIERS:
+            fd_trace_read_identifiers(index, binary);
+            break;
+        case FD_TRACE_OPERATION_ENTRIES:
+            fd_trace_read_entries(index, binary);
+            break;
+        case FD_TRACE_OPERATION_RESUME:
+            fd_trace_resume();
+            break;
+    }
+}
+
+#else
+
+void fd_trace_initialize(void) {
+}
+
+uint16_t fd_trace_add_identifier(const char *identifier __attribute__((unused))) {
+    return 0;
+}
+
+uint32_t fd_trace_start(void) {
+    return 0;
+}
+
+void fd_trace_end(uint16_t identifier __attribute__((unused)), uint32_t start __attribute__((unused))) {
+}
+
+void fd_trace_read(uint8_t operation, uint32_t index __attribute__((unused)), fd_binary_t *binary) {
+    fd_binary_put_uint8(binary, operation);
+}
+
+#endif
\ No newline at end of file
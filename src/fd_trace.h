@@ -0,0 +1,38 @@
+#ifndef FD_TRACE_H
+#define FD_TRACE_H
+
+#include "fd_binary.h"
+
+#include <stdint.h>
+
+/*
+ Optional (define FD_TRACE) trace of every event and timer callback dispatched, for offline analysis of
+ bursts and ordering.  Each entry records the start timestamp (fd_hal_timing_get_timestamp), the duration,
+ and the identifier of the callback.  Entries are kept in a RAM ring buffer (oldest entries are overwritten)
+ and are only recorded while timing is enabled (fd_hal_timing_set_enable).
+
+ The FD_CONTROL_TRACE command reads the trace out a page at a time (each response has to fit in a single
+ control response).  The command is uint8 operation, uint16 index.  The response is uint8 FD_CONTROL_TRACE,
+ uint8 operation, then:
+   FD_TRACE_OPERATION_IDENTIFIERS: uint16 identifier count, uint16 index, uint8 n,
+     then n identifiers starting at index, each 16 bytes of name (zero padded, truncated).
+   FD_TRACE_OPERATION_ENTRIES: uint16 entry count, uint32 overwritten entry count, uint16 index, uint8 n,
+     then n entries starting at index (oldest first), each uint32 start timestamp, uint32 duration,
+     uint16 identifier index.  Recording is paused while the entries are read.
+   FD_TRACE_OPERATION_RESUME: (nothing) the ring is emptied and recording resumes.
+ */
+
+void fd_trace_initialize(void);
+
+uint16_t fd_trace_add_identifier(const char *identifier);
+
+uint32_t fd_trace_start(void);
+void fd_trace_end(uint16_t identifier, uint32_t start);
+
+#define FD_TRACE_OPERATION_IDENTIFIERS 0
+#define FD_TRACE_OPERATION_ENTRIES 1
+#define FD_TRACE_OPERATION_RESUME 2
+
+void fd_trace_read(uint8_t operation, uint32_t index, fd_binary_t *binary);
+
+#endif
\ No newline at end of file
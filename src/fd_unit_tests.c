@@ -7,10 +7,19 @@
 #include "em_gpio.h"
 
 extern void fd_binary_unit_tests(void);
+extern void fd_bluetooth_unit_tests(void);
+extern void fd_control_unit_tests(void);
 extern void fd_detour_unit_tests(void);
+extern void fd_dump_unit_tests(void);
+extern void fd_hal_aes_unit_tests(void);
+extern void fd_hrtimer_unit_tests(void);
+extern void fd_map_unit_tests(void);
 extern void fd_storage_unit_tests(void);
+extern void fd_step_unit_tests(void);
 extern void fd_storage_buffer_unit_tests(void);
 extern void fd_sync_unit_tests(void);
+extern void fd_timer_unit_tests(void);
+extern void fd_usb_pump_unit_tests(void);
 
 static
 void chip_erase(void) {
@@ -33,10 +42,19 @@ void main(void) {
 
     fd_binary_unit_tests();
     fd_detour_unit_tests();
+    fd_control_unit_tests();
+    fd_map_unit_tests();
+    fd_step_unit_tests();
     fd_storage_unit_tests();
     fd_storage_buffer_unit_tests();
+    fd_timer_unit_tests();
+    fd_hrtimer_unit_tests();
+    fd_bluetooth_unit_tests();
+    fd_usb_pump_unit_tests();
     storage_erase();
     fd_sync_unit_tests();
+    fd_dump_unit_tests();
+    fd_hal_aes_unit_tests();
 
     if (fd_log_did_log) {
         GPIO_PinOutClear(LED5_PORT_PIN);
@@ -4,18 +4,32 @@
 #include "fd_lock.h"
 #include "fd_log.h"
 #include "fd_usb.h"
+#include "fd_usb_pump.h"
 
 #include <em_system.h>
 #include <em_usb.h>
 #include <em_usbtypes.h>
 #include <em_usbhal.h>
 
+#include <string.h>
+
 #define VENDOR 0x2333
 #define PRODUCT 0x0002
 
 #define DEFAULT_POLL_TIMEOUT 1
 #define INTR_IN_EP_ADDR 0x81
 #define INTR_OUT_EP_ADDR 0x01
+#define INTR_EP_COUNT 2
+
+// The vendor interface has a bulk endpoint pair that carries a second detour stream.  Each bulk transfer is
+// one detour packet of up to BULK_PACKET_SIZE bytes (several USB packets), so a sync is not limited to one
+// 64 byte report per interval.  Both sides end each detour packet with a short packet, or with a zero length
+// packet when the detour packet is a whole number of USB packets (as it is at the full BULK_PACKET_SIZE), so
+// the host can read with any buffer size of at least BULK_PACKET_SIZE and gets one detour packet per read.
+#define BULK_IN_EP_ADDR 0x82
+#define BULK_OUT_EP_ADDR 0x02
+#define BULK_EP_COUNT 2
+#define BULK_PACKET_SIZE (USB_MAX_EP_SIZE * 8)
 
 EFM32_ALIGN(4)
 static const USB_DeviceDescriptor_TypeDef deviceDesc __attribute__ ((aligned(4))) =
@@ -68,16 +82,16 @@ static const uint8_t configDesc[] __attribute__ ((aligned(4)))=
   USB_CONFIG_DESCRIPTOR,  /* bDescriptorType                           */
 
   USB_CONFIG_DESCSIZE +   /* wTotalLength (LSB)                        */
-  USB_INTERFACE_DESCSIZE +
+  (USB_INTERFACE_DESCSIZE * 2) +
   USB_HID_DESCSIZE +
   (USB_ENDPOINT_DESCSIZE * NUM_EP_USED),
 
   (USB_CONFIG_DESCSIZE +  /* wTotalLength (MSB)                        */
-  USB_INTERFACE_DESCSIZE +
+  (USB_INTERFACE_DESCSIZE * 2) +
   USB_HID_DESCSIZE +
   (USB_ENDPOINT_DESCSIZE * NUM_EP_USED))>>8,
 
-  1,                      /* bNumInterfaces                            */
+  2,                      /* bNumInterfaces                            */
   1,                      /* bConfigurationValue                       */
   0,                      /* iConfiguration                            */
 
@@ -90,7 +104,7 @@ static const uint8_t configDesc[] __attribute__ ((aligned(4)))=
   USB_INTERFACE_DESCRIPTOR,       // bDescriptorType
   0,                              // bInterfaceNumber
   0,                              // bAlternateSetting
-  NUM_EP_USED,                    // bNumEndpoints
+  INTR_EP_COUNT,                  // bNumEndpoints
   0x03,                           // bInterfaceClass (HID)
   0,                              // bInterfaceSubClass
   0,                              // bInterfaceProtocol
@@ -124,6 +138,35 @@ static const uint8_t configDesc[] __attribute__ ((aligned(4)))=
   USB_MAX_EP_SIZE,        /* wMaxPacketSize (LSB)  */
   0,                      /* wMaxPacketSize (MSB)  */
   DEFAULT_POLL_TIMEOUT,   /* bInterval             */
+
+  // *** Interface descriptor ***
+  USB_INTERFACE_DESCSIZE,         // bLength
+  USB_INTERFACE_DESCRIPTOR,       // bDescriptorType
+  1,                              // bInterfaceNumber
+  0,                              // bAlternateSetting
+  BULK_EP_COUNT,                  // bNumEndpoints
+  0xff,                           // bInterfaceClass (Vendor Specific)
+  0,                              // bInterfaceSubClass
+  0,                              // bInterfaceProtocol
+  0,                              // iInterface
+
+  /*** Bulk Input Endpoint descriptor ***/
+  USB_ENDPOINT_DESCSIZE,  /* bLength               */
+  USB_ENDPOINT_DESCRIPTOR,/* bDescriptorType       */
+  BULK_IN_EP_ADDR,        /* bEndpointAddress (IN) */
+  USB_EPTYPE_BULK,        /* bmAttributes          */
+  USB_MAX_EP_SIZE,        /* wMaxPacketSize (LSB)  */
+  0,                      /* wMaxPacketSize (MSB)  */
+  0,                      /* bInterval             */
+
+  /*** Bulk Output Endpoint descriptor ***/
+  USB_ENDPOINT_DESCSIZE,  /* bLength               */
+  USB_ENDPOINT_DESCRIPTOR,/* bDescriptorType       */
+  BULK_OUT_EP_ADDR,       /* bEndpointAddress (OUT) */
+  USB_EPTYPE_BULK,        /* bmAttributes          */
+  USB_MAX_EP_SIZE,        /* wMaxPacketSize (LSB)  */
+  0,                      /* wMaxPacketSize (MSB)  */
+  0,                      /* bInterval             */
 };
 
 STATIC_CONST_STRING_DESC_LANGID( langID, 0x04, 0x09 );
@@ -162,7 +205,8 @@ static const void * const strings[] =
 
 // Endpoint buffer sizes
 // 1 = single buffer, 2 = double buffering, 3 = tripple buffering ...
-static const uint8_t bufferingMultiplier[ NUM_EP_USED + 1 ] = { 1, 1, 1 };
+// (bulk in is double buffered so the next USB packet of a transfer is ready when the host asks for it)
+static const uint8_t bufferingMultiplier[ NUM_EP_USED + 1 ] = { 1, 1, 1, 2, 1 };
 
 static void fd_usb_state_change(USBD_State_TypeDef oldState, USBD_State_TypeDef newState);
 static int fd_usb_setup(const USB_Setup_TypeDef *setup);
@@ -199,15 +243,49 @@ static uint8_t fd_usb_in_data[USB_MAX_EP_SIZE];
 static uint8_t fd_usb_detour_data[DETOUR_SIZE];
 static fd_detour_t fd_usb_detour;
 
-static uint8_t fd_usb_out_data[USB_MAX_EP_SIZE];
-
 // needs room for detour packet overhead
 #define DETOUR_SOURCE_COLLECTION_SIZE 400
 static fd_detour_source_collection_t fd_usb_detour_source_collection;
 static uint8_t fd_usb_detour_source_collection_data[DETOUR_SOURCE_COLLECTION_SIZE];
 
+// a few reports ready to go so that the host can get one every interval while the main loop is busy
+#define PUMP_SLOTS 4
+static fd_usb_pump_t fd_usb_pump;
+EFM32_ALIGN(4)
+static uint8_t fd_usb_pump_data[USB_MAX_EP_SIZE * PUMP_SLOTS];
+
+EFM32_ALIGN(4)
+static uint8_t fd_usb_bulk_in_data[BULK_PACKET_SIZE];
+
+static uint8_t fd_usb_bulk_detour_data[DETOUR_SIZE];
+static fd_detour_t fd_usb_bulk_detour;
+
+// room for a few sync responses
+#define BULK_DETOUR_SOURCE_COLLECTION_SIZE (BULK_PACKET_SIZE * 3)
+static fd_detour_source_collection_t fd_usb_bulk_detour_source_collection;
+static uint8_t fd_usb_bulk_detour_source_collection_data[BULK_DETOUR_SOURCE_COLLECTION_SIZE];
+
+// the next transfer is ready while the current one goes out
+#define BULK_PUMP_SLOTS 2
+static fd_usb_pump_t fd_usb_bulk_pump;
+EFM32_ALIGN(4)
+static uint8_t fd_usb_bulk_pump_data[BULK_PACKET_SIZE * BULK_PUMP_SLOTS];
+
+// the bulk transfer in progress still needs a zero length packet to end it
+static uint8_t *fd_usb_bulk_zlp_data;
+
+// the USB state changed, so the collections are cleared and the queued responses and streams for the old host session
+// are released (on the main loop)
+static volatile bool fd_usb_release_pending;
+
+static bool fd_usb_write(uint8_t *data, uint32_t length);
+static bool fd_usb_bulk_write(uint8_t *data, uint32_t length);
+static void fd_usb_detour_source_pushed(void);
+
 void fd_usb_initialize(void) {
     fd_usb_log_index = 0;
+    fd_usb_bulk_zlp_data = 0;
+    fd_usb_release_pending = false;
 
     fd_detour_initialize(&fd_usb_detour, fd_usb_detour_data, DETOUR_SIZE);
     fd_detour_source_collection_initialize(
@@ -218,8 +296,22 @@ void fd_usb_initialize(void) {
         DETOUR_SOURCE_COLLECTION_SIZE
     );
 
+    fd_detour_initialize(&fd_usb_bulk_detour, fd_usb_bulk_detour_data, DETOUR_SIZE);
+    fd_detour_source_collection_initialize(
+        &fd_usb_bulk_detour_source_collection,
+        fd_lock_owner_usb,
+        BULK_PACKET_SIZE,
+        fd_usb_bulk_detour_source_collection_data,
+        BULK_DETOUR_SOURCE_COLLECTION_SIZE
+    );
+
+    fd_usb_detour_source_collection.callback = fd_usb_detour_source_pushed;
+    fd_usb_bulk_detour_source_collection.callback = fd_usb_detour_source_pushed;
+    fd_usb_pump_initialize(&fd_usb_pump, &fd_usb_detour_source_collection, fd_usb_write, true, fd_usb_pump_data, USB_MAX_EP_SIZE, PUMP_SLOTS);
+    fd_usb_pump_initialize(&fd_usb_bulk_pump, &fd_usb_bulk_detour_source_collection, fd_usb_bulk_write, false, fd_usb_bulk_pump_data, BULK_PACKET_SIZE, BULK_PUMP_SLOTS);
+
     fd_event_add_em2_check(fd_usb_is_safe_to_enter_em2);
-    fd_event_add_callback(FD_EVENT_USB_TRANSFER, fd_usb_transfer);
+    fd_event_add_prioritized_callback(FD_EVENT_USB_TRANSFER, FD_EVENT_PRIORITY_HIGH, fd_usb_transfer);
 
     uint64_t unique = SYSTEM_GetUnique();
     for (uint32_t i = 0; i < 16; ++i) {
@@ -393,52 +485,135 @@ void fd_usb_state_change(USBD_State_TypeDef oldState __attribute__((unused)), US
 
     if (newState == USBD_STATE_CONFIGURED) {
         fd_detour_clear(&fd_usb_detour);
+        fd_detour_clear(&fd_usb_bulk_detour);
     }
+    fd_usb_pump_reset(&fd_usb_pump);
+    fd_usb_pump_reset(&fd_usb_bulk_pump);
+    fd_usb_bulk_zlp_data = 0;
+    fd_usb_release_pending = true;
 
     fd_event_set(FD_EVENT_USB_STATE | FD_EVENT_USB_TRANSFER);
 }
 
+// a detour packet came in on one of the endpoints (called from the USB interrupt)
 static
-int fd_usb_read_complete(USB_Status_TypeDef status, uint32_t xferred, uint32_t remaining __attribute__((unused))) {
+void fd_usb_received(
+    fd_detour_t *detour,
+    fd_detour_source_collection_t *detour_source_collection,
+    uint8_t *data,
+    USB_Status_TypeDef status,
+    uint32_t xferred
+) {
     fd_event_set(FD_EVENT_USB_TRANSFER);
 
     if ((status == USB_STATUS_DEVICE_RESET) || (status == USB_STATUS_DEVICE_SUSPENDED)) {
-        fd_detour_clear(&fd_usb_detour);
-        return USB_STATUS_OK;
+        fd_detour_clear(detour);
+        return;
     }
 
     if (status != USB_STATUS_OK) {
         fd_log_assert_fail("");
-        fd_detour_clear(&fd_usb_detour);
-        return USB_STATUS_OK;
+        fd_detour_clear(detour);
+        return;
     }
 
-    fd_detour_event(&fd_usb_detour, fd_usb_in_data, xferred);
-    switch (fd_detour_state(&fd_usb_detour)) {
+    fd_detour_set_resume(detour, (detour_source_collection->flags & FD_DETOUR_FLAG_RESUME) != 0);
+    fd_detour_event(detour, data, xferred);
+    uint32_t sequence_number;
+    if (fd_detour_get_nack(detour, &sequence_number)) {
+        // a report was lost, so ask the host to go back to it
+        fd_control_detour_resume(detour_source_collection, sequence_number);
+    }
+    switch (fd_detour_state(detour)) {
         case fd_detour_state_clear:
         case fd_detour_state_intermediate:
         break;
         case fd_detour_state_success:
-            fd_control_process(&fd_usb_detour_source_collection, fd_usb_detour.data, fd_usb_detour.length);
-            fd_detour_clear(&fd_usb_detour);
+            // a version 2 report can hold several requests
+            do {
+                fd_control_process(detour_source_collection, detour->data, detour->length);
+                fd_detour_next(detour);
+            } while (fd_detour_state(detour) == fd_detour_state_success);
+            if (fd_detour_state(detour) == fd_detour_state_error) {
+                fd_log_assert_fail("");
+                fd_detour_clear(detour);
+            }
         break;
         case fd_detour_state_error:
             fd_log_assert_fail("");
-            fd_detour_clear(&fd_usb_detour);
+            fd_detour_clear(detour);
         break;
     }
+}
+
+static
+int fd_usb_read_complete(USB_Status_TypeDef status, uint32_t xferred, uint32_t remaining __attribute__((unused))) {
+    fd_usb_received(&fd_usb_detour, &fd_usb_detour_source_collection, fd_usb_in_data, status, xferred);
+    return USB_STATUS_OK;
+}
 
+static
+int fd_usb_bulk_read_complete(USB_Status_TypeDef status, uint32_t xferred, uint32_t remaining __attribute__((unused))) {
+    fd_usb_received(&fd_usb_bulk_detour, &fd_usb_bulk_detour_source_collection, fd_usb_bulk_in_data, status, xferred);
     return USB_STATUS_OK;
 }
 
+// the next packet is started right from the write complete callback, and the main loop refills the slot
 static
 int fd_usb_write_complete(USB_Status_TypeDef status __attribute__((unused)), uint32_t xferred __attribute__((unused)), uint32_t remaining __attribute__((unused))) {
+    fd_usb_pump_write_complete(&fd_usb_pump);
+    fd_event_set(FD_EVENT_USB_TRANSFER);
+
+    return USB_STATUS_OK;
+}
+
+static
+int fd_usb_bulk_write_complete(USB_Status_TypeDef status, uint32_t xferred __attribute__((unused)), uint32_t remaining __attribute__((unused))) {
+    uint8_t *zlp_data = fd_usb_bulk_zlp_data;
+    fd_usb_bulk_zlp_data = 0;
+    if ((zlp_data != 0) && (status == USB_STATUS_OK)) {
+        if (USBD_Write(BULK_IN_EP_ADDR, zlp_data, 0, fd_usb_bulk_write_complete) == USB_STATUS_OK) {
+            // the pump slot is released when the zero length packet has gone out
+            return USB_STATUS_OK;
+        }
+        ++fd_usb_errors;
+    }
+    fd_usb_pump_write_complete(&fd_usb_bulk_pump);
     fd_event_set(FD_EVENT_USB_TRANSFER);
 
     return USB_STATUS_OK;
 }
 
+static
+bool fd_usb_write(uint8_t *data, uint32_t length) {
+    return USBD_Write(INTR_IN_EP_ADDR, data, length, fd_usb_write_complete) == USB_STATUS_OK;
+}
+
+// The whole detour packet goes out as one transfer.  The USB core does not add a zero length packet, so one is sent
+// after a transfer that ends with a full USB packet (otherwise the host would wait for more of the transfer).
+static
+bool fd_usb_bulk_write(uint8_t *data, uint32_t length) {
+    fd_usb_bulk_zlp_data = ((length % USB_MAX_EP_SIZE) == 0) ? data : 0;
+    return USBD_Write(BULK_IN_EP_ADDR, data, length, fd_usb_bulk_write_complete) == USB_STATUS_OK;
+}
+
+static
+void fd_usb_detour_source_pushed(void) {
+    fd_event_set(FD_EVENT_USB_TRANSFER);
+}
+
+// Completion callbacks and pushes set the transfer event, so nothing needs to poll while an endpoint is busy.
 void fd_usb_transfer(void) {
+    if (fd_usb_release_pending) {
+        fd_usb_release_pending = false;
+        // the collections are pushed to and filled from on the main loop, so they are cleared here and not in the
+        // state change interrupt (before their sources are released)
+        fd_detour_source_collection_clear(&fd_usb_detour_source_collection);
+        fd_detour_source_collection_clear(&fd_usb_bulk_detour_source_collection);
+        fd_control_release(&fd_usb_detour_source_collection);
+        fd_control_release(&fd_usb_bulk_detour_source_collection);
+    }
+
     if (USBD_GetUsbState() != USBD_STATE_CONFIGURED) {
         return;
     }
@@ -448,15 +623,14 @@ void fd_usb_transfer(void) {
         if (result != USB_STATUS_OK) {
             ++fd_usb_errors;
         }
-    } else {
-        fd_event_set_exclusive(FD_EVENT_USB_TRANSFER);
     }
-
-    if (!USBD_EpIsBusy(INTR_IN_EP_ADDR)) {
-        if (fd_detour_source_collection_get(&fd_usb_detour_source_collection, fd_usb_out_data)) {
-            USBD_Write(INTR_IN_EP_ADDR, fd_usb_out_data, USB_MAX_EP_SIZE, fd_usb_write_complete);
+    if (!USBD_EpIsBusy(BULK_OUT_EP_ADDR)) {
+        int result = USBD_Read(BULK_OUT_EP_ADDR, fd_usb_bulk_in_data, BULK_PACKET_SIZE, fd_usb_bulk_read_complete);
+        if (result != USB_STATUS_OK) {
+            ++fd_usb_errors;
         }
-    } else {
-        fd_event_set_exclusive(FD_EVENT_USB_TRANSFER);
     }
+
+    fd_usb_pump_fill(&fd_usb_pump);
+    fd_usb_pump_fill(&fd_usb_bulk_pump);
 }
\ No newline at end of file
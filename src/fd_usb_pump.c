@@ -0,0 +1,80 @@
+#include "fd_hal_processor.h"
+#include "fd_log.h"
+#include "fd_usb_pump.h"
+
+#include <string.h>
+
+void fd_usb_pump_initialize(
+    fd_usb_pump_t *pump,
+    fd_detour_source_collection_t *collection,
+    fd_usb_pump_write_t write,
+    bool pad,
+    uint8_t *buffer,
+    uint32_t slot_size,
+    uint32_t slot_count
+) {
+    fd_log_assert(slot_count <= FD_USB_PUMP_SLOTS_MAXIMUM);
+    fd_log_assert(collection->packetSizeMaximum <= slot_size);
+
+    pump->collection = collection;
+    pump->write = write;
+    pump->pad = pad;
+    pump->buffer = buffer;
+    pump->slot_size = slot_size;
+    pump->slot_count = slot_count;
+    pump->packets = 0;
+    fd_usb_pump_reset(pump);
+}
+
+void fd_usb_pump_reset(fd_usb_pump_t *pump) {
+    fd_hal_processor_interrupts_disable();
+    pump->head = 0;
+    pump->tail = 0;
+    pump->busy = false;
+    fd_hal_processor_interrupts_enable();
+}
+
+// called with interrupts disabled
+static
+void fd_usb_pump_start(fd_usb_pump_t *pump) {
+    if (pump->busy || (pump->head == pump->tail)) {
+        return;
+    }
+    uint32_t index = pump->tail % pump->slot_count;
+    pump->busy = true;
+    if (!(*pump->write)(&pump->buffer[index * pump->slot_size], pump->lengths[index])) {
+        pump->busy = false;
+    }
+}
+
+void fd_usb_pump_fill(fd_usb_pump_t *pump) {
+    while ((pump->head - pump->tail) < pump->slot_count) {
+        uint32_t index = pump->head % pump->slot_count;
+        uint8_t *slot = &pump->buffer[index * pump->slot_size];
+        if (!fd_detour_source_collection_get(pump->collection, slot)) {
+            break;
+        }
+        uint32_t length = pump->collection->packetSize;
+        if (pump->pad) {
+            memset(&slot[length], 0, pump->slot_size - length);
+            length = pump->slot_size;
+        }
+        pump->lengths[index] = length;
+        ++pump->head;
+    }
+
+    fd_hal_processor_interrupts_disable();
+    fd_usb_pump_start(pump);
+    fd_hal_processor_interrupts_enable();
+}
+
+void fd_usb_pump_write_complete(fd_usb_pump_t *pump) {
+    fd_hal_processor_interrupts_disable();
+    if (pump->busy) {
+        pump->busy = false;
+        ++pump->tail;
+        ++pump->packets;
+    }
+    fd_usb_pump_start(pump);
+    fd_hal_processor_interrupts_enable();
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#ifndef FD_USB_PUMP_H
+#define FD_USB_PUMP_H
+
+#include "fd_detour.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+A USB pump keeps an IN endpoint busy with back to back packets from a detour source collection.  The main loop
+moves packets from the collection into a small ring of slots (fd_usb_pump_fill), and the write complete callback
+starts the next slot right away (fd_usb_pump_write_complete), so the endpoint does not wait for a trip through
+the main loop between packets.  The collection is only touched from the main loop (fd_usb_pump_fill); the owner
+clears it there too, while fd_usb_pump_reset only empties the slots and may be called from the USB interrupt.
+*/
+
+#define FD_USB_PUMP_SLOTS_MAXIMUM 4
+
+// start writing the data to the endpoint (returns false if the write could not be started)
+typedef bool (*fd_usb_pump_write_t)(uint8_t *data, uint32_t length);
+
+typedef struct {
+    fd_detour_source_collection_t *collection;
+    fd_usb_pump_write_t write;
+    // pad each packet out to the slot size (for endpoints that always send full reports)
+    bool pad;
+    uint8_t *buffer;
+    uint32_t slot_size;
+    uint32_t slot_count;
+    uint32_t lengths[FD_USB_PUMP_SLOTS_MAXIMUM];
+    // slots are filled at head (main loop) and sent from tail (write complete)
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile bool busy;
+    // packets sent
+    volatile uint32_t packets;
+} fd_usb_pump_t;
+
+void fd_usb_pump_initialize(
+    fd_usb_pump_t *pump,
+    fd_detour_source_collection_t *collection,
+    fd_usb_pump_write_t write,
+    bool pad,
+    uint8_t *buffer,
+    uint32_t slot_size,
+    uint32_t slot_count
+);
+
+// drop anything waiting to be sent (the host went away)
+void fd_usb_pump_reset(fd_usb_pump_t *pump);
+
+// main loop:  move packets from the collection into free slots and start writing if the endpoint is idle
+void fd_usb_pump_fill(fd_usb_pump_t *pump);
+
+// write complete callback:  free the slot just sent and start the next one (the caller should then get the
+// main loop to fill the free slot)
+void fd_usb_pump_write_complete(fd_usb_pump_t *pump);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "fd_detour.h"
+#include "fd_log.h"
+#include "fd_usb_pump.h"
+
+#include <string.h>
+
+// simulated IN endpoint:  the host takes one packet per 1 ms frame (interrupt endpoint with bInterval 1)
+
+#define FD_USB_PUMP_TEST_PACKET_SIZE 64
+#define FD_USB_PUMP_TEST_MESSAGE_SIZE 300
+
+static fd_usb_pump_t fd_usb_pump_test_pump;
+static fd_detour_source_collection_t fd_usb_pump_test_collection;
+static uint8_t fd_usb_pump_test_collection_data[FD_USB_PUMP_TEST_PACKET_SIZE * 8];
+static uint8_t fd_usb_pump_test_slots[FD_USB_PUMP_TEST_PACKET_SIZE * FD_USB_PUMP_SLOTS_MAXIMUM];
+static fd_detour_source_t fd_usb_pump_test_source;
+
+static uint8_t *fd_usb_pump_test_write_data;
+static uint32_t fd_usb_pump_test_write_length;
+
+static uint8_t fd_usb_pump_test_detour_data[FD_USB_PUMP_TEST_MESSAGE_SIZE];
+static fd_detour_t fd_usb_pump_test_detour;
+static uint32_t fd_usb_pump_test_messages;
+
+static
+void fd_usb_pump_test_supplier(uint32_t offset, uint8_t *data, uint32_t length) {
+    for (uint32_t i = 0; i < length; ++i) {
+        data[i] = (uint8_t)((offset + i) * 7 + 3);
+    }
+}
+
+// keep the collection full, like fd_control does with queued sync responses
+static
+void fd_usb_pump_test_space_callback(void) {
+    while (true) {
+        fd_detour_source_set(&fd_usb_pump_test_source, fd_usb_pump_test_supplier, FD_USB_PUMP_TEST_MESSAGE_SIZE);
+        if (!fd_detour_source_collection_push(&fd_usb_pump_test_collection, &fd_usb_pump_test_source)) {
+            break;
+        }
+    }
+}
+
+static
+bool fd_usb_pump_test_write(uint8_t *data, uint32_t length) {
+    fd_log_assert(fd_usb_pump_test_write_data == 0);
+    fd_usb_pump_test_write_data = data;
+    fd_usb_pump_test_write_length = length;
+    return true;
+}
+
+static
+void fd_usb_pump_test_frame(void) {
+    if (fd_usb_pump_test_write_data == 0) {
+        return;
+    }
+    fd_log_assert(fd_usb_pump_test_write_length == FD_USB_PUMP_TEST_PACKET_SIZE);
+    fd_detour_event(&fd_usb_pump_test_detour, fd_usb_pump_test_write_data, fd_usb_pump_test_write_length);
+    fd_detour_state_t state = fd_detour_state(&fd_usb_pump_test_detour);
+    fd_log_assert(state != fd_detour_state_error);
+    if (state == fd_detour_state_success) {
+        uint8_t expected[FD_USB_PUMP_TEST_MESSAGE_SIZE];
+        fd_usb_pump_test_supplier(0, expected, sizeof(expected));
+        fd_log_assert(memcmp(fd_usb_pump_test_detour.data, expected, sizeof(expected)) == 0);
+        ++fd_usb_pump_test_messages;
+        fd_detour_clear(&fd_usb_pump_test_detour);
+    }
+    fd_usb_pump_test_write_data = 0;
+    fd_usb_pump_write_complete(&fd_usb_pump_test_pump);
+}
+
+// returns the packets per second sent when the main loop only gets to run every few frames
+static
+uint32_t fd_usb_pump_test_rate(uint32_t slots, uint32_t main_loop_frames) {
+    fd_detour_source_collection_initialize(
+        &fd_usb_pump_test_collection, 0,
+        FD_USB_PUMP_TEST_PACKET_SIZE, fd_usb_pump_test_collection_data, sizeof(fd_usb_pump_test_collection_data)
+    );
+    fd_usb_pump_test_collection.space_callback = fd_usb_pump_test_space_callback;
+    fd_detour_source_initialize(&fd_usb_pump_test_source);
+    fd_usb_pump_initialize(
+        &fd_usb_pump_test_pump, &fd_usb_pump_test_collection, fd_usb_pump_test_write, true,
+        fd_usb_pump_test_slots, FD_USB_PUMP_TEST_PACKET_SIZE, slots
+    );
+    fd_detour_initialize(&fd_usb_pump_test_detour, fd_usb_pump_test_detour_data, sizeof(fd_usb_pump_test_detour_data));
+    fd_usb_pump_test_write_data = 0;
+    fd_usb_pump_test_messages = 0;
+
+    fd_usb_pump_test_space_callback();
+    for (uint32_t frame = 0; frame < 1000; ++frame) {
+        if ((frame % main_loop_frames) == 0) {
+            fd_usb_pump_fill(&fd_usb_pump_test_pump);
+        }
+        fd_usb_pump_test_frame();
+    }
+    // 5 packets per message (61 + 4 * 63 bytes)
+    fd_log_assert(fd_usb_pump_test_messages == (fd_usb_pump_test_pump.packets / 5));
+    return fd_usb_pump_test_pump.packets;
+}
+
+void fd_usb_pump_unit_tests(void) {
+    // one packet per main loop pass (how writes were done before the pump)
+    uint32_t rate = fd_usb_pump_test_rate(1, 4);
+    fd_log_assert(rate == 250);
+
+    // with enough slots to cover the main loop latency every frame carries a packet
+    rate = fd_usb_pump_test_rate(4, 4);
+    fd_log_assert(rate >= 999);
+
+    // nothing more is written once the collection runs dry and the slots drain
+    fd_usb_pump_test_collection.space_callback = 0;
+    uint32_t packets = fd_usb_pump_test_pump.packets;
+    for (uint32_t frame = 0; frame < 100; ++frame) {
+        fd_usb_pump_fill(&fd_usb_pump_test_pump);
+        fd_usb_pump_test_frame();
+    }
+    fd_log_assert(fd_usb_pump_test_collection.bufferCount == 0);
+    fd_log_assert(fd_usb_pump_test_write_data == 0);
+    fd_log_assert((fd_usb_pump_test_pump.packets - packets) <= (8 + FD_USB_PUMP_SLOTS_MAXIMUM));
+
+    // a reset drops what was in the slots
+    fd_usb_pump_reset(&fd_usb_pump_test_pump);
+    fd_log_assert(fd_usb_pump_test_pump.head == fd_usb_pump_test_pump.tail);
+}
\ No newline at end of file
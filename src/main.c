@@ -1,15 +1,19 @@
+#include "fd_accounting.h"
 #include "fd_activity.h"
 #include "fd_adc.h"
 #include "fd_binary.h"
 #include "fd_bluetooth.h"
 #include "fd_control.h"
 #include "fd_detour.h"
+#include "fd_dump.h"
 #include "fd_event.h"
+#include "fd_hal_hrtimer.h"
 #include "fd_hal_processor.h"
 #include "fd_hal_reset.h"
 #include "fd_hal_rtc.h"
 #include "fd_hal_system.h"
 #include "fd_hal_ui.h"
+#include "fd_hrtimer.h"
 #include "fd_i2c1.h"
 #include "fd_lis3dh.h"
 #include "fd_lock.h"
@@ -23,9 +27,12 @@
 #include "fd_recognition.h"
 #include "fd_sensing.h"
 #include "fd_spi.h"
+#include "fd_step.h"
 #include "fd_storage_buffer.h"
 #include "fd_sync.h"
 #include "fd_timer.h"
+#include "fd_timing.h"
+#include "fd_trace.h"
 #include "fd_usb.h"
 #include "fd_w25q16dw.h"
 
@@ -136,6 +143,7 @@ void fd_main_usb_state_change(void) {
 int main(void) {
     fd_hal_reset_initialize();
     fd_hal_processor_initialize();
+    fd_hal_timing_initialize();
 
     fd_hal_reset_start_watchdog();
 
@@ -144,9 +152,11 @@ int main(void) {
     fd_main_was_unplugged = false;
 
     fd_log_initialize();
+    fd_trace_initialize();
     fd_event_initialize();
     fd_pins_events_initialize();
     fd_timer_initialize();
+    fd_hrtimer_initialize();
     fd_lock_initialize();
     fd_control_initialize();
 
@@ -158,6 +168,8 @@ int main(void) {
     fd_hal_reset_feed_watchdog();
     
     fd_hal_rtc_initialize();
+    fd_accounting_initialize();
+    fd_hal_hrtimer_initialize();
     fd_adc_initialize();
     fd_usb_initialize();
     fd_hal_system_initialize();
@@ -207,7 +219,9 @@ int main(void) {
 
     fd_hal_ui_initialize();
     fd_sync_initialize();
+    fd_dump_initialize();
     fd_activity_initialize();
+    fd_step_initialize();
     fd_sensing_initialize();
     fd_sensing_wake();
     fd_recognition_initialize();
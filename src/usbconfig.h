@@ -1,5 +1,5 @@
 #define USB_DEVICE
-#define NUM_EP_USED 2
+#define NUM_EP_USED 4
 
 #define USB_PWRSAVE_MODE (USB_PWRSAVE_MODE_ONVBUSOFF | USB_PWRSAVE_MODE_ONSUSPEND)
 
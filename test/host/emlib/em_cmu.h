@@ -0,0 +1,22 @@
+#ifndef EM_CMU_H
+#define EM_CMU_H
+
+#include "em_device.h"
+
+typedef struct {
+    uint32_t HFPERCLKEN0;
+} CMU_TypeDef;
+
+extern CMU_TypeDef *CMU;
+
+#define CMU_EN_BIT_POS 0
+#define CMU_EN_BIT_MASK 0x1f
+
+typedef enum {
+    cmuClock_USART0 = 0,
+    cmuClock_USART1 = 1,
+} CMU_Clock_TypeDef;
+
+void CMU_ClockEnable(CMU_Clock_TypeDef clock, bool enable);
+
+#endif
\ No newline at end of file
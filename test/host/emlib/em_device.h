@@ -0,0 +1,20 @@
+#ifndef EM_DEVICE_H
+#define EM_DEVICE_H
+
+// Host stand-in for the parts of the EFM32LG device header used by the code built for the host tests.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+    USART0_RX_IRQn = 3,
+    USART0_TX_IRQn = 4,
+    USART1_RX_IRQn = 10,
+    USART1_TX_IRQn = 11,
+} IRQn_Type;
+
+void NVIC_EnableIRQ(IRQn_Type irqn);
+void NVIC_DisableIRQ(IRQn_Type irqn);
+void NVIC_ClearPendingIRQ(IRQn_Type irqn);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,8 @@
+#ifndef EM_EMU_H
+#define EM_EMU_H
+
+#include "em_device.h"
+
+void EMU_EnterEM1(void);
+
+#endif
\ No newline at end of file
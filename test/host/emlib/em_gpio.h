@@ -0,0 +1,19 @@
+#ifndef EM_GPIO_H
+#define EM_GPIO_H
+
+#include "em_device.h"
+
+typedef enum {
+    gpioPortA = 0,
+    gpioPortB = 1,
+    gpioPortC = 2,
+    gpioPortD = 3,
+    gpioPortE = 4,
+    gpioPortF = 5,
+} GPIO_Port_TypeDef;
+
+void GPIO_PinOutSet(GPIO_Port_TypeDef port, unsigned int pin);
+void GPIO_PinOutClear(GPIO_Port_TypeDef port, unsigned int pin);
+unsigned int GPIO_PinOutGet(GPIO_Port_TypeDef port, unsigned int pin);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,61 @@
+#ifndef EM_USART_H
+#define EM_USART_H
+
+#include "em_device.h"
+
+typedef struct {
+    uint32_t CMD;
+    uint32_t STATUS;
+    uint32_t IEN;
+    uint32_t ROUTE;
+    uint32_t RXDATA;
+    uint32_t TXDATA;
+} USART_TypeDef;
+
+extern USART_TypeDef *USART0;
+extern USART_TypeDef *USART1;
+
+#define USART_CMD_CLEARTX 0x00000400
+#define USART_CMD_CLEARRX 0x00000800
+
+#define USART_STATUS_TXBL 0x00000040
+#define USART_STATUS_RXDATAV 0x00000080
+
+#define USART_IEN_TXBL 0x00000002
+#define USART_IEN_RXDATAV 0x00000004
+
+#define USART_ROUTE_RXPEN 0x00000001
+#define USART_ROUTE_TXPEN 0x00000002
+#define USART_ROUTE_CLKPEN 0x00000008
+#define USART_ROUTE_LOCATION_LOC0 0x00000000
+#define USART_ROUTE_LOCATION_LOC1 0x00000100
+
+typedef enum {
+    usartDisable = 0x0,
+    usartEnable = 0x5,
+} USART_Enable_TypeDef;
+
+typedef enum {
+    usartClockMode0 = 0x0,
+    usartClockMode1 = 0x1,
+    usartClockMode2 = 0x2,
+    usartClockMode3 = 0x3,
+} USART_ClockMode_TypeDef;
+
+typedef struct {
+    USART_Enable_TypeDef enable;
+    uint32_t refFreq;
+    uint32_t baudrate;
+    uint32_t databits;
+    bool master;
+    bool msbf;
+    USART_ClockMode_TypeDef clockMode;
+} USART_InitSync_TypeDef;
+
+#define USART_INITSYNC_DEFAULT {usartEnable, 0, 1000000, 8, true, false, usartClockMode0}
+
+void USART_Reset(USART_TypeDef *usart);
+void USART_InitSync(USART_TypeDef *usart, const USART_InitSync_TypeDef *init);
+void USART_Enable(USART_TypeDef *usart, USART_Enable_TypeDef enable);
+
+#endif
\ No newline at end of file
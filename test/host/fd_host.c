@@ -0,0 +1,137 @@
+#include "fd_binary.h"
+#include "fd_hal_external_flash.h"
+#include "fd_hal_processor.h"
+#include "fd_hal_reset.h"
+#include "fd_log.h"
+#include "fd_w25q16dw.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Host (Linux) versions of the hardware functions used by the unit tests.  The external flash is kept in RAM and
+// behaves like the W25Q16DW (writes can only clear bits, erases set them).
+
+bool fd_log_did_log;
+// failures over the whole run (fd_log_did_log is cleared again when a test calls fd_log_initialize)
+uint32_t fd_host_failure_count;
+
+void fd_log_initialize(void) {
+    fd_log_did_log = false;
+}
+
+void fd_log(char *message) {
+    printf("%s\n", message);
+}
+
+void fd_log_at(char *file, int line, char *message) {
+    printf("FAIL %s:%d %s\n", file, line, message);
+    fd_log_did_log = true;
+    ++fd_host_failure_count;
+}
+
+void fd_hal_processor_interrupts_disable(void) {
+}
+
+void fd_hal_processor_interrupts_enable(void) {
+}
+
+void fd_hal_processor_wait(void) {
+}
+
+void fd_hal_processor_get_hardware_id(fd_binary_t *binary) {
+    fd_binary_put_uint16(binary, 0); // vendor id
+    fd_binary_put_uint16(binary, 0); // product id
+    fd_binary_put_uint16(binary, 0); // hardware major version
+    fd_binary_put_uint16(binary, 0); // hardware minor version
+    fd_binary_put_uint64(binary, 0); // unique id
+}
+
+static fd_hal_reset_retained_t fd_host_retained;
+
+fd_hal_reset_retained_t *fd_hal_reset_retained(void) {
+    return &fd_host_retained;
+}
+
+void fd_hal_reset_feed_watchdog(void) {
+}
+
+#define FD_HOST_FLASH_SECTOR_SIZE (FD_W25Q16DW_PAGES_PER_SECTOR * FD_W25Q16DW_PAGE_SIZE)
+
+static uint8_t fd_host_flash[FD_W25Q16DW_PAGES * FD_W25Q16DW_PAGE_SIZE];
+
+void fd_w25q16dw_initialize(void) {
+}
+
+void fd_w25q16dw_sleep(void) {
+}
+
+void fd_w25q16dw_wake(void) {
+}
+
+void fd_w25q16dw_enable_write(void) {
+}
+
+void fd_w25q16dw_erase_sector(uint32_t address) {
+    address -= address % FD_HOST_FLASH_SECTOR_SIZE;
+    memset(&fd_host_flash[address], 0xff, FD_HOST_FLASH_SECTOR_SIZE);
+}
+
+void fd_w25q16dw_write_page(uint32_t address, uint8_t *data, uint32_t length) {
+    uint32_t page = address - (address % FD_W25Q16DW_PAGE_SIZE);
+    for (uint32_t i = 0; i < length; ++i) {
+        // wraps within the page like the flash does
+        uint32_t offset = (address + i - page) % FD_W25Q16DW_PAGE_SIZE;
+        fd_host_flash[page + offset] &= data[i];
+    }
+}
+
+void fd_w25q16dw_read(uint32_t address, uint8_t *data, uint32_t length) {
+    memcpy(data, &fd_host_flash[address], length);
+}
+
+void fd_w25q16dw_wait_while_busy(void) {
+}
+
+void fd_w25q16dw_chip_erase(void) {
+    memset(fd_host_flash, 0xff, sizeof(fd_host_flash));
+}
+
+uint32_t fd_hal_external_flash_get_pages(void) {
+    return FD_W25Q16DW_PAGES;
+}
+
+uint32_t fd_hal_external_flash_get_pages_per_sector(void) {
+    return FD_W25Q16DW_PAGES_PER_SECTOR;
+}
+
+void fd_hal_external_flash_initialize(void) {
+    fd_w25q16dw_initialize();
+}
+
+void fd_hal_external_flash_sleep(void) {
+    fd_w25q16dw_sleep();
+}
+
+void fd_hal_external_flash_wake(void) {
+    fd_w25q16dw_wake();
+}
+
+void fd_hal_external_flash_enable_write(void) {
+    fd_w25q16dw_enable_write();
+}
+
+void fd_hal_external_flash_erase_sector(uint32_t address) {
+    fd_w25q16dw_erase_sector(address);
+}
+
+void fd_hal_external_flash_write_page(uint32_t address, uint8_t *data, uint32_t length) {
+    fd_w25q16dw_write_page(address, data, length);
+}
+
+void fd_hal_external_flash_read(uint32_t address, uint8_t *data, uint32_t length) {
+    fd_w25q16dw_read(address, data, length);
+}
+
+void fd_hal_external_flash_wait_while_busy(void) {
+    fd_w25q16dw_wait_while_busy();
+}
\ No newline at end of file
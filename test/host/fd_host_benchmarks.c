@@ -0,0 +1,136 @@
+#include "fd_binary.h"
+#include "fd_hal_aes.h"
+#include "fd_map.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Host timings of code that was changed for speed, built with optimization and run with "make host-bench".  The
+// numbers are for comparing the versions on the same machine, not for the EFM32 itself.
+
+static
+double fd_host_benchmark_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// keeps the compiler from dropping the lookups
+static volatile uint32_t fd_host_benchmark_sink;
+
+#define FD_HOST_BENCHMARK_MAP_ENTRIES 64
+
+static char fd_host_benchmark_map_keys[FD_HOST_BENCHMARK_MAP_ENTRIES][16];
+static uint8_t fd_host_benchmark_map_value[] = {'v', 'a', 'l', 'u', 'e'};
+
+// the original unsorted format (entries in the order given), as written by older code
+static
+uint32_t fd_host_benchmark_map_build_linear(fd_map_entry_t *entries, uint32_t count, uint8_t *map, uint32_t size) {
+    fd_binary_t binary;
+    fd_binary_initialize(&binary, map, size);
+    fd_binary_put_uint16(&binary, count);
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        fd_map_entry_t *entry = &entries[i];
+        size_t key_length = strlen(entry->key);
+        fd_binary_put_uint8(&binary, key_length);
+        fd_binary_put_uint8(&binary, entry->type);
+        fd_binary_put_uint16(&binary, entry->length);
+        fd_binary_put_uint16(&binary, offset);
+        offset += key_length + entry->length;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        fd_map_entry_t *entry = &entries[i];
+        fd_binary_put_bytes(&binary, (const uint8_t *)entry->key, strlen(entry->key));
+        fd_binary_put_bytes(&binary, entry->value, entry->length);
+    }
+    return binary.put_index;
+}
+
+// looks up every key of the map the given number of times, returns nanoseconds per lookup
+static
+double fd_host_benchmark_map_lookups(uint8_t *map, uint32_t count, uint32_t rounds) {
+    double start = fd_host_benchmark_seconds();
+    for (uint32_t round = 0; round < rounds; ++round) {
+        for (uint32_t i = 0; i < count; ++i) {
+            uint8_t *value;
+            uint16_t length;
+            fd_map_get(map, fd_host_benchmark_map_keys[i], FD_MAP_TYPE_UTF8, &value, &length);
+            fd_host_benchmark_sink += length;
+        }
+    }
+    double seconds = fd_host_benchmark_seconds() - start;
+    return seconds * 1e9 / ((double)rounds * count);
+}
+
+static
+void fd_host_benchmark_map(void) {
+    // keys of mixed lengths, like the firmware property names
+    for (uint32_t i = 0; i < FD_HOST_BENCHMARK_MAP_ENTRIES; ++i) {
+        snprintf(fd_host_benchmark_map_keys[i], sizeof(fd_host_benchmark_map_keys[i]), "key%u%s", i * 7919 % 1000, (i & 1) ? "x" : "");
+    }
+
+    static const uint32_t counts[] = {4, 16, 64};
+    for (uint32_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+        uint32_t count = counts[c];
+        fd_map_entry_t entries[FD_HOST_BENCHMARK_MAP_ENTRIES];
+        for (uint32_t i = 0; i < count; ++i) {
+            entries[i].key = fd_host_benchmark_map_keys[i];
+            entries[i].type = FD_MAP_TYPE_UTF8;
+            entries[i].value = fd_host_benchmark_map_value;
+            entries[i].length = sizeof(fd_host_benchmark_map_value);
+        }
+        uint8_t linear[2048];
+        uint8_t sorted[2048];
+        if ((fd_host_benchmark_map_build_linear(entries, count, linear, sizeof(linear)) == 0) || (fd_map_build(entries, count, sorted, sizeof(sorted)) == 0)) {
+            printf("map benchmark: %u entries do not fit\n", count);
+            continue;
+        }
+        uint32_t rounds = 2000000 / count;
+        double linear_ns = fd_host_benchmark_map_lookups(linear, count, rounds);
+        double sorted_ns = fd_host_benchmark_map_lookups(sorted, count, rounds);
+        printf("fd_map_get %2u entries: linear %6.1f ns, sorted %6.1f ns per lookup\n", count, linear_ns, sorted_ns);
+    }
+}
+
+// the firmware image size decrypted by fd_update_commit, in its SHA1 block sized reads
+#define FD_HOST_BENCHMARK_AES_IMAGE_SIZE (128 * 1024)
+#define FD_HOST_BENCHMARK_AES_CHUNK_SIZE 64
+#define FD_HOST_BENCHMARK_AES_ROUNDS 64
+
+static uint8_t fd_host_benchmark_aes_in[FD_HOST_BENCHMARK_AES_IMAGE_SIZE];
+static uint8_t fd_host_benchmark_aes_out[FD_HOST_BENCHMARK_AES_IMAGE_SIZE];
+
+static
+void fd_host_benchmark_aes(void) {
+    uint8_t key[FD_HAL_AES_KEY_SIZE];
+    uint8_t iv[FD_HAL_AES_IV_SIZE];
+    for (uint32_t i = 0; i < sizeof(key); ++i) {
+        key[i] = (uint8_t)(i * 13 + 1);
+        iv[i] = (uint8_t)(i * 29 + 7);
+    }
+    for (uint32_t i = 0; i < sizeof(fd_host_benchmark_aes_in); ++i) {
+        fd_host_benchmark_aes_in[i] = (uint8_t)(i * 31 + (i >> 8));
+    }
+
+    fd_hal_aes_decrypt_t decrypt;
+    double start = fd_host_benchmark_seconds();
+    for (uint32_t round = 0; round < FD_HOST_BENCHMARK_AES_ROUNDS; ++round) {
+        fd_hal_aes_decrypt_start(&decrypt, key, iv);
+        for (uint32_t offset = 0; offset < FD_HOST_BENCHMARK_AES_IMAGE_SIZE; offset += FD_HOST_BENCHMARK_AES_CHUNK_SIZE) {
+            fd_hal_aes_decrypt_blocks(&decrypt, &fd_host_benchmark_aes_in[offset], &fd_host_benchmark_aes_out[offset], FD_HOST_BENCHMARK_AES_CHUNK_SIZE);
+        }
+        fd_hal_aes_decrypt_stop(&decrypt);
+        fd_host_benchmark_sink += fd_host_benchmark_aes_out[round];
+    }
+    double seconds = fd_host_benchmark_seconds() - start;
+    double bytes = (double)FD_HOST_BENCHMARK_AES_ROUNDS * FD_HOST_BENCHMARK_AES_IMAGE_SIZE;
+    printf("fd_hal_aes_decrypt_blocks %u byte chunks: %6.1f MB/s, %6.1f ns per block\n", FD_HOST_BENCHMARK_AES_CHUNK_SIZE, bytes / seconds / 1e6, seconds * 1e9 / (bytes / 16));
+}
+
+int main(void) {
+    fd_host_benchmark_map();
+    fd_host_benchmark_aes();
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include "fd_hal_processor.h"
+#include "fd_host_spi.h"
+
+#include <em_cmu.h>
+#include <em_emu.h>
+#include <em_gpio.h>
+#include <em_usart.h>
+
+#include <string.h>
+
+#define FD_HOST_SPI_PORTS 6
+#define FD_HOST_SPI_PINS 16
+#define FD_HOST_SPI_IRQS 32
+
+// interrupt passes run for each em1 wait, enough to finish any transfer the tests queue
+#define FD_HOST_SPI_EM1_PASSES 64
+
+static USART_TypeDef fd_host_spi_usart0;
+static USART_TypeDef fd_host_spi_usart1;
+static CMU_TypeDef fd_host_spi_cmu;
+
+USART_TypeDef *USART0 = &fd_host_spi_usart0;
+USART_TypeDef *USART1 = &fd_host_spi_usart1;
+CMU_TypeDef *CMU = &fd_host_spi_cmu;
+
+void USART0_RX_IRQHandler(void);
+void USART0_TX_IRQHandler(void);
+void USART1_RX_IRQHandler(void);
+void USART1_TX_IRQHandler(void);
+
+static unsigned int fd_host_spi_pins[FD_HOST_SPI_PORTS][FD_HOST_SPI_PINS];
+static uint8_t fd_host_spi_replies[FD_HOST_SPI_PINS];
+static bool fd_host_spi_irqs[FD_HOST_SPI_IRQS];
+static fd_host_spi_edge_t fd_host_spi_edges[FD_HOST_SPI_EDGES_SIZE];
+static uint32_t fd_host_spi_edges_count;
+static uint32_t fd_host_spi_sleeps;
+
+void fd_host_spi_initialize(void) {
+    memset(&fd_host_spi_usart0, 0, sizeof(fd_host_spi_usart0));
+    memset(&fd_host_spi_usart1, 0, sizeof(fd_host_spi_usart1));
+    memset(&fd_host_spi_cmu, 0, sizeof(fd_host_spi_cmu));
+    memset(fd_host_spi_pins, 0, sizeof(fd_host_spi_pins));
+    memset(fd_host_spi_replies, 0, sizeof(fd_host_spi_replies));
+    memset(fd_host_spi_irqs, 0, sizeof(fd_host_spi_irqs));
+    fd_host_spi_edges_count = 0;
+    fd_host_spi_sleeps = 0;
+
+    // the shift register is always ready:  each byte written is received right away
+    fd_host_spi_usart1.STATUS = USART_STATUS_TXBL | USART_STATUS_RXDATAV;
+}
+
+void fd_host_spi_set_reply(unsigned int csn_pin, uint8_t reply) {
+    fd_host_spi_replies[csn_pin] = reply;
+}
+
+uint32_t fd_host_spi_get_edges(fd_host_spi_edge_t **edges) {
+    *edges = fd_host_spi_edges;
+    return fd_host_spi_edges_count;
+}
+
+uint32_t fd_host_spi_get_sleeps(void) {
+    return fd_host_spi_sleeps;
+}
+
+static
+void fd_host_spi_set_pin(GPIO_Port_TypeDef port, unsigned int pin, unsigned int level) {
+    if (fd_host_spi_pins[port][pin] == level) {
+        return;
+    }
+    fd_host_spi_pins[port][pin] = level;
+    if ((port == gpioPortD) && (fd_host_spi_edges_count < FD_HOST_SPI_EDGES_SIZE)) {
+        fd_host_spi_edge_t *edge = &fd_host_spi_edges[fd_host_spi_edges_count++];
+        edge->port = port;
+        edge->pin = pin;
+        edge->level = level;
+    }
+    if ((port == gpioPortD) && (level == 0)) {
+        // the slave selected on USART1 drives miso
+        fd_host_spi_usart1.RXDATA = fd_host_spi_replies[pin];
+    }
+}
+
+void GPIO_PinOutSet(GPIO_Port_TypeDef port, unsigned int pin) {
+    fd_host_spi_set_pin(port, pin, 1);
+}
+
+void GPIO_PinOutClear(GPIO_Port_TypeDef port, unsigned int pin) {
+    fd_host_spi_set_pin(port, pin, 0);
+}
+
+unsigned int GPIO_PinOutGet(GPIO_Port_TypeDef port, unsigned int pin) {
+    return fd_host_spi_pins[port][pin];
+}
+
+void NVIC_EnableIRQ(IRQn_Type irqn) {
+    fd_host_spi_irqs[irqn] = true;
+}
+
+void NVIC_DisableIRQ(IRQn_Type irqn) {
+    fd_host_spi_irqs[irqn] = false;
+}
+
+void NVIC_ClearPendingIRQ(IRQn_Type irqn) {
+}
+
+void CMU_ClockEnable(CMU_Clock_TypeDef clock, bool enable) {
+    if (enable) {
+        fd_host_spi_cmu.HFPERCLKEN0 |= 1 << clock;
+    } else {
+        fd_host_spi_cmu.HFPERCLKEN0 &= ~(1 << clock);
+    }
+}
+
+void USART_Reset(USART_TypeDef *usart) {
+    usart->IEN = 0;
+    usart->ROUTE = 0;
+}
+
+void USART_InitSync(USART_TypeDef *usart, const USART_InitSync_TypeDef *init) {
+}
+
+void USART_Enable(USART_TypeDef *usart, USART_Enable_TypeDef enable) {
+}
+
+void fd_hal_processor_delay_ms(uint32_t ms) {
+}
+
+// the usart interrupts are the only thing that wakes the processor in these tests
+void EMU_EnterEM1(void) {
+    ++fd_host_spi_sleeps;
+    for (uint32_t i = 0; i < FD_HOST_SPI_EM1_PASSES; ++i) {
+        if (fd_host_spi_irqs[USART1_TX_IRQn] && (fd_host_spi_usart1.IEN & USART_IEN_TXBL)) {
+            USART1_TX_IRQHandler();
+        }
+        if (fd_host_spi_irqs[USART1_RX_IRQn] && (fd_host_spi_usart1.IEN & USART_IEN_RXDATAV)) {
+            USART1_RX_IRQHandler();
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#ifndef FD_HOST_SPI_H
+#define FD_HOST_SPI_H
+
+#include <stdint.h>
+
+// Simulated USART, GPIO and NVIC for running fd_spi.c on the host.  Every byte clocked out on USART1 is answered
+// with the reply byte of the slave whose chip select is low, and the port D pins record their edges.
+
+#define FD_HOST_SPI_EDGES_SIZE 32
+
+typedef struct {
+    uint8_t port;
+    uint8_t pin;
+    uint8_t level;
+} fd_host_spi_edge_t;
+
+void fd_host_spi_initialize(void);
+
+void fd_host_spi_set_reply(unsigned int csn_pin, uint8_t reply);
+
+uint32_t fd_host_spi_get_edges(fd_host_spi_edge_t **edges);
+
+// number of times the code waited in em1
+uint32_t fd_host_spi_get_sleeps(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include "fd_host_spi.h"
+#include "fd_log.h"
+#include "fd_spi.h"
+
+#include <em_gpio.h>
+
+#include <stdio.h>
+#include <string.h>
+
+// Built and run on the host with "make host-test".  fd_spi against the simulated USART1:  the LIS3DH (chip select PD8) and the nRF8001 (REQN PD3) share the bus.
+
+#define FD_HOST_SPI_TEST_LIS3DH_CSN 8
+#define FD_HOST_SPI_TEST_NRF8001_REQN 3
+
+#define FD_HOST_SPI_TEST_LIS3DH_WHO_AM_I 0x0f
+#define FD_HOST_SPI_TEST_LIS3DH_READ 0x80
+#define FD_HOST_SPI_TEST_LIS3DH_ID 0x33
+#define FD_HOST_SPI_TEST_NRF8001_REPLY 0x2d
+
+static uint32_t fd_host_spi_test_not_ready_count;
+static uint32_t fd_host_spi_test_request_count;
+static bool fd_host_spi_test_nrf8001_complete;
+
+static uint8_t fd_host_spi_test_nrf8001_tx[4];
+static uint8_t fd_host_spi_test_nrf8001_rx[4];
+static fd_spi_transfer_t fd_host_spi_test_nrf8001_transfer;
+static fd_spi_io_t fd_host_spi_test_nrf8001_io;
+
+static
+void fd_host_spi_test_nrf8001_completion(void) {
+    fd_host_spi_test_nrf8001_complete = true;
+}
+
+// like fd_nrf8001, the io is only started once the nRF8001 has signalled it is ready
+static
+bool fd_host_spi_test_nrf8001_request(void) {
+    ++fd_host_spi_test_request_count;
+    if (fd_host_spi_test_not_ready_count > 0) {
+        --fd_host_spi_test_not_ready_count;
+        return false;
+    }
+
+    fd_host_spi_test_nrf8001_transfer.op = fd_spi_op_read_write;
+    fd_host_spi_test_nrf8001_transfer.tx_buffer = fd_host_spi_test_nrf8001_tx;
+    fd_host_spi_test_nrf8001_transfer.tx_size = sizeof(fd_host_spi_test_nrf8001_tx);
+    fd_host_spi_test_nrf8001_transfer.tx_length = sizeof(fd_host_spi_test_nrf8001_tx);
+    fd_host_spi_test_nrf8001_transfer.rx_buffer = fd_host_spi_test_nrf8001_rx;
+    fd_host_spi_test_nrf8001_transfer.rx_size = sizeof(fd_host_spi_test_nrf8001_rx);
+    fd_host_spi_test_nrf8001_transfer.rx_length = sizeof(fd_host_spi_test_nrf8001_rx);
+    fd_host_spi_test_nrf8001_io.options = 0;
+    fd_host_spi_test_nrf8001_io.transfers = &fd_host_spi_test_nrf8001_transfer;
+    fd_host_spi_test_nrf8001_io.transfers_count = 1;
+    fd_host_spi_test_nrf8001_io.completion_callback = fd_host_spi_test_nrf8001_completion;
+    fd_spi_io(FD_SPI_BUS_1_SLAVE_NRF8001, &fd_host_spi_test_nrf8001_io);
+    return true;
+}
+
+static
+void fd_host_spi_test_initialize(uint32_t not_ready_count) {
+    fd_host_spi_initialize();
+    fd_host_spi_set_reply(FD_HOST_SPI_TEST_LIS3DH_CSN, FD_HOST_SPI_TEST_LIS3DH_ID);
+    fd_host_spi_set_reply(FD_HOST_SPI_TEST_NRF8001_REQN, FD_HOST_SPI_TEST_NRF8001_REPLY);
+
+    fd_spi_initialize();
+    fd_spi_on(FD_SPI_BUS_1);
+    fd_spi_set_request_callback(FD_SPI_BUS_1_SLAVE_NRF8001, fd_host_spi_test_nrf8001_request);
+
+    fd_host_spi_test_not_ready_count = not_ready_count;
+    fd_host_spi_test_request_count = 0;
+    fd_host_spi_test_nrf8001_complete = false;
+    memset(fd_host_spi_test_nrf8001_rx, 0, sizeof(fd_host_spi_test_nrf8001_rx));
+}
+
+static
+bool fd_host_spi_test_edge(fd_host_spi_edge_t *edges, uint32_t index, unsigned int pin, unsigned int level) {
+    return (edges[index].port == gpioPortD) && (edges[index].pin == pin) && (edges[index].level == level);
+}
+
+// nothing holds the bus:  the LIS3DH is read right away and the nRF8001 is not asked for anything
+static
+void fd_host_spi_test_read(void) {
+    fd_host_spi_test_initialize(0);
+    fd_host_spi_edge_t *edges;
+    uint32_t start = fd_host_spi_get_edges(&edges);
+
+    uint8_t id = fd_spi_sync_tx1_rx1(FD_SPI_BUS_1_SLAVE_LIS3DH, FD_HOST_SPI_TEST_LIS3DH_READ | FD_HOST_SPI_TEST_LIS3DH_WHO_AM_I);
+    fd_log_assert(id == FD_HOST_SPI_TEST_LIS3DH_ID);
+    fd_log_assert(fd_host_spi_test_request_count == 0);
+
+    uint32_t count = fd_host_spi_get_edges(&edges);
+    fd_log_assert(count == start + 2);
+    fd_log_assert(fd_host_spi_test_edge(edges, start, FD_HOST_SPI_TEST_LIS3DH_CSN, 0));
+    fd_log_assert(fd_host_spi_test_edge(edges, start + 1, FD_HOST_SPI_TEST_LIS3DH_CSN, 1));
+}
+
+// REQN is held low when the LIS3DH read is queued:  the LIS3DH chip select stays high, waiting in em1 while the
+// nRF8001 is not ready, until the nRF8001 io has run and REQN is back up
+static
+void fd_host_spi_test_reqn_held(void) {
+    fd_host_spi_test_initialize(2);
+    fd_host_spi_edge_t *edges;
+    uint32_t start = fd_host_spi_get_edges(&edges);
+
+    fd_spi_chip_select(FD_SPI_BUS_1_SLAVE_NRF8001, true);
+    uint8_t id = fd_spi_sync_tx1_rx1(FD_SPI_BUS_1_SLAVE_LIS3DH, FD_HOST_SPI_TEST_LIS3DH_READ | FD_HOST_SPI_TEST_LIS3DH_WHO_AM_I);
+    fd_log_assert(id == FD_HOST_SPI_TEST_LIS3DH_ID);
+
+    fd_log_assert(fd_host_spi_test_request_count == 3);
+    fd_log_assert(fd_host_spi_test_nrf8001_complete);
+    for (uint32_t i = 0; i < sizeof(fd_host_spi_test_nrf8001_rx); ++i) {
+        fd_log_assert(fd_host_spi_test_nrf8001_rx[i] == FD_HOST_SPI_TEST_NRF8001_REPLY);
+    }
+    // two waits for the nRF8001 to be ready, one for its interrupt driven io
+    fd_log_assert(fd_host_spi_get_sleeps() == 3);
+
+    uint32_t count = fd_host_spi_get_edges(&edges);
+    fd_log_assert(count == start + 4);
+    fd_log_assert(fd_host_spi_test_edge(edges, start, FD_HOST_SPI_TEST_NRF8001_REQN, 0));
+    fd_log_assert(fd_host_spi_test_edge(edges, start + 1, FD_HOST_SPI_TEST_NRF8001_REQN, 1));
+    fd_log_assert(fd_host_spi_test_edge(edges, start + 2, FD_HOST_SPI_TEST_LIS3DH_CSN, 0));
+    fd_log_assert(fd_host_spi_test_edge(edges, start + 3, FD_HOST_SPI_TEST_LIS3DH_CSN, 1));
+}
+
+extern uint32_t fd_host_failure_count;
+
+int main(void) {
+    fd_log_initialize();
+
+    fd_host_spi_test_read();
+    fd_host_spi_test_reqn_held();
+
+    if (fd_host_failure_count > 0) {
+        printf("spi unit tests failed\n");
+        return 1;
+    }
+    printf("spi unit tests passed\n");
+    return 0;
+}
\ No newline at end of file
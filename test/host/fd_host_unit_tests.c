@@ -0,0 +1,59 @@
+#include "fd_log.h"
+#include "fd_storage.h"
+#include "fd_w25q16dw.h"
+
+#include <stdio.h>
+
+// The unit tests from fd_unit_tests.c that do not need the hardware, built and run on the host with "make host-test".
+// The nRF8001 tests run against the simulator (fd_nrf8001_sim.c) and the timers against simulated clocks.
+
+extern void fd_binary_unit_tests(void);
+extern void fd_bluetooth_unit_tests(void);
+extern void fd_control_unit_tests(void);
+extern void fd_detour_unit_tests(void);
+extern void fd_dump_unit_tests(void);
+extern void fd_hal_aes_unit_tests(void);
+extern void fd_hrtimer_unit_tests(void);
+extern void fd_map_unit_tests(void);
+extern void fd_storage_unit_tests(void);
+extern void fd_step_unit_tests(void);
+extern void fd_storage_buffer_unit_tests(void);
+extern void fd_sync_unit_tests(void);
+extern void fd_timer_unit_tests(void);
+extern void fd_usb_pump_unit_tests(void);
+
+extern uint32_t fd_host_failure_count;
+
+static
+void storage_erase(void) {
+    fd_w25q16dw_chip_erase();
+    fd_storage_initialize();
+}
+
+int main(void) {
+    fd_log_initialize();
+    fd_w25q16dw_chip_erase();
+
+    fd_binary_unit_tests();
+    fd_detour_unit_tests();
+    fd_control_unit_tests();
+    fd_map_unit_tests();
+    fd_step_unit_tests();
+    fd_storage_unit_tests();
+    fd_storage_buffer_unit_tests();
+    fd_timer_unit_tests();
+    fd_hrtimer_unit_tests();
+    fd_bluetooth_unit_tests();
+    fd_usb_pump_unit_tests();
+    storage_erase();
+    fd_sync_unit_tests();
+    fd_dump_unit_tests();
+    fd_hal_aes_unit_tests();
+
+    if (fd_host_failure_count > 0) {
+        printf("unit tests failed\n");
+        return 1;
+    }
+    printf("unit tests passed\n");
+    return 0;
+}
\ No newline at end of file